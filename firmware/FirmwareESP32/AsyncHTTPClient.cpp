@@ -0,0 +1,232 @@
+#include "AsyncHTTPClient.h"
+
+#if defined(ESP32)
+#include <lwip/sockets.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+AsyncHTTPClient::AsyncHTTPClient() {
+  lineLength = 0;
+  lineOverflow = false;
+  firstLine = true;
+  chunked = false;
+  pendingSocket = -1;
+}
+
+AsyncHTTPClient::~AsyncHTTPClient() {
+  abortConnect();
+}
+
+bool AsyncHTTPClient::startConnect(IPAddress address, uint16_t port) {
+  abortConnect();
+  
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  server.sin_addr.s_addr = (uint32_t)address;
+  
+  if (::connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0 && errno != EINPROGRESS) {
+    ::close(fd);
+    return false;
+  }
+  pendingSocket = fd;
+  return true;
+}
+
+// Returns 1 once the socket is connected and handed to the WiFiClient, 0 while
+// the handshake is still in progress, or an HTTPC_ERROR_* code.
+int AsyncHTTPClient::pollConnect(WiFiClient& client) {
+  if (pendingSocket < 0) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(pendingSocket, &writable);
+  struct timeval noWait = { 0, 0 };
+  int ready = select(pendingSocket + 1, nullptr, &writable, nullptr, &noWait);
+  if (ready == 0) {
+    return 0;
+  }
+  
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (ready < 0 || getsockopt(pendingSocket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+    abortConnect();
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  
+  fcntl(pendingSocket, F_SETFL, fcntl(pendingSocket, F_GETFL, 0) & ~O_NONBLOCK);
+  client = WiFiClient(pendingSocket);
+  pendingSocket = -1;
+  return 1;
+}
+
+void AsyncHTTPClient::abortConnect() {
+  if (pendingSocket >= 0) {
+    ::close(pendingSocket);
+    pendingSocket = -1;
+  }
+}
+
+// Sends the request line and headers; a body of size bytes follows through
+// writeBody().
+bool AsyncHTTPClient::sendRequestAsync(const char* type, size_t size) {
+  _returnCode = 0;
+  _size = -1;
+  _canReuse = _reuse;
+  _transferEncoding = HTTPC_TE_IDENTITY;
+  for (size_t i = 0; i < _headerKeysCount; i++) {
+    _currentHeaders[i].value = "";
+  }
+  lineLength = 0;
+  lineOverflow = false;
+  firstLine = true;
+  chunked = false;
+  
+  if (size > 0) {
+    addHeader("Content-Length", String(size));
+  }
+  return sendHeader(type);
+}
+
+// Writes as much of data as the socket takes without waiting, in pieces of
+// HTTP_WRITE_CHUNK_SIZE. Returns the bytes written, possibly 0, or an
+// HTTPC_ERROR_* code.
+int AsyncHTTPClient::writeBody(const uint8_t* data, size_t size) {
+  int fd = _client->fd();
+  if (fd < 0) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  
+  size_t written = 0;
+  while (written < size) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(fd, &writable);
+    struct timeval noWait = { 0, 0 };
+    int ready = select(fd + 1, nullptr, &writable, nullptr, &noWait);
+    if (ready < 0) {
+      return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+    if (ready == 0) {
+      break;
+    }
+    size_t chunk = size - written < HTTP_WRITE_CHUNK_SIZE ? size - written : HTTP_WRITE_CHUNK_SIZE;
+    if (_client->write(data + written, chunk) != chunk) {
+      return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+    written += chunk;
+  }
+  return written;
+}
+
+// Returns 0 until the blank line that ends the headers has been read, then
+// the status code, or an HTTPC_ERROR_* code.
+int AsyncHTTPClient::pollHeaders() {
+  while (_client->available() > 0) {
+    int byte = _client->read();
+    if (byte < 0) {
+      break;
+    }
+    if (byte != '\n') {
+      if (lineLength < HTTP_HEADER_LINE_SIZE - 1) {
+        line[lineLength++] = byte;
+      } else {
+        lineOverflow = true;
+      }
+      continue;
+    }
+    
+    int result = handleHeaderLine();
+    lineLength = 0;
+    lineOverflow = false;
+    if (result != 0) {
+      return result;
+    }
+  }
+  
+  return connected() ? 0 : HTTPC_ERROR_CONNECTION_LOST;
+}
+
+int AsyncHTTPClient::handleHeaderLine() {
+  while (lineLength > 0 && (line[lineLength - 1] == '\r' || line[lineLength - 1] == ' ')) {
+    lineLength--;
+  }
+  line[lineLength] = '\0';
+  
+  if (firstLine) {
+    firstLine = false;
+    if (_canReuse && strncmp(line, "HTTP/1.", 7) == 0) {
+      _canReuse = line[7] != '0';
+    }
+    const char* code = strchr(line, ' ');
+    _returnCode = code ? atoi(code + 1) : 0;
+    return 0;
+  }
+  
+  if (lineLength == 0) {
+    if (chunked) {
+      return HTTPC_ERROR_ENCODING;
+    }
+    return _returnCode ? _returnCode : HTTPC_ERROR_NO_HTTP_SERVER;
+  }
+  
+  char* separator = strchr(line, ':');
+  if (!separator || lineOverflow) {
+    return 0;
+  }
+  *separator = '\0';
+  const char* value = separator + 1;
+  while (*value == ' ') value++;
+  
+  if (strcasecmp(line, "Content-Length") == 0) {
+    _size = atoi(value);
+  } else if (strcasecmp(line, "Connection") == 0) {
+    if (_canReuse && strstr(value, "close") && !strstr(value, "keep-alive")) {
+      _canReuse = false;
+    }
+  } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+    chunked = strcasecmp(value, "chunked") == 0;
+  }
+  
+  for (size_t i = 0; i < _headerKeysCount; i++) {
+    if (_currentHeaders[i].key.equalsIgnoreCase(line)) {
+      _currentHeaders[i].value = value;
+      break;
+    }
+  }
+  return 0;
+}
+
+int AsyncHTTPClient::readBody(uint8_t* buffer, size_t size) {
+  int available = _client->available();
+  if (available <= 0) {
+    return connected() ? 0 : HTTPC_ERROR_CONNECTION_LOST;
+  }
+  if ((size_t)available > size) {
+    available = size;
+  }
+  return _client->read(buffer, available);
+}
+
+int AsyncHTTPClient::contentLength() {
+  return _size;
+}
+
+bool AsyncHTTPClient::isConnected() {
+  return connected();
+}
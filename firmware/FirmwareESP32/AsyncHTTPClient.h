@@ -0,0 +1,40 @@
+#ifndef ASYNC_HTTP_CLIENT_H
+#define ASYNC_HTTP_CLIENT_H
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+static const size_t HTTP_HEADER_LINE_SIZE = 128;
+static const size_t HTTP_WRITE_CHUNK_SIZE = 512;
+
+// Non-blocking front end for the vendored HTTPClient. Requests are written
+// with the library's own sendHeader() and the response headers are parsed
+// the same way handleHeaderResponse() does, but one available byte at a
+// time so the caller can pump it from a loop instead of waiting on it. The
+// body goes out through writeBody() as the socket makes room for it.
+class AsyncHTTPClient : public HTTPClient {
+private:
+  char line[HTTP_HEADER_LINE_SIZE];
+  size_t lineLength;
+  bool lineOverflow;
+  bool firstLine;
+  bool chunked;
+  int pendingSocket;
+
+  int handleHeaderLine();
+
+public:
+  AsyncHTTPClient();
+  ~AsyncHTTPClient();
+  bool startConnect(IPAddress address, uint16_t port);
+  int pollConnect(WiFiClient& client);
+  void abortConnect();
+  bool sendRequestAsync(const char* type, size_t size);
+  int writeBody(const uint8_t* data, size_t size);
+  int pollHeaders();
+  int readBody(uint8_t* buffer, size_t size);
+  int contentLength();
+  bool isConnected();
+};
+
+#endif
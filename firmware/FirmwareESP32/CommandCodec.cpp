@@ -0,0 +1,376 @@
+#include "CommandCodec.h"
+
+static const char AXIS_NAMES[COMMAND_MAX_AXES] = { 'X', 'Y', 'Z', 'T', 'G' };
+
+class UARTWriter {
+public:
+  UARTWriter(char* buffer, size_t size) : buffer(buffer), size(size), length(0), overflow(false) {}
+
+  void append(const char* text) {
+    while (*text) append(*text++);
+  }
+
+  void append(const char* text, size_t count) {
+    for (size_t i = 0; i < count && text[i]; i++) append(text[i]);
+  }
+
+  void append(char c) {
+    if (length + 1 >= size) {
+      overflow = true;
+      return;
+    }
+    buffer[length++] = c;
+  }
+
+  void appendInt(int32_t value) {
+    char digits[12];
+    int count = 0;
+    uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    do {
+      digits[count++] = '0' + (magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) append('-');
+    while (count > 0) append(digits[--count]);
+  }
+
+  size_t finish() {
+    if (overflow || size == 0) return 0;
+    buffer[length] = '\0';
+    return length;
+  }
+
+private:
+  char* buffer;
+  size_t size;
+  size_t length;
+  bool overflow;
+};
+
+static void appendAxisValues(UARTWriter& writer, const CommandRecord& record, bool withAxisNames) {
+  int operand = 0;
+  for (int g = 0; g < record.axisCount; g++) {
+    if (g > 0) writer.append(':');
+    if (withAxisNames) writer.append(CommandCodec::axisName(record.axisGroups[g] >> 4));
+    int count = record.axisGroups[g] & 0x0F;
+    for (int i = 0; i < count; i++) {
+      if (i > 0) writer.append(',');
+      writer.appendInt(record.operands[operand++]);
+    }
+  }
+}
+
+bool CommandCodec::decode(const char* webCommand, CommandRecord& record, const char*& text) {
+  memset(&record, 0, sizeof(record));
+  text = "";
+
+  if (strncmp(webCommand, "MOVE:", 5) == 0 && axisIndex(webCommand[5]) >= 0) {
+    record.opcode = CMD_MOVE;
+    if (decodeAxisValues(webCommand + 5, record) && record.axisCount == 1) {
+      return true;
+    }
+    int axis = axisIndex(webCommand[5]);
+    record.axisMask = 1 << axis;
+    record.axisCount = 1;
+    record.axisGroups[0] = axis << 4;
+    return decodeText(webCommand + 6, record, text);
+  }
+
+  if (strncmp(webCommand, "GROUP:", 6) == 0) {
+    record.opcode = CMD_GROUP;
+    return decodeAxisValues(webCommand + 6, record) || decodeText(webCommand + 6, record, text);
+  }
+
+  if (strncmp(webCommand, "WAIT:", 5) == 0) {
+    record.opcode = CMD_WAIT;
+    return decodeText(webCommand + 5, record, text);
+  }
+
+  if (strncmp(webCommand, "ZERO", 4) == 0) {
+    record.opcode = CMD_ZERO;
+    return true;
+  }
+
+  if (strncmp(webCommand, "HOME", 4) == 0) {
+    record.opcode = CMD_HOME;
+    return true;
+  }
+
+  if (strncmp(webCommand, "SPEED:", 6) == 0) {
+    record.opcode = CMD_SPEED;
+    const char* payload = webCommand + 6;
+    const char* separator = strchr(payload, ':');
+    if (separator && parseInt32(separator + 1, separator + 1 + strlen(separator + 1), record.operands[0])) {
+      if (separator - payload == 3 && strncmp(payload, "ALL", 3) == 0) {
+        record.operandCount = 1;
+        return true;
+      }
+      int axis = separator - payload == 1 ? axisIndex(payload[0]) : -1;
+      if (axis >= 0) {
+        record.axisMask = 1 << axis;
+        record.axisCount = 1;
+        record.axisGroups[0] = (axis << 4) | 1;
+        record.operandCount = 1;
+        return true;
+      }
+    }
+    record.operands[0] = 0;
+    return decodeText(payload, record, text);
+  }
+
+  record.opcode = CMD_RAW;
+  return decodeText(webCommand, record, text);
+}
+
+bool CommandCodec::decodeAxisValues(const char* text, CommandRecord& record) {
+  const char* cursor = text;
+  while (*cursor) {
+    int axis = axisIndex(*cursor);
+    if (axis < 0 || record.axisCount >= COMMAND_MAX_AXES) break;
+    cursor++;
+
+    int count = 0;
+    while (true) {
+      const char* end = cursor;
+      while (*end && *end != ',' && *end != ':') end++;
+      if (record.operandCount >= COMMAND_MAX_OPERANDS || !parseInt32(cursor, end, record.operands[record.operandCount])) {
+        count = -1;
+        break;
+      }
+      record.operandCount++;
+      count++;
+      cursor = end;
+      if (*cursor != ',') break;
+      cursor++;
+    }
+    if (count <= 0) break;
+
+    record.axisMask |= 1 << axis;
+    record.axisGroups[record.axisCount++] = (axis << 4) | count;
+
+    if (*cursor == '\0') return true;
+    cursor++;
+    if (*cursor == '\0') break;
+  }
+
+  if (*text == '\0') return true;
+
+  record.axisMask = 0;
+  record.axisCount = 0;
+  record.operandCount = 0;
+  memset(record.axisGroups, 0, sizeof(record.axisGroups));
+  memset(record.operands, 0, sizeof(record.operands));
+  return false;
+}
+
+bool CommandCodec::decodeText(const char* source, CommandRecord& record, const char*& text) {
+  size_t length = strlen(source);
+  if (length > COMMAND_TEXT_MAX) {
+    record.opcode = CMD_INVALID;
+    return false;
+  }
+  record.flags |= CMD_FLAG_TEXT;
+  record.operandCount = 0;
+  record.textLength = length;
+  text = source;
+  return true;
+}
+
+bool CommandCodec::parseInt32(const char* begin, const char* end, int32_t& value) {
+  const char* cursor = begin;
+  bool negative = false;
+  if (cursor < end && *cursor == '-') {
+    negative = true;
+    cursor++;
+  }
+  if (cursor == end || (*cursor == '0' && (cursor + 1 != end || negative))) {
+    return false;
+  }
+
+  int64_t magnitude = 0;
+  for (; cursor < end; cursor++) {
+    if (*cursor < '0' || *cursor > '9') return false;
+    magnitude = magnitude * 10 + (*cursor - '0');
+    if (magnitude > 2147483648LL) return false;
+  }
+  if (!negative && magnitude > 2147483647LL) return false;
+
+  value = (int32_t)(negative ? -magnitude : magnitude);
+  return true;
+}
+
+size_t CommandCodec::toUART(const CommandRecord& record, const char* text, const char* armName, char* buffer, size_t size) {
+  UARTWriter writer(buffer, size);
+  bool isText = record.flags & CMD_FLAG_TEXT;
+
+  writer.append(armName);
+  writer.append(':');
+
+  switch (record.opcode) {
+    case CMD_MOVE:
+      writer.append(axisName(record.axisGroups[0] >> 4));
+      writer.append(':');
+      if (isText) {
+        writer.append(text, record.textLength);
+      } else {
+        appendAxisValues(writer, record, false);
+      }
+      break;
+    case CMD_GROUP:
+      writer.append("GROUP:");
+      if (isText) {
+        writer.append(text, record.textLength);
+      } else {
+        appendAxisValues(writer, record, true);
+      }
+      break;
+    case CMD_WAIT:
+      writer.append("WAIT:");
+      writer.append(text, record.textLength);
+      break;
+    case CMD_ZERO:
+      writer.append("ZERO");
+      break;
+    case CMD_HOME:
+      writer.append("HOME");
+      break;
+    case CMD_SPEED:
+      writer.append("SPEED:");
+      if (isText) {
+        writer.append(text, record.textLength);
+      } else {
+        if (record.axisCount == 0) {
+          writer.append("ALL");
+        } else {
+          writer.append(axisName(record.axisGroups[0] >> 4));
+        }
+        writer.append(':');
+        writer.appendInt(record.operands[0]);
+      }
+      break;
+    case CMD_RAW:
+      writer.append("RAW:");
+      writer.append(text, record.textLength);
+      break;
+    default:
+      return 0;
+  }
+
+  return writer.finish();
+}
+
+// Binary layout: [flags:4|opcode:4][operandCount:4|axisCount:4][axisGroups...]
+// followed by zigzag varint operands, or the raw text when CMD_FLAG_TEXT is set.
+size_t CommandCodec::toBinary(const CommandRecord& record, const char* text, uint8_t* buffer, size_t size) {
+  if (record.opcode == CMD_INVALID || size < BINARY_COMMAND_SIZE) {
+    return 0;
+  }
+
+  size_t length = 0;
+  buffer[length++] = (record.flags << 4) | record.opcode;
+  buffer[length++] = (record.operandCount << 4) | record.axisCount;
+  for (int g = 0; g < record.axisCount; g++) {
+    buffer[length++] = record.axisGroups[g];
+  }
+
+  if (record.flags & CMD_FLAG_TEXT) {
+    memcpy(buffer + length, text, record.textLength);
+    return length + record.textLength;
+  }
+
+  for (int i = 0; i < record.operandCount; i++) {
+    uint32_t zigzag = ((uint32_t)record.operands[i] << 1) ^ (uint32_t)(record.operands[i] >> 31);
+    while (zigzag >= 0x80) {
+      buffer[length++] = (zigzag & 0x7F) | 0x80;
+      zigzag >>= 7;
+    }
+    buffer[length++] = zigzag;
+  }
+  return length;
+}
+
+bool CommandCodec::fromBinary(const uint8_t* buffer, size_t length, CommandRecord& record, const char*& text) {
+  memset(&record, 0, sizeof(record));
+  text = "";
+  if (length < 2 || (buffer[1] & 0x0F) > COMMAND_MAX_AXES || (buffer[1] >> 4) > COMMAND_MAX_OPERANDS) {
+    return false;
+  }
+
+  record.opcode = buffer[0] & 0x0F;
+  record.flags = buffer[0] >> 4;
+  record.axisCount = buffer[1] & 0x0F;
+  record.operandCount = buffer[1] >> 4;
+  // toUART has nothing to send for an opcode past CMD_RAW, so such a record
+  // would be retried forever instead of failing here.
+  if (record.opcode == CMD_INVALID || record.opcode > CMD_RAW) {
+    return false;
+  }
+
+  size_t cursor = 2;
+  if (cursor + record.axisCount > length) {
+    return false;
+  }
+  int groupedOperands = 0;
+  for (int g = 0; g < record.axisCount; g++) {
+    record.axisGroups[g] = buffer[cursor++];
+    if ((record.axisGroups[g] >> 4) >= COMMAND_MAX_AXES) {
+      return false;
+    }
+    record.axisMask |= 1 << (record.axisGroups[g] >> 4);
+    groupedOperands += record.axisGroups[g] & 0x0F;
+  }
+
+  if (record.flags & CMD_FLAG_TEXT) {
+    if (length - cursor > COMMAND_TEXT_MAX) {
+      return false;
+    }
+    record.textLength = length - cursor;
+    text = (const char*)buffer + cursor;
+    return true;
+  }
+
+  // appendAxisValues walks the operands by the group counts.
+  if ((record.opcode == CMD_MOVE || record.opcode == CMD_GROUP) && groupedOperands != record.operandCount) {
+    return false;
+  }
+
+  for (int i = 0; i < record.operandCount; i++) {
+    uint32_t zigzag = 0;
+    int shift = 0;
+    while (true) {
+      if (cursor >= length || shift > 28) {
+        return false;
+      }
+      uint8_t byte = buffer[cursor++];
+      zigzag |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) break;
+      shift += 7;
+    }
+    record.operands[i] = (int32_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+  }
+  return cursor == length;
+}
+
+const char* CommandCodec::opcodeName(uint8_t opcode) {
+  switch (opcode) {
+    case CMD_MOVE: return "MOVE";
+    case CMD_GROUP: return "GROUP";
+    case CMD_WAIT: return "WAIT";
+    case CMD_ZERO: return "ZERO";
+    case CMD_HOME: return "HOME";
+    case CMD_SPEED: return "SPEED";
+    case CMD_RAW: return "RAW";
+    default: return "INVALID";
+  }
+}
+
+int CommandCodec::axisIndex(char axis) {
+  for (int i = 0; i < COMMAND_MAX_AXES; i++) {
+    if (AXIS_NAMES[i] == axis) return i;
+  }
+  return -1;
+}
+
+char CommandCodec::axisName(int index) {
+  return index >= 0 && index < COMMAND_MAX_AXES ? AXIS_NAMES[index] : '?';
+}
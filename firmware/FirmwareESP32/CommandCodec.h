@@ -0,0 +1,62 @@
+#ifndef COMMAND_CODEC_H
+#define COMMAND_CODEC_H
+
+#include <Arduino.h>
+
+static const int COMMAND_MAX_OPERANDS = 6;
+static const int COMMAND_MAX_AXES = 5;
+static const int COMMAND_TEXT_MAX = 240;
+static const int UART_COMMAND_SIZE = COMMAND_TEXT_MAX + 32;
+static const int BINARY_COMMAND_SIZE = 2 + COMMAND_MAX_AXES + COMMAND_TEXT_MAX;
+
+enum CommandOpcode : uint8_t {
+  CMD_INVALID = 0,
+  CMD_MOVE,
+  CMD_GROUP,
+  CMD_WAIT,
+  CMD_ZERO,
+  CMD_HOME,
+  CMD_SPEED,
+  CMD_RAW
+};
+
+static const int CMD_OPCODE_COUNT = CMD_RAW + 1;
+
+enum CommandFlags : uint8_t {
+  CMD_FLAG_TEXT = 0x01
+};
+
+// Web commands are decoded once when a script page arrives. Numeric payloads
+// are packed as operands; anything that does not round-trip exactly keeps its
+// original text so the arm masters receive the same bytes as before. That
+// text lives next to the records (see CommandText.h): the codec hands out a
+// pointer into its input and textOffset locates the copy the owner keeps.
+struct CommandRecord {
+  uint8_t opcode;
+  uint8_t flags;
+  uint8_t axisMask;
+  uint8_t axisCount;
+  uint8_t axisGroups[COMMAND_MAX_AXES];
+  uint8_t operandCount;
+  uint8_t textLength;
+  uint16_t textOffset;
+  int32_t operands[COMMAND_MAX_OPERANDS];
+};
+
+class CommandCodec {
+public:
+  static bool decode(const char* webCommand, CommandRecord& record, const char*& text);
+  static size_t toUART(const CommandRecord& record, const char* text, const char* armName, char* buffer, size_t size);
+  static size_t toBinary(const CommandRecord& record, const char* text, uint8_t* buffer, size_t size);
+  static bool fromBinary(const uint8_t* buffer, size_t length, CommandRecord& record, const char*& text);
+  static const char* opcodeName(uint8_t opcode);
+  static int axisIndex(char axis);
+  static char axisName(int index);
+
+private:
+  static bool decodeAxisValues(const char* text, CommandRecord& record);
+  static bool decodeText(const char* source, CommandRecord& record, const char*& text);
+  static bool parseInt32(const char* begin, const char* end, int32_t& value);
+};
+
+#endif
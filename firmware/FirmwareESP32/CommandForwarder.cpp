@@ -1,324 +1,1725 @@
 #include "CommandForwarder.h"
 
-CommandForwarder::CommandForwarder() {
+const ArmPortConfig ARM_PORTS[ARM_COUNT] = {
+  { "arm1", &Serial1, 16, 17 },
+  { "arm2", &Serial2, 18, 19 },
+};
+
+CommandForwarder::CommandForwarder()
+    : jsonDoc(JSON_DOCUMENT_SIZE), pollFilter(JSON_FILTER_SIZE), chunkFilter(JSON_FILTER_SIZE), tasksStarted(false), stopRequested(false) {
   httpClient = nullptr;
-  arm1Master = nullptr;
-  arm2Master = nullptr;
   isRunning = false;
   lastPollTime = 0;
-  lastCommandTime = 0;
+  pipelineDepth = 1;
+  binaryProtocol = false;
+  nextScriptToken = 1;
+  scriptEncoding = SCRIPT_ENCODING_JSON;
+  pollEtag[0] = '\0';
+  bootToReadyMs = 0;
+  reportedLogDrops = 0;
+  refillArm = -1;
+  refillToken = 0;
+  heldPageCount = 0;
+  lastLatencyUpload = 0;
+  latencyReport[0] = '\0';
+  lastTelemetryFlush = 0;
+  uploadBatch.recordCount = 0;
+  uploadBatchSent = 0;
+  telemetryPayload[0] = '\0';
+  telemetryPayloadLength = 0;
+  telemetryPayloadRecords = 0;
+  nextTelemetryUpload = 0;
+  telemetryUploads = TelemetryUploadStats();
+  
+  pollFilter["shouldStart"] = true;
+  chunkFilter["scriptId"] = true;
+  chunkFilter["offset"] = true;
+  chunkFilter["commands"] = true;
   
-  resetArmScript(arm1Script);
-  resetArmScript(arm2Script);
-  arm1Script.armId = "arm1";
-  arm2Script.armId = "arm2";
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmScript& arm = arms[i];
+    armMasters[i] = nullptr;
+    JsonObject armFilter = pollFilter.createNestedObject(ARM_PORTS[i].name);
+    armFilter["hasNewScript"] = true;
+    armFilter["scriptId"] = true;
+    armFilter["format"] = true;
+    armFilter["totalCommands"] = true;
+    armFilter["commands"] = true;
+    resetArmScript(arm);
+    arm.pipeline.queueLimit = PIPELINE_MAX_DEPTH;
+    resetArmFeed(armFeeds[i]);
+    resetArmFeed(stagedFeeds[i]);
+    snprintf(armFeeds[i].cacheSlot, CACHE_SLOT_SIZE, "%s", ARM_PORTS[i].name);
+    snprintf(stagedFeeds[i].cacheSlot, CACHE_SLOT_SIZE, "%s-next", ARM_PORTS[i].name);
+    arm.staged.scriptToken = 0;
+    arm.staged.loadedCount = 0;
+    arm.staged.isRestored = false;
+    arm.swaps = SwapStats();
+    arm.dispatch = DispatchStats();
+    arm.responses = ResponseStats();
+    arm.armIndex = i;
+    arm.armName = ARM_PORTS[i].name;
+    int length = 0;
+    for (; ARM_PORTS[i].name[length] && length < ARM_NAME_SIZE - 1; length++) {
+      arm.logTag[length] = toupper(ARM_PORTS[i].name[length]);
+    }
+    arm.logTag[length] = '\0';
+  }
 }
 
 CommandForwarder::~CommandForwarder() {
+  stopTasks();
   if (httpClient) delete httpClient;
-  if (arm1Master) delete arm1Master;
-  if (arm2Master) delete arm2Master;
+  for (int i = 0; i < ARM_COUNT; i++) {
+    if (armMasters[i]) delete armMasters[i];
+  }
 }
 
 void CommandForwarder::initialize(const char* ssid, const char* password, const char* serverHost, int serverPort) {
   Serial.begin(115200);
 
-  WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(1000);
-    Serial.println("Connecting to WiFi...");
+  wifiLink.begin(ssid, password, deferredLog);
+  httpClient = new HttpClient(serverHost, serverPort, deferredLog);
+  
+  for (int i = 0; i < ARM_COUNT; i++) {
+    const ArmPortConfig& config = ARM_PORTS[i];
+    armMasters[i] = new SerialBridge(config.port);
+    config.port->begin(115200, SERIAL_8N1, config.rxPin, config.txPin);
+    armMasters[i]->begin(115200);
+    
+    if (binaryProtocol) {
+      Serial.println(String(arms[i].logTag) + " protocol: " + (armMasters[i]->negotiateBinary() ? "binary" : "text"));
+    }
+    
+    routers[i].attach(armMasters[i], i);
+    routers[i].subscribe(ROUTE_ALL, onArmFirstByte, this);
+    routers[i].subscribe(ROUTE_COMPLETION, onArmCompletion, this);
+    routers[i].subscribe(ROUTE_INFO, onArmInfo, this);
+    routers[i].subscribe(ROUTE_ALL, onArmTelemetry, this);
+  }
+  
+  if (scriptCache.begin(SCRIPT_CACHE_ROOT)) {
+    restoreCachedScripts();
+  } else {
+    Serial.println("Script cache unavailable");
   }
-  Serial.println("WiFi connected");
 
-  httpClient = new HttpClient(serverHost, serverPort);
+  Serial.println("ESP32 Command Forwarder ready, " + String(ARM_COUNT) + " arms");
+  for (int i = 0; i < ARM_COUNT; i++) {
+    Serial.println(String(arms[i].logTag) + " Master: GPIO" + String(ARM_PORTS[i].rxPin) + "/" + String(ARM_PORTS[i].txPin));
+  }
+}
+
+bool CommandForwarder::startTasks() {
+  if (tasksStarted) {
+    return true;
+  }
   
-  arm1Master = new SerialBridge(&Serial1);
-  arm2Master = new SerialBridge(&Serial2);
+  stopRequested = false;
+  tasksStarted = true;
+  if (!networkRunner.start("network", networkTask, this, 8192, 1, 0) ||
+      !dispatchRunner.start("dispatch", dispatchTask, this, 4096, 2, 1)) {
+    stopTasks();
+    Serial.println("Failed to start forwarder tasks");
+    return false;
+  }
   
-  Serial1.begin(115200, SERIAL_8N1, 16, 17);
-  Serial2.begin(115200, SERIAL_8N1, 18, 19);
+  Serial.println("Network task on core 0, dispatch task on core 1");
+  return true;
+}
+
+void CommandForwarder::stopTasks() {
+  if (!tasksStarted) {
+    return;
+  }
   
-  arm1Master->begin(115200);
-  arm2Master->begin(115200);
+  stopRequested = true;
+  networkRunner.join();
+  dispatchRunner.join();
+  tasksStarted = false;
+}
+
+void CommandForwarder::networkTask(void* context) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  while (!forwarder->stopRequested) {
+    forwarder->networkStep();
+    forwarder->drainLog(LOG_DRAIN_BATCH);
+    TaskRunner::sleep(NETWORK_TASK_INTERVAL_MS);
+  }
+  forwarder->drainLog(LOG_RING_SIZE);
+}
 
-  Serial.println("ESP32 Dual-UART Command Forwarder ready");
-  Serial.println("ARM1 Master: Serial1 (GPIO16/17)");
-  Serial.println("ARM2 Master: Serial2 (GPIO18/19)");
+void CommandForwarder::dispatchTask(void* context) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  while (!forwarder->stopRequested) {
+    forwarder->dispatchStep();
+    TaskRunner::sleep(DISPATCH_TASK_INTERVAL_MS);
+  }
 }
 
 void CommandForwarder::update() {
-  unsigned long currentTime = millis();
+  // The network task prints the log: loopTask shares core 1 with dispatch
+  // and only runs while dispatch is blocked.
+  if (tasksStarted) {
+    TaskRunner::sleep(IDLE_LOOP_INTERVAL_MS);
+    return;
+  }
+  
+  networkStep();
+  dispatchStep();
+  drainLog(LOG_DRAIN_BATCH);
+}
 
-  if (currentTime - lastPollTime >= 2000) {
-    pollForCommands();
+void CommandForwarder::networkStep() {
+  bool linkUp = wifiLink.update();
+  httpClient->poll();
+  receiveTelemetry();
+  
+  // A request in flight has its page slots reserved, so the cache waits too.
+  if (!releaseHeldPages() || httpClient->isBusy()) {
+    return;
+  }
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmFeed* feeds[] = { &armFeeds[i], &stagedFeeds[i] };
+    for (ArmFeed* feed : feeds) {
+      if (feed->cache.reading && armWindowNeedsRefill(*feed) && pageQueue.freeSlots() > 0) {
+        refillFromCache(i, *feed);
+      }
+    }
+  }
+  if (armsIdle()) {
+    flushScriptCache();
+  }
+  if (!linkUp) {
+    return;
+  }
+  
+  unsigned long currentTime = millis();
+  if (currentTime - lastPollTime >= POLL_INTERVAL_MS && pageQueue.freeSlots() >= ARM_COUNT) {
     lastPollTime = currentTime;
+    pollForCommands();
+    return;
   }
+  
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmFeed* feeds[] = { &armFeeds[i], &stagedFeeds[i] };
+    for (ArmFeed* feed : feeds) {
+      if (!feed->cache.reading && armWindowNeedsRefill(*feed) && pageQueue.freeSlots() > 0) {
+        refillArmWindow(i, *feed);
+        return;
+      }
+    }
+  }
+  
+  if (uploadTelemetry()) {
+    return;
+  }
+  
+  if (currentTime - lastLatencyUpload >= LATENCY_UPLOAD_INTERVAL_MS) {
+    lastLatencyUpload = currentTime;
+    uploadLatency();
+  }
+}
 
-  if (isRunning && (currentTime - lastCommandTime >= 500)) {
-    processNextCommand();
-    lastCommandTime = currentTime;
+void CommandForwarder::pollForCommands() {
+  String endpoint = "/api/script/poll?pageSize=" + String(SCRIPT_PAGE_SIZE);
+  if (scriptEncoding == SCRIPT_ENCODING_BINARY) {
+    endpoint += "&encoding=bin";
   }
+  httpClient->request("GET", endpoint, nullptr, 0, pollEtag, sizeof(pollEtag), onPollResponse, this);
+}
 
-  handleSerialResponse();
-  delay(10);
+void CommandForwarder::onPollResponse(void* context, const HttpResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  if (response.result != FETCH_FAILED && forwarder->bootToReadyMs == 0) {
+    forwarder->bootToReadyMs = millis();
+    DLOG(forwarder->deferredLog, LOG_LEVEL_INFO, LOG_TAG_SYSTEM, "Ready %dms after boot", nullptr, forwarder->bootToReadyMs);
+  }
+  if (response.result != FETCH_OK) {
+    return;
+  }
+  
+  forwarder->receiveTelemetry();
+  bool loaded = forwarder->scriptEncoding == SCRIPT_ENCODING_BINARY
+                  ? forwarder->readPollImage(response.body, response.length)
+                  : forwarder->readPollJson(response.body, response.length);
+  if (!loaded) {
+    forwarder->pollEtag[0] = '\0';
+  }
 }
 
-void CommandForwarder::pollForCommands() {
-  String response = httpClient->get("/api/script/poll");
-  if (response.length() > 0) {
-    DynamicJsonDocument doc(4096);
-    deserializeJson(doc, response);
-
-    if (doc["arm1"]["hasNewScript"].as<bool>()) {
-      resetArmScript(arm1Script);
-      arm1Script.armId = "arm1";
-      arm1Script.format = doc["arm1"]["format"].as<String>();
-      
-      JsonArray commandArray = doc["arm1"]["commands"];
-      for (int i = 0; i < commandArray.size() && i < 50; i++) {
-        arm1Script.commands[i] = commandArray[i].as<String>();
-        arm1Script.commandCount++;
+bool CommandForwarder::readPollJson(const uint8_t* body, size_t length) {
+  JsonDocument& doc = jsonDoc;
+  DeserializationError error = deserializeJson(doc, (const char*)body, length, DeserializationOption::Filter(pollFilter));
+  if (error && error != DeserializationError::NoMemory) {
+    DLOG(deferredLog, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "JSON parse failed: %s", error.c_str());
+    return false;
+  }
+  
+  for (int i = 0; i < ARM_COUNT; i++) {
+    JsonObject armData = doc[arms[i].armName];
+    if (armData["hasNewScript"].as<bool>()) {
+      loadArmScript(i, armData);
+    }
+  }
+
+  ControlMessage control;
+  control.kind = CONTROL_RUN;
+  control.shouldStart = doc["shouldStart"].as<bool>();
+  controlQueue.push(control);
+  return true;
+}
+
+void CommandForwarder::loadArmScript(int armIndex, JsonObject armData) {
+  JsonArray commandArray = armData["commands"];
+  ScriptPage page;
+  ArmFeed& feed = stagedFeeds[armIndex];
+  startArmScript(armIndex, feed, armData["scriptId"] | "", armData["format"] | "",
+                 armData["totalCommands"] | (int)commandArray.size(), page);
+  decodeArmCommands(feed, page, commandArray);
+  publishPage(page);
+}
+
+// Polled scripts start in the arm's staged feed, which takes over the active
+// one once dispatch reports the promotion; a restored script starts active.
+void CommandForwarder::startArmScript(int armIndex, ArmFeed& feed, const char* scriptId, const char* format, int totalCommands, ScriptPage& page) {
+  resetArmFeed(feed);
+  snprintf(feed.scriptId, sizeof(feed.scriptId), "%s", scriptId);
+  feed.scriptToken = nextScriptToken++;
+  feed.commandCount = totalCommands;
+
+  page.armIndex = armIndex;
+  page.isNewScript = true;
+  page.isRestored = false;
+  page.scriptToken = feed.scriptToken;
+  page.commandCount = feed.commandCount;
+  page.offset = 0;
+  page.recordCount = 0;
+  page.textLength = 0;
+  memcpy(page.scriptId, feed.scriptId, sizeof(page.scriptId));
+  snprintf(page.format, sizeof(page.format), "%s", format);
+
+  if (!scriptCache.open(feed.cacheSlot, feed.scriptId, totalCommands, feed.cache)) {
+    scriptCache.beginWrite(feed.cacheSlot, feed.scriptId, format, totalCommands, feed.cache);
+  }
+}
+
+void CommandForwarder::startChunkPage(int armIndex, const ArmFeed& feed, ScriptPage& page) {
+  page.armIndex = armIndex;
+  page.isNewScript = false;
+  page.isRestored = false;
+  page.scriptToken = feed.scriptToken;
+  page.commandCount = feed.commandCount;
+  page.offset = feed.fetchedCount;
+  page.recordCount = 0;
+  page.textLength = 0;
+}
+
+static bool appendPageText(ScriptPage& page, CommandRecord& record, const char* text) {
+  if (page.textLength + record.textLength > SCRIPT_PAGE_TEXT_SIZE) {
+    return false;
+  }
+  memcpy(page.text + page.textLength, text, record.textLength);
+  record.textOffset = page.textLength;
+  page.textLength += record.textLength;
+  return true;
+}
+
+bool CommandForwarder::pageHasRoom(const ArmFeed& feed, const ScriptPage& page) {
+  return page.recordCount < SCRIPT_PAGE_SIZE && feed.fetchedCount < feed.commandCount &&
+         feed.fetchedCount - feed.consumedIndex < SCRIPT_WINDOW_SIZE;
+}
+
+int CommandForwarder::decodeArmCommands(ArmFeed& feed, ScriptPage& page, JsonArray commandArray) {
+  for (JsonVariant command : commandArray) {
+    if (!pageHasRoom(feed, page)) {
+      break;
+    }
+    const char* webCommand = command.as<const char*>();
+    CommandRecord& record = page.records[page.recordCount];
+    const char* text;
+    if (!CommandCodec::decode(webCommand ? webCommand : "", record, text)) {
+      DLOG(deferredLog, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "Cannot decode command %d: %s", webCommand, feed.fetchedCount + 1);
+    }
+    if (!appendPageText(page, record, text)) {
+      break;
+    }
+    page.recordCount++;
+    feed.fetchedCount++;
+    feed.fetchedText += record.textLength;
+  }
+  return page.recordCount;
+}
+
+bool CommandForwarder::readImageRecords(ScriptImageReader& reader, ArmFeed& feed, ScriptPage& page) {
+  uint32_t recordCount;
+  if (!reader.readVarint(recordCount)) {
+    return false;
+  }
+  
+  // Records past the first one that does not fit are skipped so the page
+  // stays contiguous; the next refill fetches them again.
+  bool full = false;
+  for (uint32_t i = 0; i < recordCount; i++) {
+    full = full || !pageHasRoom(feed, page);
+    if (full) {
+      if (!reader.skipRecord()) return false;
+      continue;
+    }
+    CommandRecord& record = page.records[page.recordCount];
+    const char* text;
+    if (!reader.readRecord(record, text)) {
+      return false;
+    }
+    if (!appendPageText(page, record, text)) {
+      full = true;
+      continue;
+    }
+    page.recordCount++;
+    feed.fetchedCount++;
+    feed.fetchedText += record.textLength;
+  }
+  return true;
+}
+
+bool CommandForwarder::readPollImage(const uint8_t* body, size_t length) {
+  ScriptImageReader reader(body, length);
+  uint8_t flags;
+  uint8_t armCount;
+  if (!reader.readHeader(SCRIPT_IMAGE_POLL) || !reader.readByte(flags) || !reader.readByte(armCount)) {
+    return false;
+  }
+  
+  ScriptPage page;
+  for (int a = 0; a < armCount; a++) {
+    char name[ARM_NAME_SIZE];
+    uint8_t hasNewScript;
+    if (!reader.readString(name, sizeof(name)) || !reader.readByte(hasNewScript)) {
+      return false;
+    }
+    if (!hasNewScript) {
+      continue;
+    }
+    
+    char scriptId[SCRIPT_ID_SIZE];
+    char format[SCRIPT_FORMAT_SIZE];
+    uint32_t totalCommands;
+    if (!reader.readString(scriptId, sizeof(scriptId)) || !reader.readString(format, sizeof(format)) ||
+        !reader.readVarint(totalCommands)) {
+      return false;
+    }
+    
+    int armIndex = findArm(name);
+    if (armIndex < 0) {
+      ArmFeed discard;
+      resetArmFeed(discard);
+      page.recordCount = 0;
+      if (!readImageRecords(reader, discard, page)) return false;
+      continue;
+    }
+    
+    ArmFeed& feed = stagedFeeds[armIndex];
+    startArmScript(armIndex, feed, scriptId, format, totalCommands, page);
+    if (!readImageRecords(reader, feed, page)) {
+      resetArmFeed(feed);
+      return false;
+    }
+    publishPage(page);
+  }
+  
+  ControlMessage control;
+  control.kind = CONTROL_RUN;
+  control.shouldStart = flags & SCRIPT_IMAGE_FLAG_START;
+  controlQueue.push(control);
+  return reader.isComplete();
+}
+
+bool CommandForwarder::readChunkImage(int armIndex, ArmFeed& feed, const uint8_t* body, size_t length) {
+  ScriptImageReader reader(body, length);
+  
+  char scriptId[SCRIPT_ID_SIZE];
+  uint32_t offset;
+  uint32_t totalCommands;
+  if (!reader.readHeader(SCRIPT_IMAGE_CHUNK) || !reader.readString(scriptId, sizeof(scriptId)) ||
+      !reader.readVarint(offset) || !reader.readVarint(totalCommands)) {
+    return false;
+  }
+  if (strcmp(scriptId, feed.scriptId) != 0 || (int)offset != feed.fetchedCount) {
+    return false;
+  }
+  
+  ScriptPage page;
+  startChunkPage(armIndex, feed, page);
+  if (!readImageRecords(reader, feed, page) || !reader.isComplete()) {
+    return false;
+  }
+  publishPage(page);
+  return true;
+}
+
+bool CommandForwarder::armWindowNeedsRefill(const ArmFeed& feed) {
+  if (feed.scriptToken == 0 || feed.fetchedCount >= feed.commandCount) {
+    return false;
+  }
+  if ((long)(millis() - feed.nextRefillTime) < 0) {
+    return false;
+  }
+  return SCRIPT_WINDOW_SIZE - (feed.fetchedCount - feed.consumedIndex) >= SCRIPT_PAGE_SIZE &&
+         SCRIPT_WINDOW_TEXT_SIZE - (feed.fetchedText - feed.consumedText) >= (unsigned long)SCRIPT_PAGE_TEXT_SIZE;
+}
+
+void CommandForwarder::refillArmWindow(int armIndex, ArmFeed& feed) {
+  const ArmScript& arm = arms[armIndex];
+  int freeSlots = SCRIPT_WINDOW_SIZE - (feed.fetchedCount - feed.consumedIndex);
+  int limit = freeSlots < SCRIPT_PAGE_SIZE ? freeSlots : SCRIPT_PAGE_SIZE;
+  String endpoint = "/api/script/chunk?armId=" + String(arm.armName) + "&scriptId=" + feed.scriptId +
+                    "&offset=" + String(feed.fetchedCount) + "&limit=" + String(limit);
+  if (scriptEncoding == SCRIPT_ENCODING_BINARY) {
+    endpoint += "&encoding=bin";
+  }
+
+  if (httpClient->request("GET", endpoint, nullptr, 0, nullptr, 0, onChunkResponse, this)) {
+    refillArm = armIndex;
+    refillToken = feed.scriptToken;
+  }
+}
+
+void CommandForwarder::onChunkResponse(void* context, const HttpResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  int armIndex = forwarder->refillArm;
+  forwarder->refillArm = -1;
+  ArmFeed* target = armIndex >= 0 ? forwarder->findFeed(armIndex, forwarder->refillToken) : nullptr;
+  if (!target) {
+    return;
+  }
+  
+  ArmFeed& feed = *target;
+  int fetchedBefore = feed.fetchedCount;
+  unsigned long fetchedTextBefore = feed.fetchedText;
+  bool loaded = false;
+  if (response.result == FETCH_OK) {
+    loaded = forwarder->scriptEncoding == SCRIPT_ENCODING_BINARY
+               ? forwarder->readChunkImage(armIndex, feed, response.body, response.length)
+               : forwarder->readChunkJson(armIndex, feed, response.body, response.length);
+  }
+  
+  if (loaded) {
+    feed.failedRefills = 0;
+    return;
+  }
+  
+  // A 409 means the server no longer has the script, so retrying cannot
+  // help; anything else is retried until it has failed too often in a row.
+  feed.fetchedCount = fetchedBefore;
+  feed.fetchedText = fetchedTextBefore;
+  feed.nextRefillTime = millis() + SCRIPT_REFILL_RETRY_MS;
+  feed.failedRefills++;
+  if (response.status == HTTP_CODE_CONFLICT) {
+    forwarder->failArmFeed(armIndex, feed, "Script gone from server");
+  } else if (feed.failedRefills >= SCRIPT_REFILL_MAX_FAILURES) {
+    forwarder->failArmFeed(armIndex, feed, "Script refill failed");
+  } else if (response.result == FETCH_OK) {
+    DLOG(forwarder->deferredLog, LOG_LEVEL_WARN, armIndex, "Discarded script chunk at offset %d", nullptr, feed.fetchedCount);
+  } else {
+    DLOG(forwarder->deferredLog, LOG_LEVEL_WARN, armIndex, "Script chunk at offset %d failed (%d in a row)", nullptr,
+         feed.fetchedCount, feed.failedRefills);
+  }
+}
+
+// Dispatch halts the script and the feed stops refilling. If the control
+// queue is full the feed stays as it is, and its next refill fails again.
+void CommandForwarder::failArmFeed(int armIndex, ArmFeed& feed, const char* reason) {
+  ControlMessage control;
+  control.kind = CONTROL_HALT_SCRIPT;
+  control.shouldStart = false;
+  control.armIndex = armIndex;
+  control.scriptToken = feed.scriptToken;
+  snprintf(control.message, sizeof(control.message), "%s at command %d", reason, feed.fetchedCount + 1);
+  if (!controlQueue.push(control)) {
+    return;
+  }
+  DLOG(deferredLog, LOG_LEVEL_ERROR, armIndex, "Giving up on script %s at offset %d", feed.scriptId, feed.fetchedCount);
+  resetArmFeed(feed);
+}
+
+bool CommandForwarder::readChunkJson(int armIndex, ArmFeed& feed, const uint8_t* body, size_t length) {
+  JsonDocument& doc = jsonDoc;
+  DeserializationError error = deserializeJson(doc, (const char*)body, length, DeserializationOption::Filter(chunkFilter));
+  if (error && error != DeserializationError::NoMemory) {
+    return false;
+  }
+  if (strcmp(doc["scriptId"] | "", feed.scriptId) != 0 || doc["offset"].as<int>() != feed.fetchedCount) {
+    return false;
+  }
+
+  ScriptPage page;
+  startChunkPage(armIndex, feed, page);
+  decodeArmCommands(feed, page, doc["commands"]);
+  publishPage(page);
+  return true;
+}
+
+// Pages that came over the network are appended to the arm's cache slot; if
+// the slot already holds this script the cursor just skips past them. A page
+// the queue refused never reaches the cache, so fetching it again cannot
+// store it twice.
+void CommandForwarder::publishPage(const ScriptPage& page) {
+  if (!queuePage(page)) {
+    return;
+  }
+  ArmFeed* feed = findFeed(page.armIndex, page.scriptToken);
+  if (feed && feed->cache.reading) {
+    size_t skipped = 0;
+    scriptCache.readRecords(feed->cacheSlot, feed->cache, nullptr, page.recordCount, nullptr, 0, skipped);
+  } else if (feed && feed->cache.writing && scriptCache.append(feed->cacheSlot, feed->cache, page.records, page.recordCount, page.text) &&
+             feed->fetchedCount >= feed->commandCount) {
+    scriptCache.commit(feed->cacheSlot, feed->cache);
+  }
+}
+
+// Producers check for a free slot before they fetch, so a full queue is rare;
+// a page it refuses is held and goes first once dispatch makes room. Should
+// the held slots be taken too, the feed is rewound to the dropped page and
+// fetches it again from the server; a dropped first page loses the script,
+// since dispatch would ignore the rest of it.
+bool CommandForwarder::queuePage(const ScriptPage& page) {
+  if (heldPageCount == 0 && pageQueue.push(page)) {
+    return true;
+  }
+  if (heldPageCount < ARM_COUNT) {
+    heldPages[heldPageCount++] = page;
+    return true;
+  }
+  
+  DLOG(deferredLog, LOG_LEVEL_ERROR, page.armIndex, "Page queue full, dropped page at offset %d", nullptr, page.offset);
+  ArmFeed* feed = findFeed(page.armIndex, page.scriptToken);
+  if (!feed) {
+    return false;
+  }
+  if (page.isNewScript) {
+    DLOG(deferredLog, LOG_LEVEL_ERROR, page.armIndex, "Dropped new script %s", page.scriptId);
+    resetArmFeed(*feed);
+    return false;
+  }
+  feed->fetchedCount = page.offset;
+  feed->fetchedText -= page.textLength;
+  feed->nextRefillTime = millis() + SCRIPT_REFILL_RETRY_MS;
+  if (feed->cache.reading) {
+    // The cursor has already read past the page.
+    scriptCache.close(feed->cache);
+  }
+  return false;
+}
+
+bool CommandForwarder::releaseHeldPages() {
+  int released = 0;
+  while (released < heldPageCount && pageQueue.push(heldPages[released])) {
+    released++;
+  }
+  for (int i = released; i < heldPageCount; i++) {
+    heldPages[i - released] = heldPages[i];
+  }
+  heldPageCount -= released;
+  return heldPageCount == 0;
+}
+
+// No arm has commands left to run, so a flash write cannot hold one up.
+bool CommandForwarder::armsIdle() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    const ArmFeed& active = armFeeds[i];
+    if (active.scriptToken != 0 && active.consumedIndex < active.commandCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CommandForwarder::flushScriptCache() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmFeed* feeds[] = { &armFeeds[i], &stagedFeeds[i] };
+    for (ArmFeed* feed : feeds) {
+      if (feed->cache.writing) {
+        scriptCache.flush(feed->cacheSlot, feed->cache);
       }
-      
-      arm1Script.isActive = true;
-      logArmActivity("arm1", "New script loaded: " + String(arm1Script.commandCount) + " commands");
-    }
-
-    if (doc["arm2"]["hasNewScript"].as<bool>()) {
-      resetArmScript(arm2Script);
-      arm2Script.armId = "arm2";
-      arm2Script.format = doc["arm2"]["format"].as<String>();
-      
-      JsonArray commandArray = doc["arm2"]["commands"];
-      for (int i = 0; i < commandArray.size() && i < 50; i++) {
-        arm2Script.commands[i] = commandArray[i].as<String>();
-        arm2Script.commandCount++;
+    }
+  }
+}
+
+void CommandForwarder::refillFromCache(int armIndex, ArmFeed& feed) {
+  int freeSlots = SCRIPT_WINDOW_SIZE - (feed.fetchedCount - feed.consumedIndex);
+  int limit = freeSlots < SCRIPT_PAGE_SIZE ? freeSlots : SCRIPT_PAGE_SIZE;
+  
+  ScriptPage page;
+  startChunkPage(armIndex, feed, page);
+  size_t textLength = 0;
+  int count = scriptCache.readRecords(feed.cacheSlot, feed.cache, page.records, limit, page.text, sizeof(page.text), textLength);
+  if (count <= 0) {
+    scriptCache.close(feed.cache);
+    feed.nextRefillTime = millis() + SCRIPT_REFILL_RETRY_MS;
+    DLOG(deferredLog, LOG_LEVEL_WARN, armIndex, "Script cache unreadable at offset %d, using server", nullptr, feed.fetchedCount);
+    return;
+  }
+  page.recordCount = count;
+  page.textLength = textLength;
+  feed.fetchedCount += count;
+  feed.fetchedText += textLength;
+  queuePage(page);
+}
+
+// Where the arm stopped is not known, so a script that ran to its end stays
+// on flash for the cache but is not restored, and one cut short is restored
+// to wait for an explicit start, from its first command.
+void CommandForwarder::restoreCachedScripts() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ScriptCacheHeader header;
+    if (!scriptCache.load(arms[i].armName, header) || scriptCache.isComplete(arms[i].armName, header)) {
+      continue;
+    }
+    
+    ScriptPage page;
+    ArmFeed& feed = armFeeds[i];
+    startArmScript(i, feed, header.scriptId, header.format, header.commandCount, page);
+    page.isRestored = true;
+    size_t textLength = 0;
+    int count = feed.cache.reading ? scriptCache.readRecords(feed.cacheSlot, feed.cache, page.records, SCRIPT_PAGE_SIZE,
+                                                             page.text, sizeof(page.text), textLength) : -1;
+    if (count < 0) {
+      resetArmFeed(feed);
+      continue;
+    }
+    page.recordCount = count;
+    page.textLength = textLength;
+    feed.fetchedCount = count;
+    feed.fetchedText = textLength;
+    queuePage(page);
+    DLOG(deferredLog, LOG_LEVEL_INFO, i, "Restored script %s from flash, %d commands", header.scriptId, header.commandCount);
+  }
+}
+
+ArmFeed* CommandForwarder::findFeed(int armIndex, uint32_t scriptToken) {
+  if (scriptToken == 0) {
+    return nullptr;
+  }
+  if (armFeeds[armIndex].scriptToken == scriptToken) {
+    return &armFeeds[armIndex];
+  }
+  return stagedFeeds[armIndex].scriptToken == scriptToken ? &stagedFeeds[armIndex] : nullptr;
+}
+
+// The staged feed, and its cache slot, take over the active one. The active
+// slot keeps the arm's name so a restart restores the job that was running.
+void CommandForwarder::promoteArmFeed(int armIndex) {
+  ArmFeed& active = armFeeds[armIndex];
+  ArmFeed& staged = stagedFeeds[armIndex];
+  scriptCache.promote(staged.cacheSlot, active.cacheSlot);
+  
+  char slot[CACHE_SLOT_SIZE];
+  memcpy(slot, active.cacheSlot, sizeof(slot));
+  active = staged;
+  memcpy(active.cacheSlot, slot, sizeof(slot));
+  resetArmFeed(staged);
+}
+
+// The histograms belong to the dispatch task; reading them from here can mix
+// a sample or two across buckets, which is fine for a periodic report.
+void CommandForwarder::uploadLatency() {
+  size_t length = buildLatencyReport(latencyReport, sizeof(latencyReport));
+  if (length > 0) {
+    httpClient->request("POST", "/api/telemetry/latency", (const uint8_t*)latencyReport, length, nullptr, 0, nullptr, nullptr);
+  }
+}
+
+static size_t appendSummary(char* buffer, size_t size, size_t length, const char* name, const LatencySummary& summary) {
+  int written = snprintf(buffer + length, size - length, "\"%s\":{\"count\":%lu,\"p50\":%lu,\"p95\":%lu,\"p99\":%lu,\"max\":%lu},",
+                         name, summary.count, summary.p50, summary.p95, summary.p99, summary.max);
+  return written > 0 && (size_t)written < size - length ? length + written : size;
+}
+
+static size_t appendText(char* buffer, size_t size, size_t length, const char* text) {
+  int written = snprintf(buffer + length, size - length, "%s", text);
+  return written > 0 && (size_t)written < size - length ? length + written : size;
+}
+
+// Replaces a trailing comma, if any, with the closing text.
+static size_t closeObject(char* buffer, size_t size, size_t length, const char* text) {
+  if (length < size && length > 0 && buffer[length - 1] == ',') {
+    length--;
+  }
+  return length < size ? appendText(buffer, size, length, text) : size;
+}
+
+// {"uptimeMs":..,"arms":{"arm1":{"firstByte":{count,p50,p95,p99,max},..}},
+//  "opcodes":{"MOVE":{..}}} with microsecond values; empty histograms skipped.
+size_t CommandForwarder::buildLatencyReport(char* buffer, size_t size) {
+  size_t length = 0;
+  char prefix[48];
+  snprintf(prefix, sizeof(prefix), "{\"uptimeMs\":%lu,\"arms\":{", (unsigned long)millis());
+  length = appendText(buffer, size, length, prefix);
+  
+  for (int i = 0; i < ARM_COUNT && length < size; i++) {
+    snprintf(prefix, sizeof(prefix), "\"%s\":{", arms[i].armName);
+    length = appendText(buffer, size, length, prefix);
+    for (int m = 0; m < LATENCY_METRIC_COUNT && length < size; m++) {
+      length = appendSummary(buffer, size, length, LatencyHistogram::metricName(m), arms[i].latency[m].summarize());
+    }
+    length = closeObject(buffer, size, length, "},");
+  }
+  length = closeObject(buffer, size, length, "},\"opcodes\":{");
+  
+  for (int op = CMD_MOVE; op < CMD_OPCODE_COUNT && length < size; op++) {
+    if (opcodeLatency[op][LATENCY_DISPATCH].summarize().count == 0 && opcodeLatency[op][LATENCY_ACK].summarize().count == 0) {
+      continue;
+    }
+    snprintf(prefix, sizeof(prefix), "\"%s\":{", CommandCodec::opcodeName(op));
+    length = appendText(buffer, size, length, prefix);
+    for (int m = 0; m < LATENCY_METRIC_COUNT && length < size; m++) {
+      length = appendSummary(buffer, size, length, LatencyHistogram::metricName(m), opcodeLatency[op][m].summarize());
+    }
+    length = closeObject(buffer, size, length, "},");
+  }
+  length = closeObject(buffer, size, length, "}}");
+  
+  if (length >= size) {
+    DLOG(deferredLog, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "Latency report exceeds %d bytes", nullptr, size);
+    return 0;
+  }
+  return length;
+}
+
+// Batches go out between script refills so they never hold up the arms. A
+// batch the server did not take is retried; meanwhile the dispatch ring keeps
+// absorbing records and sheds the lowest priority ones once it is full. A
+// batch too big for one payload goes out over several, in order, before the
+// next one is taken.
+bool CommandForwarder::uploadTelemetry() {
+  if (telemetryPayloadLength == 0) {
+    if (uploadBatchSent >= uploadBatch.recordCount) {
+      if (!batchQueue.pop(uploadBatch)) {
+        return false;
       }
-      
-      arm2Script.isActive = true;
-      logArmActivity("arm2", "New script loaded: " + String(arm2Script.commandCount) + " commands");
+      uploadBatchSent = 0;
+    }
+    int written = 0;
+    telemetryPayloadLength = buildTelemetryBatch(uploadBatch, uploadBatchSent, written, telemetryPayload, sizeof(telemetryPayload));
+    telemetryPayloadRecords = written;
+    uploadBatchSent += written;
+    if (telemetryPayloadLength == 0) {
+      return false;
+    }
+  }
+  if ((long)(millis() - nextTelemetryUpload) < 0) {
+    return false;
+  }
+  return httpClient->request("POST", "/api/telemetry/batch", (const uint8_t*)telemetryPayload, telemetryPayloadLength,
+                             nullptr, 0, onTelemetryUploaded, this);
+}
+
+void CommandForwarder::onTelemetryUploaded(void* context, const HttpResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  TelemetryUploadStats& stats = forwarder->telemetryUploads;
+  if (response.result == FETCH_OK) {
+    stats.batches++;
+    stats.records += forwarder->telemetryPayloadRecords;
+    forwarder->telemetryPayloadLength = 0;
+  } else if (response.status >= 400 && response.status < 500) {
+    stats.rejected++;
+    forwarder->telemetryPayloadLength = 0;
+    DLOG(forwarder->deferredLog, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "Telemetry batch rejected: HTTP %d", nullptr, response.status);
+  } else {
+    stats.failures++;
+    forwarder->nextTelemetryUpload = millis() + TELEMETRY_RETRY_MS;
+  }
+}
+
+static size_t appendEscaped(char* buffer, size_t size, size_t length, const char* text) {
+  for (; *text && length < size; text++) {
+    char escaped[8] = { *text, '\0' };
+    if (*text == '"' || *text == '\\') {
+      snprintf(escaped, sizeof(escaped), "\\%c", *text);
+    } else if ((uint8_t)*text < 0x20) {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", *text);
     }
+    length = appendText(buffer, size, length, escaped);
+  }
+  return length;
+}
 
-    bool shouldStart = doc["shouldStart"].as<bool>();
-    if (shouldStart && !isRunning) {
+// {"records":[{"kind":"completion","arm":"arm1",
+//  "first":..,"last":..,"count":..,"timeMs":..},{"kind":"error","arm":"arm1",
+//  "index":..,"total":..,"timeMs":..,"text":".."}],"dropped":..,"uptimeMs":..}
+// from batch.records[first] on, as many as fit; written is set to how many.
+// dropped is the ring's running total.
+size_t CommandForwarder::buildTelemetryBatch(const TelemetryBatch& batch, int first, int& written, char* buffer, size_t size) {
+  const size_t reserve = 80;
+  if (size <= reserve) {
+    return 0;
+  }
+  size_t limit = size - reserve;
+  size_t length = appendText(buffer, limit, 0, "{\"records\":[");
+  written = 0;
+  
+  for (; first + written < batch.recordCount; written++) {
+    const TelemetryRecord& record = batch.records[first + written];
+    size_t start = length;
+    char entry[128];
+    if (record.kind == TELEMETRY_COMPLETION) {
+      snprintf(entry, sizeof(entry), "{\"kind\":\"%s\",\"arm\":\"%s\",\"first\":%d,\"last\":%d,\"count\":%u,\"timeMs\":%lu",
+               TelemetryRing::kindName(record.kind), getArmName(record.armIndex), record.firstIndex, record.lastIndex,
+               (unsigned)record.count, record.timeMs);
+    } else {
+      snprintf(entry, sizeof(entry), "{\"kind\":\"%s\",\"arm\":\"%s\",\"index\":%d,\"total\":%d,\"timeMs\":%lu",
+               TelemetryRing::kindName(record.kind), getArmName(record.armIndex), record.firstIndex, record.lastIndex, record.timeMs);
+    }
+    length = appendText(buffer, limit, length, entry);
+    if (record.text[0] && length < limit) {
+      length = appendText(buffer, limit, length, ",\"text\":\"");
+      length = appendEscaped(buffer, limit, length, record.text);
+      length = appendText(buffer, limit, length, "\"");
+    }
+    length = length < limit ? appendText(buffer, limit, length, "},") : limit;
+    if (length >= limit) {
+      length = start;
+      break;
+    }
+  }
+  
+  char trailer[reserve];
+  snprintf(trailer, sizeof(trailer), "],\"dropped\":%lu,\"uptimeMs\":%lu}", batch.dropped, (unsigned long)millis());
+  length = closeObject(buffer, size, length, trailer);
+  return length < size ? length : 0;
+}
+
+void CommandForwarder::receiveTelemetry() {
+  ArmTelemetry telemetry;
+  while (telemetryQueue.pop(telemetry)) {
+    if (telemetry.scriptToken == stagedFeeds[telemetry.armIndex].scriptToken && telemetry.scriptToken != 0) {
+      promoteArmFeed(telemetry.armIndex);
+    }
+    ArmFeed& feed = armFeeds[telemetry.armIndex];
+    if (telemetry.scriptToken == feed.scriptToken && telemetry.currentIndex > feed.consumedIndex) {
+      feed.consumedIndex = telemetry.currentIndex;
+      feed.consumedText = telemetry.releasedText;
+    }
+    if (feed.scriptToken != 0 && feed.consumedIndex >= feed.commandCount && !feed.markedComplete) {
+      feed.markedComplete = true;
+      scriptCache.markComplete(feed.cacheSlot);
+    }
+  }
+}
+
+void CommandForwarder::dispatchStep() {
+  receivePages();
+  receiveControl();
+  
+  routeResponses();
+  promoteStagedScripts();
+  
+  if (isRunning) {
+    processNextCommand();
+  }
+  
+  for (int i = 0; i < ARM_COUNT; i++) {
+    publishTelemetry(i);
+  }
+  flushTelemetry();
+}
+
+void CommandForwarder::receiveControl() {
+  ControlMessage control;
+  while (controlQueue.pop(control)) {
+    if (control.kind == CONTROL_HALT_SCRIPT) {
+      haltArmScript(arms[control.armIndex], control.scriptToken, control.message);
+      continue;
+    }
+    if (!control.shouldStart) {
+      releaseRestoredScripts();
+    }
+    if (control.shouldStart && !isRunning) {
       isRunning = true;
-      Serial.println("Starting dual-arm execution");
-    } else if (!shouldStart && isRunning) {
+      DLOG(deferredLog, LOG_LEVEL_INFO, LOG_TAG_SYSTEM, "Starting dual-arm execution", nullptr);
+    } else if (!control.shouldStart && isRunning) {
       isRunning = false;
-      Serial.println("Stopping dual-arm execution");
+      DLOG(deferredLog, LOG_LEVEL_INFO, LOG_TAG_SYSTEM, "Stopping dual-arm execution", nullptr);
     }
   }
 }
 
-void CommandForwarder::processNextCommand() {
-  if (!isRunning) return;
+// A server that still says start after a reset is left over from before it,
+// so a restored script only runs once the server has said stop.
+void CommandForwarder::releaseRestoredScripts() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmScript& arm = arms[i];
+    if (arm.awaitingStart) {
+      arm.awaitingStart = false;
+      DLOG(deferredLog, LOG_LEVEL_INFO, arm.armIndex, "Restored script %s runs on the next start", arm.scriptId);
+    }
+  }
+}
+
+// A staged script is dropped before it runs. A running one stops sending;
+// commands the arm already has still complete.
+void CommandForwarder::haltArmScript(ArmScript& arm, uint32_t scriptToken, const char* message) {
+  if (scriptToken == arm.staged.scriptToken) {
+    arm.staged.scriptToken = 0;
+    arm.staged.loadedCount = 0;
+    arm.staged.text.reset();
+  } else if (scriptToken == arm.scriptToken && arm.isActive) {
+    arm.isActive = false;
+  } else {
+    return;
+  }
+  
+  arm.status.hasError = true;
+  setArmError(arm, message);
+  reportEvent(arm, TELEMETRY_ERROR, arm.currentIndex, message);
+  DLOG(deferredLog, LOG_LEVEL_ERROR, arm.armIndex, "Halted: %s", message);
+}
+
+void CommandForwarder::receivePages() {
+  ScriptPage page;
+  while (pageQueue.pop(page)) {
+    storeScriptPage(page);
+  }
+}
+
+void CommandForwarder::storeScriptPage(const ScriptPage& page) {
+  ArmScript& arm = arms[page.armIndex];
   
-  bool arm1Active = arm1Script.isActive && arm1Script.currentIndex < arm1Script.commandCount;
-  bool arm2Active = arm2Script.isActive && arm2Script.currentIndex < arm2Script.commandCount;
+  if (page.isNewScript || page.scriptToken == arm.staged.scriptToken) {
+    stageScriptPage(page);
+    return;
+  }
+  if (page.scriptToken != arm.scriptToken || page.offset != arm.loadedCount) {
+    return;
+  }
   
-  if (arm1Active) {
-    processArmCommands(arm1Script, arm1Master);
+  for (int i = 0; i < page.recordCount && arm.loadedCount - arm.currentIndex < SCRIPT_WINDOW_SIZE; i++) {
+    CommandRecord& record = arm.commands[arm.loadedCount % SCRIPT_WINDOW_SIZE];
+    record = page.records[i];
+    if (!arm.text.append(record, page.text + page.records[i].textOffset)) {
+      failTextWindow(arm, page.scriptToken, arm.loadedCount);
+      return;
+    }
+    arm.loadedCount++;
   }
+}
+
+// The network side only fetches what the text window has room for, so this
+// means the two disagree. The rest of the page is lost and no later page can
+// follow on, so the script is halted rather than left waiting for it.
+void CommandForwarder::failTextWindow(ArmScript& arm, uint32_t scriptToken, int index) {
+  char message[ERROR_MESSAGE_SIZE];
+  snprintf(message, sizeof(message), "Command text window full at command %d", index + 1);
+  haltArmScript(arm, scriptToken, message);
+}
+
+void CommandForwarder::stageScriptPage(const ScriptPage& page) {
+  ArmScript& arm = arms[page.armIndex];
+  StagedScript& staged = arm.staged;
   
-  if (arm2Active) {
-    processArmCommands(arm2Script, arm2Master);
+  if (page.isNewScript) {
+    if (staged.scriptToken != 0) {
+      arm.swaps.replaced++;
+      DLOG(deferredLog, LOG_LEVEL_INFO, arm.armIndex, "Staged script %s replaced before it ran", staged.scriptId);
+    }
+    staged.scriptToken = page.scriptToken;
+    staged.isRestored = page.isRestored;
+    staged.commandCount = page.commandCount;
+    staged.loadedCount = 0;
+    staged.text.reset();
+    memcpy(staged.scriptId, page.scriptId, sizeof(staged.scriptId));
+    memcpy(staged.format, page.format, sizeof(staged.format));
+  } else if (page.offset != staged.loadedCount) {
+    return;
   }
   
-  if (!arm1Active && !arm2Active) {
-    isRunning = false;
-    Serial.println("All dual-arm commands completed");
+  for (int i = 0; i < page.recordCount && staged.loadedCount < SCRIPT_WINDOW_SIZE; i++) {
+    CommandRecord& record = staged.commands[staged.loadedCount];
+    record = page.records[i];
+    if (!staged.text.append(record, page.text + page.records[i].textOffset)) {
+      failTextWindow(arm, staged.scriptToken, staged.loadedCount);
+      return;
+    }
+    staged.loadedCount++;
+  }
+  
+  if (page.isNewScript) {
+    DLOG(deferredLog, LOG_LEVEL_INFO, arm.armIndex, "Staged script %s: %d commands, %d buffered", staged.scriptId, staged.commandCount, staged.loadedCount);
+  }
+  if (canPromote(arm)) {
+    promoteStagedScript(arm);
+  }
+}
+
+void CommandForwarder::promoteStagedScripts() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    if (canPromote(arms[i])) {
+      promoteStagedScript(arms[i]);
+    }
   }
 }
 
-void CommandForwarder::processArmCommands(ArmScript& arm, SerialBridge* serialBridge) {
-  if (!arm.isActive || arm.currentIndex >= arm.commandCount) {
+// A job boundary: the current script ran to completion or halted, or the
+// system is stopped, in which case a new script replaces the current one, as
+// it does one restored from flash that has not been started.
+bool CommandForwarder::canPromote(const ArmScript& arm) {
+  if (arm.staged.scriptToken == 0) {
+    return false;
+  }
+  if (!isRunning || !arm.isActive || arm.awaitingStart) {
+    return true;
+  }
+  return arm.currentIndex >= arm.commandCount && arm.pipeline.count == 0;
+}
+
+// The staged window lands at ring positions 0..loadedCount-1, which is where
+// a fresh script starts. resetArmScript clears completedMicros, so the idle
+// time between jobs never counts as dispatch latency.
+void CommandForwarder::promoteStagedScript(ArmScript& arm) {
+  StagedScript& staged = arm.staged;
+  
+  resetArmScript(arm);
+  arm.scriptId = arm.arena.copyString(staged.scriptId, SCRIPT_ID_SIZE);
+  arm.format = arm.arena.copyString(staged.format, SCRIPT_FORMAT_SIZE);
+  arm.errorMark = arm.arena.mark();
+  arm.scriptToken = staged.scriptToken;
+  arm.commandCount = staged.commandCount;
+  memcpy(arm.commands, staged.commands, staged.loadedCount * sizeof(CommandRecord));
+  arm.text = staged.text;
+  arm.loadedCount = staged.loadedCount;
+  arm.isActive = true;
+  arm.awaitingStart = staged.isRestored;
+  arm.telemetryDirty = true;
+  
+  staged.scriptToken = 0;
+  staged.loadedCount = 0;
+  staged.text.reset();
+  arm.swaps.promotions++;
+  arm.swaps.lastPromotionMs = millis();
+  arm.swaps.lastBuffered = arm.loadedCount;
+  reportEvent(arm, TELEMETRY_SCRIPT, 0, arm.scriptId);
+  DLOG(deferredLog, LOG_LEVEL_INFO, arm.armIndex, "Promoted script %s: %d commands, %d buffered", arm.scriptId, arm.commandCount, arm.loadedCount);
+}
+
+void CommandForwarder::publishTelemetry(int armIndex) {
+  ArmScript& arm = arms[armIndex];
+  if (!arm.telemetryDirty) {
     return;
   }
   
-  if (arm.status.isExecuting) {
-    if (millis() - arm.status.startTime > arm.status.timeout) {
-      arm.status.hasError = true;
-      arm.status.errorMessage = "Command timeout";
-      arm.status.isExecuting = false;
-      logArmActivity(arm.armId, "Command timeout at index " + String(arm.currentIndex));
-    } else {
-      if (serialBridge->hasResponse()) {
-        String response = serialBridge->readResponse();
-        if (response.startsWith("OK") || response.startsWith("DONE")) {
-          arm.status.isExecuting = false;
-          arm.status.isComplete = true;
-          arm.currentIndex++;
-          logArmActivity(arm.armId, "Command completed: " + response);
-        } else if (response.startsWith("ERROR")) {
-          arm.status.isExecuting = false;
-          arm.status.hasError = true;
-          arm.status.errorMessage = response;
-          logArmActivity(arm.armId, "Command failed: " + response);
-        }
-      }
+  ArmTelemetry telemetry;
+  telemetry.armIndex = armIndex;
+  telemetry.scriptToken = arm.scriptToken;
+  telemetry.currentIndex = arm.currentIndex;
+  telemetry.releasedText = arm.releasedText;
+  if (telemetryQueue.push(telemetry)) {
+    arm.telemetryDirty = false;
+  }
+}
+
+void CommandForwarder::reportEvent(const ArmScript& arm, TelemetryKind kind, int index, const char* text) {
+  TelemetryRecord record;
+  record.kind = kind;
+  record.armIndex = arm.armIndex;
+  record.count = 1;
+  record.firstIndex = index;
+  record.lastIndex = kind == TELEMETRY_COMPLETION ? index : arm.commandCount;
+  record.timeMs = millis();
+  snprintf(record.text, sizeof(record.text), "%.*s", (int)sizeof(record.text) - 1, text ? text : "");
+  telemetryRing.add(record);
+}
+
+// The ring goes to the network task once enough records are pending or the
+// first of them has waited TELEMETRY_FLUSH_INTERVAL_MS. While both batch slots
+// are still waiting on the network the records stay here and coalesce.
+void CommandForwarder::flushTelemetry() {
+  unsigned long now = millis();
+  int pending = telemetryRing.size();
+  if (pending == 0) {
+    lastTelemetryFlush = now;
+    return;
+  }
+  if ((pending < TELEMETRY_FLUSH_RECORDS && now - lastTelemetryFlush < TELEMETRY_FLUSH_INTERVAL_MS) || batchQueue.freeSlots() == 0) {
+    return;
+  }
+  
+  TelemetryRingStats stats = telemetryRing.getStats();
+  outgoingBatch.dropped = 0;
+  for (int k = 0; k < TELEMETRY_KIND_COUNT; k++) {
+    outgoingBatch.dropped += stats.dropped[k];
+  }
+  outgoingBatch.recordCount = telemetryRing.drain(outgoingBatch.records, TELEMETRY_RING_SIZE);
+  batchQueue.push(outgoingBatch);
+  lastTelemetryFlush = now;
+}
+
+void CommandForwarder::processNextCommand() {
+  if (!isRunning) return;
+  
+  bool anyActive = false;
+  for (int i = 0; i < ARM_COUNT; i++) {
+    ArmScript& arm = arms[i];
+    if (arm.isActive && arm.currentIndex < arm.commandCount) {
+      processArmCommands(arm);
+      anyActive = true;
     }
+  }
+  
+  if (!anyActive) {
+    isRunning = false;
+    DLOG(deferredLog, LOG_LEVEL_INFO, LOG_TAG_SYSTEM, "All arm commands completed", nullptr);
+  }
+}
+
+void CommandForwarder::processArmCommands(ArmScript& arm) {
+  if (!arm.isActive || arm.awaitingStart || arm.currentIndex >= arm.commandCount) {
     return;
   }
   
-  String webCommand = arm.commands[arm.currentIndex];
-  String uartCommand = convertToUARTProtocol(webCommand, arm.armId);
+  if (arm.pipeline.count > 0 && millis() - arm.status.startTime > arm.status.timeout) {
+    DLOG(deferredLog, LOG_LEVEL_ERROR, arm.armIndex, "Command timeout at index %d", nullptr, arm.currentIndex);
+    failArmPipeline(arm, "Command timeout");
+    return;
+  }
   
-  if (uartCommand.length() > 0) {
-    Serial.println("Converting: " + webCommand + " -> " + uartCommand);
-    if (serialBridge->sendCommand(uartCommand)) {
-      arm.status.isExecuting = true;
-      arm.status.isComplete = false;
-      arm.status.hasError = false;
-      arm.status.startTime = millis();
-      arm.status.timeout = 10000;
-      
-      logArmActivity(arm.armId, "Started command " + String(arm.currentIndex + 1) + "/" + String(arm.commandCount) + ": " + webCommand);
-    } else {
-      arm.status.hasError = true;
-      arm.status.errorMessage = "UART send failed";
-      logArmActivity(arm.armId, "UART send failed for: " + webCommand);
+  if (arm.status.hasError && (long)(millis() - arm.status.retryTime) < 0) {
+    return;
+  }
+  
+  while (arm.isActive && arm.nextIndex < arm.loadedCount && arm.pipeline.count < availableCredits(arm)) {
+    if (!sendArmCommand(arm)) {
+      break;
     }
   }
 }
 
-void CommandForwarder::handleSerialResponse() {
-  if (arm1Master->hasResponse()) {
-    String response = arm1Master->readResponse();
-    logArmActivity("arm1", "Response: " + response);
+bool CommandForwarder::sendArmCommand(ArmScript& arm) {
+  const CommandRecord& record = arm.commands[arm.nextIndex % SCRIPT_WINDOW_SIZE];
+  if (record.opcode == CMD_INVALID) {
+    if (arm.pipeline.count == 0) {
+      arm.status.hasError = true;
+      char message[ERROR_MESSAGE_SIZE];
+      snprintf(message, sizeof(message), "Invalid command at index %d", arm.nextIndex);
+      setArmError(arm, message);
+      arm.isActive = false;
+      reportEvent(arm, TELEMETRY_ERROR, arm.nextIndex, message);
+      DLOG(deferredLog, LOG_LEVEL_ERROR, arm.armIndex, "Halted on invalid command %d/%d", nullptr, arm.nextIndex + 1, arm.commandCount);
+    }
+    return false;
   }
   
-  if (arm2Master->hasResponse()) {
-    String response = arm2Master->readResponse();
-    logArmActivity("arm2", "Response: " + response);
+  CommandPipeline& pipeline = arm.pipeline;
+  uint16_t sequence = pipeline.nextSequence;
+  if (!armMasters[arm.armIndex]->sendRecord(record, arm.text.at(record), arm.armName, sequence, pipeline.depth > 1)) {
+    arm.status.hasError = true;
+    setArmError(arm, "UART send failed");
+    arm.status.retryTime = millis() + COMMAND_RETRY_DELAY_MS;
+    DLOG(deferredLog, LOG_LEVEL_WARN, arm.armIndex, "UART send failed for command %d", nullptr, arm.nextIndex + 1);
+    return false;
   }
+  
+  recordDispatchLatency(arm, record.opcode);
+  
+  InFlightCommand& entry = pipeline.entries[(pipeline.head + pipeline.count) % PIPELINE_MAX_DEPTH];
+  entry.sequence = sequence;
+  entry.opcode = record.opcode;
+  entry.responded = false;
+  entry.index = arm.nextIndex;
+  entry.sentTime = millis();
+  entry.sentMicros = micros();
+  if (pipeline.count == 0) {
+    arm.status.startTime = entry.sentTime;
+  }
+  pipeline.count++;
+  pipeline.nextSequence++;
+  arm.nextIndex++;
+  
+  arm.status.isExecuting = true;
+  arm.status.isComplete = false;
+  arm.status.hasError = false;
+  arm.status.timeout = 10000;
+  
+  DLOG(deferredLog, LOG_LEVEL_DEBUG, arm.armIndex, "Started command %d/%d: %s", CommandCodec::opcodeName(record.opcode), entry.index + 1, arm.commandCount);
+  return true;
 }
 
-String CommandForwarder::convertToUARTProtocol(String webCommand, String armId) {
-  String uartCommand = armId + ":";
+void CommandForwarder::handleArmResponse(ArmScript& arm, const SerialResponse& response) {
+  CommandPipeline& pipeline = arm.pipeline;
   
-  if (webCommand.startsWith("MOVE:X")) {
-    uartCommand += "X:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("MOVE:Y")) {
-    uartCommand += "Y:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("MOVE:Z")) {
-    uartCommand += "Z:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("MOVE:T")) {
-    uartCommand += "T:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("MOVE:G")) {
-    uartCommand += "G:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("GROUP:")) {
-    uartCommand += "GROUP:" + webCommand.substring(6);
-  } else if (webCommand.startsWith("WAIT:")) {
-    uartCommand += "WAIT:" + webCommand.substring(5);
-  } else if (webCommand.startsWith("ZERO")) {
-    uartCommand += "ZERO";
-  } else if (webCommand.startsWith("HOME")) {
-    uartCommand += "HOME";
-  } else if (webCommand.startsWith("SPEED:")) {
-    uartCommand += "SPEED:" + webCommand.substring(6);
-  } else {
-    uartCommand += "RAW:" + webCommand;
+  if (pipeline.count == 0) {
+    arm.responses.stray++;
+    DLOG(deferredLog, LOG_LEVEL_WARN, arm.armIndex, "Unexpected response: %s", response.text);
+    return;
   }
   
-  return uartCommand;
+  if (response.type == RESPONSE_OK || response.type == RESPONSE_DONE) {
+    if ((pipeline.depth > 1 || response.hasSequence) &&
+        (!response.hasSequence || response.sequence != pipeline.entries[pipeline.head].sequence)) {
+      DLOG(deferredLog, LOG_LEVEL_ERROR, arm.armIndex, "Out-of-order acknowledgement: %s", response.text);
+      failArmPipeline(arm, "Out-of-order acknowledgement");
+      return;
+    }
+    const InFlightCommand& head = pipeline.entries[pipeline.head];
+    recordLatency(arm, head.opcode, LATENCY_ACK, micros() - head.sentMicros);
+    reportEvent(arm, TELEMETRY_COMPLETION, head.index, nullptr);
+    
+    const CommandRecord& record = arm.commands[head.index % SCRIPT_WINDOW_SIZE];
+    arm.text.release(record);
+    arm.releasedText += record.textLength;
+    
+    pipeline.head = (pipeline.head + 1) % PIPELINE_MAX_DEPTH;
+    pipeline.count--;
+    if (response.credits >= 0) {
+      pipeline.reportsCredits = true;
+      pipeline.window = pipeline.count + response.credits;
+      if (pipeline.window > pipeline.queueLimit) {
+        pipeline.window = pipeline.queueLimit;
+      }
+    } else if (!pipeline.reportsCredits && pipeline.window < pipeline.queueLimit) {
+      pipeline.window++;
+    }
+    arm.currentIndex++;
+    arm.telemetryDirty = true;
+    arm.status.completedMicros = micros();
+    arm.status.startTime = millis();
+    arm.status.isExecuting = pipeline.count > 0;
+    arm.status.isComplete = pipeline.count == 0;
+    DLOG(deferredLog, LOG_LEVEL_DEBUG, arm.armIndex, "Command completed: %s", response.text);
+    if (arm.currentIndex >= arm.commandCount) {
+      reportEvent(arm, TELEMETRY_SCRIPT, arm.currentIndex, arm.scriptId);
+    }
+  } else if (response.type == RESPONSE_ERROR) {
+    int accepted = 0;
+    if (response.hasSequence) {
+      while (accepted < pipeline.count &&
+             pipeline.entries[(pipeline.head + accepted) % PIPELINE_MAX_DEPTH].sequence != response.sequence) {
+        accepted++;
+      }
+      if (accepted == pipeline.count) {
+        arm.responses.stray++;
+        DLOG(deferredLog, LOG_LEVEL_WARN, arm.armIndex, "Error for a command already resent: %s", response.text);
+        return;
+      }
+      // Rejected on arrival behind commands the arm took: its queue is full.
+      if (accepted > 0 && response.credits <= 0) {
+        pipeline.queueLimit = accepted;
+      }
+    } else if (pipeline.count > 1) {
+      // No way to tell which command was rejected: stop pipelining this arm.
+      pipeline.queueLimit = 1;
+    }
+    DLOG(deferredLog, LOG_LEVEL_ERROR, arm.armIndex, "Command failed: %s", response.text);
+    failArmPipeline(arm, response.text, accepted);
+  }
+}
+
+// The first accepted commands in flight were taken by the arm before it
+// rejected the next one, so they stay in the pipeline and only the rejected
+// command onwards is sent again. An arm that faults drops its queue and
+// rejects the head, so everything in flight is resent.
+void CommandForwarder::failArmPipeline(ArmScript& arm, const char* message, int accepted) {
+  CommandPipeline& pipeline = arm.pipeline;
+  pipeline.count = accepted;
+  if (accepted == 0) {
+    pipeline.head = 0;
+    pipeline.window = 1;
+  } else {
+    pipeline.window = accepted;
+  }
+  arm.nextIndex = arm.currentIndex + accepted;
+  arm.status.isExecuting = accepted > 0;
+  arm.status.hasError = true;
+  setArmError(arm, message);
+  arm.status.retryTime = millis() + COMMAND_RETRY_DELAY_MS;
+  reportEvent(arm, TELEMETRY_ERROR, arm.nextIndex, message);
+}
+
+void CommandForwarder::setArmError(ArmScript& arm, const char* message) {
+  arm.arena.rewind(arm.errorMark);
+  arm.status.errorMessage = arm.arena.copyString(message, ERROR_MESSAGE_SIZE - 1);
+}
+
+int CommandForwarder::availableCredits(const ArmScript& arm) {
+  int credits = arm.pipeline.window < arm.pipeline.depth ? arm.pipeline.window : arm.pipeline.depth;
+  return credits > 0 ? credits : 1;
+}
+
+void CommandForwarder::routeResponses() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    routers[i].route();
+  }
+}
+
+void CommandForwarder::onArmCompletion(void* context, uint8_t armIndex, const SerialResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  forwarder->handleArmResponse(forwarder->arms[armIndex], response);
+}
+
+void CommandForwarder::onArmInfo(void* context, uint8_t armIndex, const SerialResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  ArmScript& arm = forwarder->arms[armIndex];
+  DLOG(forwarder->deferredLog, LOG_LEVEL_DEBUG, armIndex, "Response: %s", response.text);
+  forwarder->reportEvent(arm, TELEMETRY_POSITION, arm.currentIndex, response.text);
+}
+
+// Subscribed ahead of the completion handler so the head command is still in
+// flight when its first response arrives.
+void CommandForwarder::onArmFirstByte(void* context, uint8_t armIndex, const SerialResponse& response) {
+  CommandForwarder* forwarder = static_cast<CommandForwarder*>(context);
+  ArmScript& arm = forwarder->arms[armIndex];
+  if (arm.pipeline.count == 0) {
+    return;
+  }
+  InFlightCommand& head = arm.pipeline.entries[arm.pipeline.head];
+  if (!head.responded) {
+    head.responded = true;
+    forwarder->recordLatency(arm, head.opcode, LATENCY_FIRST_BYTE, response.firstByteMicros - head.sentMicros);
+  }
+}
+
+void CommandForwarder::onArmTelemetry(void* context, uint8_t armIndex, const SerialResponse& response) {
+  ResponseStats& stats = static_cast<CommandForwarder*>(context)->arms[armIndex].responses;
+  switch (response.type) {
+    case RESPONSE_OK: stats.ok++; break;
+    case RESPONSE_DONE: stats.done++; break;
+    case RESPONSE_ERROR: stats.error++; break;
+    default: stats.info++; break;
+  }
 }
 
 void CommandForwarder::resetArmScript(ArmScript& arm) {
   arm.commandCount = 0;
+  arm.loadedCount = 0;
+  arm.text.reset();
+  arm.releasedText = 0;
   arm.currentIndex = 0;
+  arm.nextIndex = 0;
+  arm.pipeline.head = 0;
+  arm.pipeline.count = 0;
+  arm.pipeline.depth = pipelineDepth;
+  arm.pipeline.window = 1;
+  arm.pipeline.reportsCredits = false;
+  arm.arena.reset();
+  arm.errorMark = 0;
+  arm.scriptId = "";
   arm.format = "";
+  arm.scriptToken = 0;
   arm.isActive = false;
+  arm.awaitingStart = false;
+  arm.telemetryDirty = false;
   arm.status.isExecuting = false;
   arm.status.isComplete = false;
   arm.status.hasError = false;
   arm.status.errorMessage = "";
   arm.status.startTime = 0;
   arm.status.timeout = 5000;
+  arm.status.retryTime = 0;
+  arm.status.completedMicros = 0;
+}
+
+void CommandForwarder::resetArmFeed(ArmFeed& feed) {
+  feed.scriptId[0] = '\0';
+  feed.scriptToken = 0;
+  feed.commandCount = 0;
+  feed.fetchedCount = 0;
+  feed.consumedIndex = 0;
+  feed.fetchedText = 0;
+  feed.consumedText = 0;
+  feed.nextRefillTime = 0;
+  feed.failedRefills = 0;
+  feed.markedComplete = false;
+  scriptCache.close(feed.cache);
 }
 
-void CommandForwarder::logArmActivity(const String& armId, const String& message) {
-  Serial.println("[" + armId.toUpperCase() + "] " + message);
+void CommandForwarder::recordLatency(ArmScript& arm, uint8_t opcode, LatencyMetric metric, unsigned long micros) {
+  arm.latency[metric].record(micros);
+  if (opcode < CMD_OPCODE_COUNT) {
+    opcodeLatency[opcode][metric].record(micros);
+  }
+}
+
+void CommandForwarder::recordDispatchLatency(ArmScript& arm, uint8_t opcode) {
+  if (arm.status.completedMicros == 0) {
+    return;
+  }
+  
+  unsigned long latency = micros() - arm.status.completedMicros;
+  recordLatency(arm, opcode, LATENCY_DISPATCH, latency);
+  arm.status.completedMicros = 0;
+  arm.dispatch.samples++;
+  arm.dispatch.lastLatencyUs = latency;
+  if (latency > arm.dispatch.maxLatencyUs) {
+    arm.dispatch.maxLatencyUs = latency;
+  }
+}
+
+// Runs on the network task (or in update() before the tasks start), so a
+// full Serial TX FIFO can delay a refill or upload but never a dispatch.
+void CommandForwarder::drainLog(int maxEntries) {
+  LogEntry entry;
+  char line[LOG_LINE_SIZE];
+  for (int i = 0; i < maxEntries && deferredLog.pop(entry); i++) {
+    size_t length = 0;
+    if (entry.tag < ARM_COUNT) {
+      length = snprintf(line, sizeof(line), "[%s] ", arms[entry.tag].logTag);
+    }
+    DeferredLog::format(entry, line + length, sizeof(line) - length);
+    Serial.println(line);
+  }
+  
+  unsigned long drops = deferredLog.getDropped();
+  if (drops != reportedLogDrops) {
+    Serial.println("Log ring full, " + String(drops - reportedLogDrops) + " entries dropped");
+    reportedLogDrops = drops;
+  }
 }
 
 bool CommandForwarder::isWifiConnected() {
-  return WiFi.status() == WL_CONNECTED;
+  return wifiLink.isConnected();
 }
 
 void CommandForwarder::printStatus() {
   Serial.println("WiFi: " + String(isWifiConnected() ? "Connected" : "Disconnected"));
   Serial.println("System: " + String(isRunning ? "Running" : "Idle"));
-  Serial.println("Arm1: " + String(arm1Script.commandCount) + " commands, Index: " + String(arm1Script.currentIndex));
-  Serial.println("Arm2: " + String(arm2Script.commandCount) + " commands, Index: " + String(arm2Script.currentIndex));
+  for (int i = 0; i < ARM_COUNT; i++) {
+    Serial.println(String(arms[i].logTag) + ": " + String(arms[i].commandCount) + " commands, Index: " + String(arms[i].currentIndex));
+  }
 }
 
 void CommandForwarder::printDetailedStatus() {
-  Serial.println("=== ESP32 Dual-Arm UART Status ===");
+  Serial.println("=== ESP32 Multi-Arm UART Status ===");
   Serial.println("WiFi: " + String(isWifiConnected() ? "Connected" : "Disconnected"));
   Serial.println("System: " + String(isRunning ? "Running" : "Idle"));
-  
-  Serial.println("--- ARM1 Status ---");
-  Serial.println("  Commands: " + String(arm1Script.commandCount));
-  Serial.println("  Progress: " + String(arm1Script.currentIndex) + "/" + String(arm1Script.commandCount));
-  Serial.println("  Active: " + String(arm1Script.isActive ? "Yes" : "No"));
-  Serial.println("  Executing: " + String(arm1Script.status.isExecuting ? "Yes" : "No"));
-  if (arm1Script.status.hasError) {
-    Serial.println("  Error: " + arm1Script.status.errorMessage);
+  WifiStats wifi = wifiLink.getStats();
+  ScriptCacheStats cache = scriptCache.getStats();
+  Serial.println("WiFi link: " + String(wifi.connects) + " connects (" + String(wifi.fastConnects) + " cached AP), " + String(wifi.disconnects) + " drops, " + String(wifi.failedAttempts) + " failed, last " + String(wifi.lastConnectMs) + "ms");
+  Serial.println("Boot to ready: " + (bootToReadyMs > 0 ? String(bootToReadyMs) + "ms" : String("pending")) + ", associated at " + String(wifi.associatedAtMs) + "ms");
+  Serial.println("Script cache: " + String(cache.hits) + " hits, " + String(cache.commits) + " stored, " + String(cache.failures) + " failed, " + String(cache.bytesWritten) + " bytes written");
+  Serial.println("Heap: " + String(ScriptArena::freeHeap()) + " free, largest block " + String(ScriptArena::largestHeapBlock()));
+  if (httpClient) {
+    HttpStats http = httpClient->getStats();
+    unsigned long averageUs = http.requests > 0 ? (unsigned long)(http.totalLatencyUs / http.requests) : 0;
+    Serial.println("HTTP: " + String(http.requests) + " requests, " + String(http.notModified) + " not modified, " + String(http.failures) + " failed, " + String(http.reusedConnections) + " reused, " + String(http.reconnects) + " reconnects, " + String(http.dnsLookups) + " DNS lookups");
+    Serial.println("HTTP latency: last " + String(http.lastLatencyUs) + "us, avg " + String(averageUs) + "us, max " + String(http.maxLatencyUs) + "us");
   }
+  TelemetryRingStats ring = telemetryRing.getStats();
+  Serial.println("Telemetry: " + String(telemetryUploads.batches) + " batches, " + String(telemetryUploads.records) + " records, " + String(ring.coalesced) + " coalesced, " + String(telemetryUploads.failures) + " retried, " + String(telemetryUploads.rejected) + " rejected");
+  Serial.println("Telemetry dropped: " + String(ring.dropped[TELEMETRY_POSITION]) + " position, " + String(ring.dropped[TELEMETRY_COMPLETION]) + " completion, " + String(ring.dropped[TELEMETRY_SCRIPT]) + " script, " + String(ring.dropped[TELEMETRY_ERROR]) + " error");
   
-  Serial.println("--- ARM2 Status ---");
-  Serial.println("  Commands: " + String(arm2Script.commandCount));
-  Serial.println("  Progress: " + String(arm2Script.currentIndex) + "/" + String(arm2Script.commandCount));
-  Serial.println("  Active: " + String(arm2Script.isActive ? "Yes" : "No"));
-  Serial.println("  Executing: " + String(arm2Script.status.isExecuting ? "Yes" : "No"));
-  if (arm2Script.status.hasError) {
-    Serial.println("  Error: " + arm2Script.status.errorMessage);
+  for (int i = 0; i < ARM_COUNT; i++) {
+    printArmStatus(arms[i]);
   }
   
   Serial.println("========================");
 }
 
-bool CommandForwarder::isArmActive(const String& armId) {
-  if (armId == "arm1") {
-    return arm1Script.isActive;
-  } else if (armId == "arm2") {
-    return arm2Script.isActive;
+void CommandForwarder::printArmStatus(const ArmScript& arm) {
+  Serial.println("--- " + String(arm.logTag) + " Status ---");
+  Serial.println("  Commands: " + String(arm.commandCount));
+  Serial.println("  Progress: " + String(arm.currentIndex) + "/" + String(arm.commandCount));
+  Serial.println("  Buffered: " + String(arm.loadedCount - arm.currentIndex) + "/" + String(SCRIPT_WINDOW_SIZE));
+  Serial.println("  Active: " + String(arm.isActive ? "Yes" : "No"));
+  Serial.println("  Executing: " + String(arm.status.isExecuting ? "Yes" : "No") + " (" + String(arm.pipeline.count) + "/" + String(arm.pipeline.depth) + " in flight)");
+  Serial.println("  Dispatch latency: last " + String(arm.dispatch.lastLatencyUs) + "us, max " + String(arm.dispatch.maxLatencyUs) + "us");
+  Serial.println("  Responses: " + String(arm.responses.ok) + " ok, " + String(arm.responses.done) + " done, " + String(arm.responses.error) + " error, " + String(arm.responses.info) + " info, " + String(arm.responses.stray) + " unexpected");
+  if (arm.staged.scriptToken != 0) {
+    Serial.println("  Staged: " + String(arm.staged.scriptId) + ", " + String(arm.staged.loadedCount) + "/" + String(arm.staged.commandCount) + " buffered");
   }
-  return false;
+  Serial.println("  Swaps: " + String(arm.swaps.promotions) + " promoted, " + String(arm.swaps.replaced) + " replaced while staged");
+  for (int m = 0; m < LATENCY_METRIC_COUNT; m++) {
+    LatencySummary latency = arm.latency[m].summarize();
+    Serial.println("  Latency " + String(LatencyHistogram::metricName(m)) + ": " + String(latency.count) + " samples, p50 " + String(latency.p50) + "us, p95 " + String(latency.p95) + "us, p99 " + String(latency.p99) + "us, max " + String(latency.max) + "us");
+  }
+  ArenaStats arena = arm.arena.getStats();
+  Serial.println("  Arena: " + String(arena.used) + "/" + String(arena.capacity) + " bytes, high water " + String(arena.highWater) + ", failed " + String(arena.failedAllocations));
+  if (arm.status.hasError) {
+    Serial.println("  Error: " + String(arm.status.errorMessage));
+  }
+}
+
+int CommandForwarder::findArm(const String& armName) {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    if (armName == arms[i].armName) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int CommandForwarder::getArmCount() {
+  return ARM_COUNT;
+}
+
+const char* CommandForwarder::getArmName(int armIndex) {
+  return armIndex >= 0 && armIndex < ARM_COUNT ? arms[armIndex].armName : "";
+}
+
+bool CommandForwarder::isArmActive(int armIndex) {
+  return armIndex >= 0 && armIndex < ARM_COUNT && arms[armIndex].isActive;
 }
 
-int CommandForwarder::getArmProgress(const String& armId) {
-  ArmScript* arm = nullptr;
-  if (armId == "arm1") {
-    arm = &arm1Script;
-  } else if (armId == "arm2") {
-    arm = &arm2Script;
+bool CommandForwarder::isArmActive(const String& armName) {
+  return isArmActive(findArm(armName));
+}
+
+int CommandForwarder::getArmProgress(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) {
+    return 0;
   }
   
-  if (arm && arm->commandCount > 0) {
-    return (arm->currentIndex * 100) / arm->commandCount;
+  const ArmScript& arm = arms[armIndex];
+  if (arm.commandCount > 0) {
+    return (arm.currentIndex * 100) / arm.commandCount;
   }
   return 0;
 }
 
-String CommandForwarder::getArmStatus(const String& armId) {
-  ArmScript* arm = nullptr;
-  if (armId == "arm1") {
-    arm = &arm1Script;
-  } else if (armId == "arm2") {
-    arm = &arm2Script;
-  }
-  
-  if (!arm) return "UNKNOWN";
+int CommandForwarder::getArmProgress(const String& armName) {
+  return getArmProgress(findArm(armName));
+}
+
+String CommandForwarder::getArmStatus(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) return "UNKNOWN";
   
-  if (arm->status.hasError) {
-    return "ERROR: " + arm->status.errorMessage;
-  } else if (arm->status.isExecuting) {
+  const ArmScript& arm = arms[armIndex];
+  if (arm.status.hasError) {
+    return "ERROR: " + String(arm.status.errorMessage);
+  } else if (arm.status.isExecuting) {
     return "EXECUTING";
-  } else if (arm->isActive && arm->currentIndex < arm->commandCount) {
+  } else if (arm.awaitingStart) {
+    return "AWAITING START";
+  } else if (arm.isActive && arm.currentIndex < arm.commandCount) {
     return "READY";
-  } else if (arm->currentIndex >= arm->commandCount) {
+  } else if (arm.currentIndex >= arm.commandCount) {
     return "COMPLETED";
   } else {
     return "IDLE";
   }
+}
+
+String CommandForwarder::getArmStatus(const String& armName) {
+  return getArmStatus(findArm(armName));
+}
+
+DispatchStats CommandForwarder::getArmDispatchStats(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) {
+    return DispatchStats();
+  }
+  return arms[armIndex].dispatch;
+}
+
+DispatchStats CommandForwarder::getArmDispatchStats(const String& armName) {
+  return getArmDispatchStats(findArm(armName));
+}
+
+ResponseStats CommandForwarder::getArmResponseStats(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) {
+    return ResponseStats();
+  }
+  return arms[armIndex].responses;
+}
+
+LatencySummary CommandForwarder::getArmLatency(int armIndex, LatencyMetric metric) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT || metric >= LATENCY_METRIC_COUNT) {
+    return LatencySummary();
+  }
+  return arms[armIndex].latency[metric].summarize();
+}
+
+LatencySummary CommandForwarder::getOpcodeLatency(uint8_t opcode, LatencyMetric metric) {
+  if (opcode >= CMD_OPCODE_COUNT || metric >= LATENCY_METRIC_COUNT) {
+    return LatencySummary();
+  }
+  return opcodeLatency[opcode][metric].summarize();
+}
+
+void CommandForwarder::resetLatency() {
+  for (int i = 0; i < ARM_COUNT; i++) {
+    for (int m = 0; m < LATENCY_METRIC_COUNT; m++) {
+      arms[i].latency[m].reset();
+    }
+  }
+  for (int op = 0; op < CMD_OPCODE_COUNT; op++) {
+    for (int m = 0; m < LATENCY_METRIC_COUNT; m++) {
+      opcodeLatency[op][m].reset();
+    }
+  }
+}
+
+SwapStats CommandForwarder::getArmSwapStats(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) {
+    return SwapStats();
+  }
+  return arms[armIndex].swaps;
+}
+
+HttpStats CommandForwarder::getHttpStats() {
+  return httpClient ? httpClient->getStats() : HttpStats();
+}
+
+ArenaStats CommandForwarder::getArmArenaStats(int armIndex) {
+  if (armIndex < 0 || armIndex >= ARM_COUNT) {
+    return ArenaStats();
+  }
+  return arms[armIndex].arena.getStats();
+}
+
+bool CommandForwarder::setPipelineDepth(int depth) {
+  if (isRunning || depth < 1 || depth > PIPELINE_MAX_DEPTH) {
+    return false;
+  }
+  for (int i = 0; i < ARM_COUNT; i++) {
+    if (arms[i].pipeline.count > 0) {
+      return false;
+    }
+  }
+  
+  pipelineDepth = depth;
+  for (int i = 0; i < ARM_COUNT; i++) {
+    arms[i].pipeline.depth = depth;
+  }
+  return true;
+}
+
+int CommandForwarder::getPipelineDepth() {
+  return pipelineDepth;
+}
+
+void CommandForwarder::setBinaryProtocol(bool enabled) {
+  binaryProtocol = enabled;
+}
+
+void CommandForwarder::setStaticIp(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns) {
+  wifiLink.setStaticIp(ip, gateway, subnet, dns);
+}
+
+WifiStats CommandForwarder::getWifiStats() {
+  return wifiLink.getStats();
+}
+
+ScriptCacheStats CommandForwarder::getScriptCacheStats() {
+  return scriptCache.getStats();
+}
+
+TelemetryRingStats CommandForwarder::getTelemetryRingStats() {
+  return telemetryRing.getStats();
+}
+
+TelemetryUploadStats CommandForwarder::getTelemetryUploadStats() {
+  return telemetryUploads;
+}
+
+unsigned long CommandForwarder::getDroppedLogEntries() {
+  return deferredLog.getDropped();
+}
+
+unsigned long CommandForwarder::getBootToReadyMs() {
+  return bootToReadyMs;
+}
+
+void CommandForwarder::setScriptEncoding(ScriptEncoding encoding) {
+  if (encoding != scriptEncoding) {
+    scriptEncoding = encoding;
+    pollEtag[0] = '\0';
+  }
 }
\ No newline at end of file
@@ -1,64 +1,418 @@
 #ifndef COMMAND_FORWARDER_H
 #define COMMAND_FORWARDER_H
 
+#include "CommandCodec.h"
+#include "CommandText.h"
+#include "DeferredLog.h"
 #include "HttpClient.h"
+#include "LatencyHistogram.h"
+#include "ResponseRouter.h"
+#include "ScriptArena.h"
+#include "ScriptCache.h"
+#include "ScriptImage.h"
 #include "SerialBridge.h"
+#include "SpscQueue.h"
+#include "TaskRunner.h"
+#include "TelemetryRing.h"
+#include "WifiLink.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
 
+static const int SCRIPT_WINDOW_SIZE = 32;
+static const int SCRIPT_PAGE_SIZE = 16;
+static const int SCRIPT_PAGE_TEXT_SIZE = 512;
+static const int SCRIPT_WINDOW_TEXT_SIZE = 1024;
+static const unsigned long SCRIPT_REFILL_RETRY_MS = 500;
+static const int SCRIPT_REFILL_MAX_FAILURES = 20;
+static const unsigned long COMMAND_RETRY_DELAY_MS = 500;
+static const int PIPELINE_MAX_DEPTH = 16;
+static const int ARM_COUNT = 2;
+static const int ARM_NAME_SIZE = 8;
+static const int CACHE_SLOT_SIZE = ARM_NAME_SIZE + 8;
+static const int PAGE_QUEUE_SIZE = 4;
+static const int CONTROL_QUEUE_SIZE = 4;
+static const int TELEMETRY_QUEUE_SIZE = 8;
+static const unsigned long POLL_INTERVAL_MS = 2000;
+static const unsigned long NETWORK_TASK_INTERVAL_MS = 5;
+static const unsigned long DISPATCH_TASK_INTERVAL_MS = 1;
+static const int SCRIPT_ID_SIZE = 48;
+static const int SCRIPT_FORMAT_SIZE = 16;
+static const int ERROR_MESSAGE_SIZE = 64;
+static const size_t JSON_DOCUMENT_SIZE = 4096;
+static const size_t JSON_FILTER_SIZE = 384;
+static const char* const SCRIPT_CACHE_ROOT = "/scripts";
+static const unsigned long LATENCY_UPLOAD_INTERVAL_MS = 30000;
+static const size_t LATENCY_REPORT_SIZE = 3072;
+static const int TELEMETRY_BATCH_QUEUE_SIZE = 2;
+static const int TELEMETRY_FLUSH_RECORDS = 16;
+static const unsigned long TELEMETRY_FLUSH_INTERVAL_MS = 1000;
+static const unsigned long TELEMETRY_RETRY_MS = 2000;
+static const size_t TELEMETRY_PAYLOAD_SIZE = 4096;
+static const int LOG_DRAIN_BATCH = 16;
+static const unsigned long IDLE_LOOP_INTERVAL_MS = 20;
+
+// One row per palletizing cell. The name is the script key on the server and
+// the command prefix on the wire; the index into this table is the arm id.
+struct ArmPortConfig {
+  const char* name;
+  HardwareSerial* port;
+  int rxPin;
+  int txPin;
+};
+
+extern const ArmPortConfig ARM_PORTS[ARM_COUNT];
+
+enum ScriptEncoding : uint8_t {
+  SCRIPT_ENCODING_JSON,
+  SCRIPT_ENCODING_BINARY
+};
+
 struct CommandStatus {
   bool isExecuting;
   bool isComplete;
   bool hasError;
-  String errorMessage;
+  const char* errorMessage;
   unsigned long startTime;
   unsigned long timeout;
+  unsigned long retryTime;
+  unsigned long completedMicros;
 };
 
+struct DispatchStats {
+  unsigned long samples;
+  unsigned long lastLatencyUs;
+  unsigned long maxLatencyUs;
+};
+
+struct ResponseStats {
+  unsigned long info;
+  unsigned long ok;
+  unsigned long done;
+  unsigned long error;
+  unsigned long stray;
+};
+
+struct SwapStats {
+  unsigned long promotions;
+  unsigned long replaced;
+  unsigned long lastPromotionMs;
+  int lastBuffered;
+};
+
+struct InFlightCommand {
+  uint16_t sequence;
+  uint8_t opcode;
+  bool responded;
+  int index;
+  unsigned long sentTime;
+  unsigned long sentMicros;
+};
+
+// With depth > 1 commands go out as "arm1:X:100#<seq>" and the arm master
+// acknowledges each one in order with "OK#<seq>" or "DONE#<seq>", optionally
+// followed by "/<n>" to advertise how many more commands it can queue, and
+// rejects one with "ERROR...#<seq>". Binary ports carry the same sequence and
+// credit fields inside the frame.
+//
+// The arm's queue depth is not known up front, so window starts at one
+// command and follows the credits the arm reports. An arm that reports none
+// gets one more command per acknowledgement. Either way window stays within
+// queueLimit, which a "queue full" rejection lowers to what the arm had
+// accepted.
+struct CommandPipeline {
+  InFlightCommand entries[PIPELINE_MAX_DEPTH];
+  int head;
+  int count;
+  int depth;
+  int window;
+  int queueLimit;
+  bool reportsCredits;
+  uint16_t nextSequence;
+};
+
+// A window holds at most SCRIPT_WINDOW_TEXT_SIZE bytes of command text; the
+// feed only fetches another page once that much is free.
+typedef CommandText<SCRIPT_WINDOW_TEXT_SIZE + COMMAND_TEXT_MAX> WindowText;
+
+// The next job of an arm. It fills from the network while the current job
+// runs and is promoted in one step once the arm reaches a job boundary.
+struct StagedScript {
+  CommandRecord commands[SCRIPT_WINDOW_SIZE];
+  WindowText text;
+  int commandCount;
+  int loadedCount;
+  uint32_t scriptToken;
+  bool isRestored;
+  char scriptId[SCRIPT_ID_SIZE];
+  char format[SCRIPT_FORMAT_SIZE];
+};
+
+// awaitingStart holds back a script restored from flash after a reset until
+// the server has been seen stopped and started again.
 struct ArmScript {
-  String commands[50];
+  CommandRecord commands[SCRIPT_WINDOW_SIZE];
+  WindowText text;
+  unsigned long releasedText;
   int commandCount;
+  int loadedCount;
   int currentIndex;
-  String armId;
-  String format;
+  int nextIndex;
+  uint8_t armIndex;
+  const char* armName;
+  char logTag[ARM_NAME_SIZE];
+  const char* scriptId;
+  const char* format;
+  ScriptArena arena;
+  size_t errorMark;
+  uint32_t scriptToken;
   bool isActive;
+  bool awaitingStart;
+  bool telemetryDirty;
   CommandStatus status;
+  CommandPipeline pipeline;
+  StagedScript staged;
+  DispatchStats dispatch;
+  ResponseStats responses;
+  SwapStats swaps;
+  LatencyHistogram latency[LATENCY_METRIC_COUNT];
+};
+
+// Producer-side view of an arm's script, owned by the network task. It only
+// learns how far dispatch has progressed through ArmTelemetry messages.
+struct ArmFeed {
+  char scriptId[SCRIPT_ID_SIZE];
+  uint32_t scriptToken;
+  int commandCount;
+  int fetchedCount;
+  int consumedIndex;
+  unsigned long fetchedText;
+  unsigned long consumedText;
+  unsigned long nextRefillTime;
+  int failedRefills;
+  bool markedComplete;
+  char cacheSlot[CACHE_SLOT_SIZE];
+  ScriptCacheCursor cache;
+};
+
+struct ScriptPage {
+  uint8_t armIndex;
+  bool isNewScript;
+  bool isRestored;
+  uint32_t scriptToken;
+  int commandCount;
+  int offset;
+  int recordCount;
+  char scriptId[SCRIPT_ID_SIZE];
+  char format[SCRIPT_FORMAT_SIZE];
+  CommandRecord records[SCRIPT_PAGE_SIZE];
+  int textLength;
+  char text[SCRIPT_PAGE_TEXT_SIZE];
+};
+
+enum ControlKind : uint8_t {
+  CONTROL_RUN,
+  CONTROL_HALT_SCRIPT
+};
+
+// CONTROL_RUN carries the server's shouldStart. CONTROL_HALT_SCRIPT stops the
+// script scriptToken on armIndex, staged or running, because the network task
+// can no longer fetch the rest of it; message is reported as the arm's error.
+struct ControlMessage {
+  ControlKind kind;
+  bool shouldStart;
+  uint8_t armIndex;
+  uint32_t scriptToken;
+  char message[ERROR_MESSAGE_SIZE];
+};
+
+struct ArmTelemetry {
+  uint8_t armIndex;
+  uint32_t scriptToken;
+  int currentIndex;
+  unsigned long releasedText;
+};
+
+// Records drained from the dispatch task's ring in one go. dropped is the
+// running total since boot so the server can tell when it missed records.
+struct TelemetryBatch {
+  int recordCount;
+  unsigned long dropped;
+  TelemetryRecord records[TELEMETRY_RING_SIZE];
+};
+
+struct TelemetryUploadStats {
+  unsigned long batches;
+  unsigned long records;
+  unsigned long failures;
+  unsigned long rejected;
 };
 
 class CommandForwarder {
 private:
   HttpClient* httpClient;
-  SerialBridge* arm1Master;
-  SerialBridge* arm2Master;
+  WifiLink wifiLink;
+  ScriptCache scriptCache;
+  SerialBridge* armMasters[ARM_COUNT];
+  ResponseRouter routers[ARM_COUNT];
+  DeferredLog deferredLog;
+  unsigned long reportedLogDrops;
   
   bool isRunning;
   unsigned long lastPollTime;
-  unsigned long lastCommandTime;
+  int pipelineDepth;
+  bool binaryProtocol;
+  uint32_t nextScriptToken;
+  char pollEtag[HTTP_ETAG_SIZE];
+  unsigned long bootToReadyMs;
+  int refillArm;
+  uint32_t refillToken;
+  ScriptEncoding scriptEncoding;
+  DynamicJsonDocument jsonDoc;
+  DynamicJsonDocument pollFilter;
+  DynamicJsonDocument chunkFilter;
   
-  ArmScript arm1Script;
-  ArmScript arm2Script;
+  ArmScript arms[ARM_COUNT];
+  LatencyHistogram opcodeLatency[CMD_OPCODE_COUNT][LATENCY_METRIC_COUNT];
+  char latencyReport[LATENCY_REPORT_SIZE];
+  unsigned long lastLatencyUpload;
+  TelemetryRing telemetryRing;
+  TelemetryBatch outgoingBatch;
+  unsigned long lastTelemetryFlush;
+  TelemetryBatch uploadBatch;
+  int uploadBatchSent;
+  char telemetryPayload[TELEMETRY_PAYLOAD_SIZE];
+  size_t telemetryPayloadLength;
+  int telemetryPayloadRecords;
+  unsigned long nextTelemetryUpload;
+  TelemetryUploadStats telemetryUploads;
+  ArmFeed armFeeds[ARM_COUNT];
+  ArmFeed stagedFeeds[ARM_COUNT];
   
+  SpscQueue<ScriptPage, PAGE_QUEUE_SIZE> pageQueue;
+  ScriptPage heldPages[ARM_COUNT];
+  int heldPageCount;
+  SpscQueue<ControlMessage, CONTROL_QUEUE_SIZE> controlQueue;
+  SpscQueue<ArmTelemetry, TELEMETRY_QUEUE_SIZE> telemetryQueue;
+  SpscQueue<TelemetryBatch, TELEMETRY_BATCH_QUEUE_SIZE> batchQueue;
+  
+  std::atomic<bool> tasksStarted;
+  std::atomic<bool> stopRequested;
+  TaskRunner networkRunner;
+  TaskRunner dispatchRunner;
+  
+  static void networkTask(void* context);
+  static void dispatchTask(void* context);
+  static void onArmCompletion(void* context, uint8_t armIndex, const SerialResponse& response);
+  static void onArmInfo(void* context, uint8_t armIndex, const SerialResponse& response);
+  static void onArmTelemetry(void* context, uint8_t armIndex, const SerialResponse& response);
+  static void onArmFirstByte(void* context, uint8_t armIndex, const SerialResponse& response);
+  
+  void networkStep();
   void pollForCommands();
+  static void onPollResponse(void* context, const HttpResponse& response);
+  static void onChunkResponse(void* context, const HttpResponse& response);
+  bool readPollJson(const uint8_t* body, size_t length);
+  bool readChunkJson(int armIndex, ArmFeed& feed, const uint8_t* body, size_t length);
+  void loadArmScript(int armIndex, JsonObject armData);
+  void startArmScript(int armIndex, ArmFeed& feed, const char* scriptId, const char* format, int totalCommands, ScriptPage& page);
+  void startChunkPage(int armIndex, const ArmFeed& feed, ScriptPage& page);
+  bool pageHasRoom(const ArmFeed& feed, const ScriptPage& page);
+  int decodeArmCommands(ArmFeed& feed, ScriptPage& page, JsonArray commandArray);
+  bool readImageRecords(ScriptImageReader& reader, ArmFeed& feed, ScriptPage& page);
+  bool readPollImage(const uint8_t* body, size_t length);
+  bool readChunkImage(int armIndex, ArmFeed& feed, const uint8_t* body, size_t length);
+  void refillArmWindow(int armIndex, ArmFeed& feed);
+  void refillFromCache(int armIndex, ArmFeed& feed);
+  void failArmFeed(int armIndex, ArmFeed& feed, const char* reason);
+  ArmFeed* findFeed(int armIndex, uint32_t scriptToken);
+  void promoteArmFeed(int armIndex);
+  void restoreCachedScripts();
+  void publishPage(const ScriptPage& page);
+  bool queuePage(const ScriptPage& page);
+  bool releaseHeldPages();
+  bool armsIdle();
+  void flushScriptCache();
+  bool armWindowNeedsRefill(const ArmFeed& feed);
+  void receiveTelemetry();
+  void uploadLatency();
+  size_t buildLatencyReport(char* buffer, size_t size);
+  bool uploadTelemetry();
+  static void onTelemetryUploaded(void* context, const HttpResponse& response);
+  size_t buildTelemetryBatch(const TelemetryBatch& batch, int first, int& written, char* buffer, size_t size);
+  
+  void dispatchStep();
+  void receiveControl();
+  void releaseRestoredScripts();
+  void haltArmScript(ArmScript& arm, uint32_t scriptToken, const char* message);
+  void receivePages();
+  void storeScriptPage(const ScriptPage& page);
+  void stageScriptPage(const ScriptPage& page);
+  void failTextWindow(ArmScript& arm, uint32_t scriptToken, int index);
+  void promoteStagedScripts();
+  bool canPromote(const ArmScript& arm);
+  void promoteStagedScript(ArmScript& arm);
+  void publishTelemetry(int armIndex);
+  void reportEvent(const ArmScript& arm, TelemetryKind kind, int index, const char* text);
+  void flushTelemetry();
   void processNextCommand();
-  void processArmCommands(ArmScript& arm, SerialBridge* serialBridge);
-  void handleSerialResponse();
+  void processArmCommands(ArmScript& arm);
+  bool sendArmCommand(ArmScript& arm);
+  void handleArmResponse(ArmScript& arm, const SerialResponse& response);
+  void failArmPipeline(ArmScript& arm, const char* message, int accepted = 0);
+  void setArmError(ArmScript& arm, const char* message);
+  int availableCredits(const ArmScript& arm);
+  void routeResponses();
   
-  String convertToUARTProtocol(String webCommand, String armId);
+  void printArmStatus(const ArmScript& arm);
   void resetArmScript(ArmScript& arm);
-  void logArmActivity(const String& armId, const String& message);
+  void resetArmFeed(ArmFeed& feed);
+  void recordDispatchLatency(ArmScript& arm, uint8_t opcode);
+  void recordLatency(ArmScript& arm, uint8_t opcode, LatencyMetric metric, unsigned long micros);
+  void drainLog(int maxEntries);
+
+  // Host tests and benchmarks drive the network and dispatch steps directly.
+  friend class ForwarderProbe;
 
 public:
   CommandForwarder();
   ~CommandForwarder();
   
   void initialize(const char* ssid, const char* password, const char* serverHost, int serverPort);
+  bool startTasks();
+  void stopTasks();
   void update();
   bool isWifiConnected();
   void printStatus();
   void printDetailedStatus();
-  bool isArmActive(const String& armId);
-  int getArmProgress(const String& armId);
-  String getArmStatus(const String& armId);
+  int findArm(const String& armName);
+  int getArmCount();
+  const char* getArmName(int armIndex);
+  bool isArmActive(int armIndex);
+  bool isArmActive(const String& armName);
+  int getArmProgress(int armIndex);
+  int getArmProgress(const String& armName);
+  String getArmStatus(int armIndex);
+  String getArmStatus(const String& armName);
+  DispatchStats getArmDispatchStats(int armIndex);
+  DispatchStats getArmDispatchStats(const String& armName);
+  ResponseStats getArmResponseStats(int armIndex);
+  SwapStats getArmSwapStats(int armIndex);
+  LatencySummary getArmLatency(int armIndex, LatencyMetric metric);
+  LatencySummary getOpcodeLatency(uint8_t opcode, LatencyMetric metric);
+  void resetLatency();
+  ArenaStats getArmArenaStats(int armIndex);
+  HttpStats getHttpStats();
+  WifiStats getWifiStats();
+  ScriptCacheStats getScriptCacheStats();
+  unsigned long getDroppedLogEntries();
+  TelemetryRingStats getTelemetryRingStats();
+  TelemetryUploadStats getTelemetryUploadStats();
+  unsigned long getBootToReadyMs();
+  void setStaticIp(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns);
+  bool setPipelineDepth(int depth);
+  int getPipelineDepth();
+  void setBinaryProtocol(bool enabled);
+  void setScriptEncoding(ScriptEncoding encoding);
 };
 
 #endif
\ No newline at end of file
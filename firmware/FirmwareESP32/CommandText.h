@@ -0,0 +1,85 @@
+#ifndef COMMAND_TEXT_H
+#define COMMAND_TEXT_H
+
+#include <stddef.h>
+#include <string.h>
+#include "CommandCodec.h"
+
+// Passthrough text of the records in a command window, in the order they were
+// loaded. Each entry is kept contiguous, so one that does not fit before the
+// end wraps to the front and leaves the tail unused: a ring that must accept
+// up to Budget bytes of live text needs Budget + COMMAND_TEXT_MAX of storage.
+// Text is released oldest first as commands complete.
+template <size_t N>
+class CommandText {
+private:
+  char bytes[N];
+  size_t head;
+  size_t tail;
+  size_t end;
+  size_t used;
+
+public:
+  CommandText() {
+    reset();
+  }
+
+  void reset() {
+    head = 0;
+    tail = 0;
+    end = N;
+    used = 0;
+  }
+
+  bool append(CommandRecord& record, const char* text) {
+    size_t length = record.textLength;
+    record.textOffset = 0;
+    if (length == 0) {
+      return true;
+    }
+    if (used == 0) {
+      reset();
+    }
+
+    bool wrapped = end < N;
+    if (!wrapped && head + length > N) {
+      if (length > tail) {
+        return false;
+      }
+      end = head;
+      head = 0;
+    } else if (wrapped && head + length > tail) {
+      return false;
+    }
+
+    memcpy(bytes + head, text, length);
+    record.textOffset = head;
+    head += length;
+    used += length;
+    return true;
+  }
+
+  const char* at(const CommandRecord& record) const {
+    return bytes + record.textOffset;
+  }
+
+  void release(const CommandRecord& record) {
+    if (record.textLength == 0 || record.textLength > used) {
+      return;
+    }
+    used -= record.textLength;
+    tail = record.textOffset + record.textLength;
+    if (used == 0) {
+      reset();
+    } else if (end < N && tail >= end) {
+      tail = 0;
+      end = N;
+    }
+  }
+
+  size_t size() const {
+    return used;
+  }
+};
+
+#endif
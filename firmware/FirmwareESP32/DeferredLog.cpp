@@ -0,0 +1,54 @@
+#include "DeferredLog.h"
+
+DeferredLog::DeferredLog() : dropped(0) {}
+
+void DeferredLog::record(uint8_t level, uint8_t tag, const char* format, const char* text, const int32_t* args, int argCount) {
+  LogEntry entry;
+  entry.format = format;
+  entry.level = level;
+  entry.tag = tag;
+  entry.argCount = argCount;
+  memcpy(entry.args, args, argCount * sizeof(int32_t));
+  entry.text[0] = '\0';
+  if (text) {
+    strncpy(entry.text, text, LOG_TEXT_SIZE - 1);
+    entry.text[LOG_TEXT_SIZE - 1] = '\0';
+  }
+  if (!entries.push(entry)) {
+    dropped++;
+  }
+}
+
+bool DeferredLog::pop(LogEntry& entry) {
+  return entries.pop(entry);
+}
+
+unsigned long DeferredLog::getDropped() const {
+  return dropped.load();
+}
+
+size_t DeferredLog::format(const LogEntry& entry, char* buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  size_t length = 0;
+  int arg = 0;
+  for (const char* cursor = entry.format; *cursor && length + 1 < size; cursor++) {
+    if (cursor[0] == '%' && cursor[1] == 'd') {
+      int32_t value = arg < entry.argCount ? entry.args[arg++] : 0;
+      int written = snprintf(buffer + length, size - length, "%ld", (long)value);
+      length = written > 0 && (size_t)written < size - length ? length + written : size - 1;
+      cursor++;
+    } else if (cursor[0] == '%' && cursor[1] == 's') {
+      for (const char* text = entry.text; *text && length + 1 < size; text++) {
+        buffer[length++] = *text;
+      }
+      cursor++;
+    } else {
+      buffer[length++] = *cursor;
+    }
+  }
+  buffer[length] = '\0';
+  return length;
+}
@@ -0,0 +1,72 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include "MpscQueue.h"
+
+enum LogLevel : uint8_t {
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG
+};
+
+// Build with -DFORWARDER_LOG_LEVEL=LOG_LEVEL_DEBUG to see per-command traffic.
+#ifndef FORWARDER_LOG_LEVEL
+#define FORWARDER_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+static constexpr uint8_t LOG_COMPILED_LEVEL = FORWARDER_LOG_LEVEL;
+static const int LOG_RING_SIZE = 64;
+static const int LOG_MAX_ARGS = 3;
+static const int LOG_TEXT_SIZE = 32;
+static const size_t LOG_LINE_SIZE = 160;
+static const uint8_t LOG_TAG_SYSTEM = 0xFF;
+
+// The format is a string literal that is only expanded when the entry is
+// printed: each %d takes the next argument and %s takes the copied text.
+struct LogEntry {
+  const char* format;
+  uint8_t level;
+  uint8_t tag;
+  uint8_t argCount;
+  int32_t args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_SIZE];
+};
+
+// Hot paths record a format pointer and a few integers instead of building
+// and printing a String; the entries are printed later by whoever drains the
+// log. Written through DLOG, levels above LOG_COMPILED_LEVEL compile away.
+class DeferredLog {
+private:
+  MpscQueue<LogEntry, LOG_RING_SIZE> entries;
+  std::atomic<unsigned long> dropped;
+
+  void record(uint8_t level, uint8_t tag, const char* format, const char* text, const int32_t* args, int argCount);
+
+public:
+  DeferredLog();
+
+  template <LogLevel Level, typename... Args>
+  void write(uint8_t tag, const char* format, const char* text, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    if (Level > LOG_COMPILED_LEVEL) {
+      return;
+    }
+    const int32_t values[] = { 0, static_cast<int32_t>(args)... };
+    record(Level, tag, format, text, values + 1, sizeof...(Args));
+  }
+
+  bool pop(LogEntry& entry);
+  unsigned long getDropped() const;
+  static size_t format(const LogEntry& entry, char* buffer, size_t size);
+};
+
+// DLOG(log, LOG_LEVEL_DEBUG, tag, "Sent %d/%d: %s", text, a, b). The arguments
+// sit inside the dead branch too, so a disabled level evaluates none of them.
+#define DLOG(log, level, tag, ...) \
+  do { \
+    if ((level) <= LOG_COMPILED_LEVEL) (log).write<level>(tag, __VA_ARGS__); \
+  } while (0)
+
+#endif
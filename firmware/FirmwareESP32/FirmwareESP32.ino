@@ -4,6 +4,7 @@ CommandForwarder forwarder;
 
 void setup() {
   forwarder.initialize("silenceAndSleep", "11111111", "palletizer.local", 3006);
+  forwarder.startTasks();
 }
 
 void loop() {
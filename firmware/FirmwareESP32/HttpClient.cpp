@@ -1,61 +1,367 @@
 #include "HttpClient.h"
-#include "HTTPClient.h"
 
-HttpClient::HttpClient(const char* host, int port) {
+#if defined(ESP32)
+#include <lwip/dns.h>
+#endif
+
+enum DnsState : uint8_t {
+  DNS_IDLE,
+  DNS_PENDING,
+  DNS_DONE,
+  DNS_FAILED
+};
+
+HttpClient::HttpClient(const char* host, int port, DeferredLog& deferredLog) : log(deferredLog) {
   serverHost = String(host);
   serverPort = port;
-  baseUrl = "http://" + serverHost + ":" + String(serverPort);
+  hasServerIp = false;
+  resolvedAt = 0;
+  dnsState = DNS_IDLE;
+  dnsAddress = 0;
+  stats = HttpStats();
+  state = REQUEST_IDLE;
+  method = "GET";
+  payload = nullptr;
+  payloadSize = 0;
+  payloadSent = 0;
+  etag = nullptr;
+  etagSize = 0;
+  completion = nullptr;
+  completionContext = nullptr;
+  requestStart = 0;
+  deadline = 0;
+  status = 0;
+  bodyLength = 0;
+  http.setReuse(true);
+  
+  static const char* collected[] = { "ETag" };
+  http.collectHeaders(collected, 1);
 }
 
-String HttpClient::get(const String& endpoint) {
-  if (WiFi.status() != WL_CONNECTED) {
-    return "";
+bool HttpClient::request(const char* requestMethod, const String& requestEndpoint, const uint8_t* requestPayload, size_t requestSize,
+                         char* etagBuffer, size_t etagBufferSize, HttpCompletion onComplete, void* context) {
+  if (state != REQUEST_IDLE || WiFi.status() != WL_CONNECTED) {
+    return false;
   }
 
-  HTTPClient http;
-  String url = baseUrl + endpoint;
+  method = requestMethod;
+  endpoint = requestEndpoint;
+  payload = requestPayload;
+  payloadSize = requestPayload ? requestSize : 0;
+  payloadSent = 0;
+  etag = etagBuffer;
+  etagSize = etagBufferSize;
+  completion = onComplete;
+  completionContext = context;
+  status = 0;
+  bodyLength = 0;
+  requestStart = micros();
+  deadline = millis() + HTTP_CONNECT_TIMEOUT_MS;
+  state = REQUEST_RESOLVING;
+  poll();
+  return true;
+}
 
-  http.begin(url);
-  http.setTimeout(10000);
+void HttpClient::poll() {
+  switch (state) {
+    case REQUEST_RESOLVING: {
+      int resolved = pollResolve();
+      if (resolved > 0) {
+        startConnect();
+      } else if (resolved < 0 || (long)(millis() - deadline) >= 0) {
+        DLOG(log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "DNS lookup failed: %s", serverHost.c_str());
+        complete(FETCH_FAILED, HTTPC_ERROR_CONNECTION_REFUSED);
+      }
+      break;
+    }
+    case REQUEST_CONNECTING: {
+      int connected = http.pollConnect(client);
+      if (connected > 0) {
+        sendRequest();
+      } else if (connected < 0 || (long)(millis() - deadline) >= 0) {
+        http.abortConnect();
+        complete(FETCH_FAILED, connected < 0 ? connected : HTTPC_ERROR_CONNECTION_REFUSED);
+      }
+      break;
+    }
+    case REQUEST_SENDING_BODY:
+      sendBody();
+      break;
+    case REQUEST_WAITING_HEADERS:
+      readHeaders();
+      break;
+    case REQUEST_READING_BODY:
+      readBody();
+      break;
+    default:
+      break;
+  }
+}
 
-  int httpCode = http.GET();
-  String response = "";
+bool HttpClient::isBusy() {
+  return state != REQUEST_IDLE;
+}
 
-  if (httpCode == HTTP_CODE_OK) {
-    response = http.getString();
-  } else {
-    Serial.println("HTTP GET failed: " + String(httpCode));
+// Returns 1 once serverIp is usable, 0 while a lookup is in flight, -1 on failure.
+int HttpClient::pollResolve() {
+  if (hasServerIp && millis() - resolvedAt < DNS_CACHE_TTL_MS) {
+    return 1;
   }
 
-  http.end();
-  return response;
+  IPAddress resolved;
+  if (dnsState == DNS_PENDING) {
+    return 0;
+  }
+  if (dnsState == DNS_FAILED) {
+    dnsState = DNS_IDLE;
+    return -1;
+  }
+  if (dnsState == DNS_DONE) {
+    dnsState = DNS_IDLE;
+    resolved = IPAddress((uint32_t)dnsAddress);
+  } else if (!resolved.fromString(serverHost.c_str())) {
+    stats.dnsLookups++;
+#if defined(ESP32)
+    ip_addr_t address;
+    dnsState = DNS_PENDING;
+    err_t error = dns_gethostbyname(serverHost.c_str(), &address, (dns_found_callback)onDnsFound, this);
+    if (error == ERR_INPROGRESS) {
+      return 0;
+    }
+    dnsState = DNS_IDLE;
+    if (error != ERR_OK) {
+      return -1;
+    }
+    resolved = IPAddress(ip4_addr_get_u32(ip_2_ip4(&address)));
+#else
+    if (!WiFi.hostByName(serverHost.c_str(), resolved)) {
+      return -1;
+    }
+#endif
+  }
+
+  if (hasServerIp && (uint32_t)resolved != (uint32_t)serverIp) {
+    dropConnection();
+  }
+  serverIp = resolved;
+  serverAddress = serverIp.toString();
+  hasServerIp = true;
+  resolvedAt = millis();
+  return 1;
 }
 
-String HttpClient::post(const String& endpoint, const String& payload) {
-  if (WiFi.status() != WL_CONNECTED) {
-    return "";
+void HttpClient::onDnsFound(const char* name, const void* address, void* context) {
+  HttpClient* session = static_cast<HttpClient*>(context);
+#if defined(ESP32)
+  if (address) {
+    session->dnsAddress = ip4_addr_get_u32(ip_2_ip4((const ip_addr_t*)address));
+    session->dnsState = DNS_DONE;
+    return;
   }
+#endif
+  session->dnsState = DNS_FAILED;
+}
 
-  HTTPClient http;
-  String url = baseUrl + endpoint;
+void HttpClient::startConnect() {
+  http.begin(client, serverAddress, serverPort, endpoint);
+  http.setReuse(true);
+  http.setTimeout(HTTP_TIMEOUT_MS);
 
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(10000);
+  if (client.connected()) {
+    stats.reusedConnections++;
+    sendRequest();
+    return;
+  }
 
-  int httpCode = http.POST(payload);
-  String response = "";
+  if (!http.startConnect(serverIp, serverPort)) {
+    complete(FETCH_FAILED, HTTPC_ERROR_CONNECTION_REFUSED);
+    return;
+  }
+  state = REQUEST_CONNECTING;
+}
+
+void HttpClient::sendRequest() {
+  if (etag && etag[0]) {
+    http.addHeader("If-None-Match", etag);
+  }
+  if (payload) {
+    http.addHeader("Content-Type", "application/json");
+  }
+
+  if (!http.sendRequestAsync(method, payloadSize)) {
+    complete(FETCH_FAILED, HTTPC_ERROR_SEND_HEADER_FAILED);
+    return;
+  }
+  deadline = millis() + HTTP_TIMEOUT_MS;
+  state = REQUEST_SENDING_BODY;
+  sendBody();
+}
 
-  if (httpCode == HTTP_CODE_OK) {
-    response = http.getString();
+void HttpClient::sendBody() {
+  int count = payloadSent < payloadSize ? http.writeBody(payload + payloadSent, payloadSize - payloadSent) : 0;
+  if (count < 0) {
+    complete(FETCH_FAILED, count);
+    return;
+  }
+  
+  payloadSent += count;
+  if (payloadSent == payloadSize) {
+    state = REQUEST_WAITING_HEADERS;
+  } else if ((long)(millis() - deadline) >= 0) {
+    complete(FETCH_FAILED, HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+  }
+}
+
+void HttpClient::readHeaders() {
+  int code = http.pollHeaders();
+  if (code == 0) {
+    if ((long)(millis() - deadline) >= 0) {
+      complete(FETCH_FAILED, HTTPC_ERROR_READ_TIMEOUT);
+    }
+    return;
+  }
+  if (code < 0) {
+    complete(FETCH_FAILED, code);
+    return;
+  }
+
+  status = code;
+  if (code == HTTP_CODE_NOT_MODIFIED && etag && etag[0]) {
+    stats.notModified++;
+    complete(FETCH_NOT_MODIFIED, code);
+    return;
+  }
+  if (code == HTTP_CODE_OK && etag && etagSize > 0) {
+    snprintf(etag, etagSize, "%s", http.header("ETag").c_str());
+  }
+
+  int length = http.contentLength();
+  if (length > (int)HTTP_BODY_SIZE) {
+    DLOG(log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "HTTP response too large: %d bytes", nullptr, length);
+    complete(FETCH_FAILED, HTTPC_ERROR_TOO_LESS_RAM);
+  } else if (length == 0) {
+    complete(code == HTTP_CODE_OK ? FETCH_OK : FETCH_FAILED, code);
   } else {
-    Serial.println("HTTP POST failed: " + String(httpCode));
+    state = REQUEST_READING_BODY;
+    readBody();
   }
+}
+
+void HttpClient::readBody() {
+  int length = http.contentLength();
+  size_t wanted = length >= 0 ? length - bodyLength : HTTP_BODY_SIZE - bodyLength;
+  int count = wanted > 0 ? http.readBody(body + bodyLength, wanted) : 0;
 
+  if (count < 0 && length < 0) {
+    complete(status == HTTP_CODE_OK ? FETCH_OK : FETCH_FAILED, HTTPC_ERROR_CONNECTION_LOST);
+    return;
+  }
+  if (count < 0 || (length < 0 && wanted == 0)) {
+    complete(FETCH_FAILED, count < 0 ? count : HTTPC_ERROR_TOO_LESS_RAM);
+    return;
+  }
+
+  bodyLength += count;
+  if (length >= 0 && bodyLength == (size_t)length) {
+    complete(status == HTTP_CODE_OK ? FETCH_OK : FETCH_FAILED, status);
+  } else if ((long)(millis() - deadline) >= 0) {
+    complete(FETCH_FAILED, HTTPC_ERROR_READ_TIMEOUT);
+  }
+}
+
+void HttpClient::complete(FetchResult result, int transportCode) {
+  finishRequest(transportCode);
+  if (result == FETCH_FAILED && status != 0 && status != HTTP_CODE_OK) {
+    DLOG(log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "HTTP %s failed: %d", method, status);
+  } else if (transportCode < 0) {
+    DLOG(log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "HTTP %s failed: %d", method, transportCode);
+  }
+  if (result == FETCH_FAILED && etag && etagSize > 0) {
+    etag[0] = '\0';
+  }
+
+  state = REQUEST_IDLE;
+  body[bodyLength] = '\0';
+  HttpResponse response;
+  response.result = result;
+  response.status = status;
+  response.body = body;
+  response.length = bodyLength;
+  if (completion) {
+    completion(completionContext, response);
+  }
+}
+
+void HttpClient::finishRequest(int httpCode) {
+  unsigned long latency = micros() - requestStart;
+  stats.requests++;
+  stats.lastLatencyUs = latency;
+  stats.totalLatencyUs += latency;
+  if (latency > stats.maxLatencyUs) {
+    stats.maxLatencyUs = latency;
+  }
+
+  if (httpCode < 0) {
+    stats.failures++;
+    dropConnection();
+  } else {
+    if (httpCode != HTTP_CODE_OK && httpCode != HTTP_CODE_NOT_MODIFIED) {
+      stats.failures++;
+    }
+    http.end();
+  }
+}
+
+void HttpClient::dropConnection() {
   http.end();
-  return response;
+  if (client.connected()) {
+    stats.reconnects++;
+  }
+  client.stop();
+  hasServerIp = false;
+}
+
+struct BlockingResult {
+  bool done;
+  String body;
+};
+
+static void collectBody(void* context, const HttpResponse& response) {
+  BlockingResult* result = static_cast<BlockingResult*>(context);
+  result->done = true;
+  if (response.result == FETCH_OK) {
+    result->body = String((const char*)response.body);
+  }
+}
+
+String HttpClient::get(const String& endpoint) {
+  BlockingResult result = { false, "" };
+  if (!request("GET", endpoint, nullptr, 0, nullptr, 0, collectBody, &result)) {
+    return "";
+  }
+  while (!result.done) {
+    poll();
+    delay(1);
+  }
+  return result.body;
+}
+
+String HttpClient::post(const String& endpoint, const String& payload) {
+  BlockingResult result = { false, "" };
+  if (!request("POST", endpoint, (const uint8_t*)payload.c_str(), payload.length(), nullptr, 0, collectBody, &result)) {
+    return "";
+  }
+  while (!result.done) {
+    poll();
+    delay(1);
+  }
+  return result.body;
 }
 
 bool HttpClient::isConnected() {
   return WiFi.status() == WL_CONNECTED;
-}
\ No newline at end of file
+}
+
+HttpStats HttpClient::getStats() {
+  return stats;
+}
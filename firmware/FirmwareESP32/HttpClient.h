@@ -2,19 +2,110 @@
 #define HTTP_CLIENT_H
 
 #include <WiFi.h>
-#include <HTTPClient.h>
+#include "AsyncHTTPClient.h"
+#include "DeferredLog.h"
 
+static const unsigned long DNS_CACHE_TTL_MS = 60000;
+static const unsigned long HTTP_CONNECT_TIMEOUT_MS = 3000;
+static const unsigned long HTTP_TIMEOUT_MS = 10000;
+static const size_t HTTP_ETAG_SIZE = 40;
+static const size_t HTTP_BODY_SIZE = 4096;
+
+enum FetchResult : uint8_t {
+  FETCH_FAILED,
+  FETCH_OK,
+  FETCH_NOT_MODIFIED
+};
+
+enum RequestState : uint8_t {
+  REQUEST_IDLE,
+  REQUEST_RESOLVING,
+  REQUEST_CONNECTING,
+  REQUEST_SENDING_BODY,
+  REQUEST_WAITING_HEADERS,
+  REQUEST_READING_BODY
+};
+
+struct HttpResponse {
+  FetchResult result;
+  int status;
+  const uint8_t* body;
+  size_t length;
+};
+
+typedef void (*HttpCompletion)(void* context, const HttpResponse& response);
+
+struct HttpStats {
+  unsigned long requests;
+  unsigned long failures;
+  unsigned long reusedConnections;
+  unsigned long reconnects;
+  unsigned long dnsLookups;
+  unsigned long notModified;
+  unsigned long lastLatencyUs;
+  unsigned long maxLatencyUs;
+  unsigned long long totalLatencyUs;
+};
+
+// One keep-alive session per server. The resolved address is cached for
+// DNS_CACHE_TTL_MS and dropped together with the socket whenever a request
+// fails at the transport level, so the next request reconnects from scratch.
+//
+// request() only queues the work; poll() advances it through DNS, connect,
+// send, headers and body without waiting on the network, and calls the
+// completion once. The response body stays valid until the next request.
 class HttpClient {
 private:
   String serverHost;
   int serverPort;
-  String baseUrl;
+  String serverAddress;
+  WiFiClient client;
+  AsyncHTTPClient http;
+  IPAddress serverIp;
+  bool hasServerIp;
+  unsigned long resolvedAt;
+  volatile uint8_t dnsState;
+  volatile uint32_t dnsAddress;
+  HttpStats stats;
+  DeferredLog& log;
+
+  RequestState state;
+  const char* method;
+  String endpoint;
+  const uint8_t* payload;
+  size_t payloadSize;
+  size_t payloadSent;
+  char* etag;
+  size_t etagSize;
+  HttpCompletion completion;
+  void* completionContext;
+  unsigned long requestStart;
+  unsigned long deadline;
+  int status;
+  uint8_t body[HTTP_BODY_SIZE + 1];
+  size_t bodyLength;
+
+  int pollResolve();
+  void startConnect();
+  void sendRequest();
+  void sendBody();
+  void readHeaders();
+  void readBody();
+  void complete(FetchResult result, int transportCode);
+  void finishRequest(int httpCode);
+  void dropConnection();
+  static void onDnsFound(const char* name, const void* address, void* context);
 
 public:
-  HttpClient(const char* host, int port);
+  HttpClient(const char* host, int port, DeferredLog& deferredLog);
+  bool request(const char* requestMethod, const String& requestEndpoint, const uint8_t* requestPayload, size_t requestSize,
+               char* etagBuffer, size_t etagBufferSize, HttpCompletion onComplete, void* context);
+  void poll();
+  bool isBusy();
   String get(const String& endpoint);
   String post(const String& endpoint, const String& payload);
   bool isConnected();
+  HttpStats getStats();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,86 @@
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(unsigned long micros) {
+  buckets[bucketIndex(micros)]++;
+  count++;
+  if (micros > max) {
+    max = micros;
+  }
+}
+
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  max = 0;
+}
+
+// Midpoint of the bucket holding the requested rank, capped at the exact max.
+unsigned long LatencyHistogram::percentile(int perMille) const {
+  if (count == 0) {
+    return 0;
+  }
+  
+  uint32_t rank = ((uint64_t)count * perMille + 999) / 1000;
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      uint32_t value = bucketLowerBound(i) + bucketWidth(i) / 2;
+      return value < max ? value : max;
+    }
+  }
+  return max;
+}
+
+LatencySummary LatencyHistogram::summarize() const {
+  LatencySummary summary;
+  summary.count = count;
+  summary.p50 = percentile(500);
+  summary.p95 = percentile(950);
+  summary.p99 = percentile(990);
+  summary.max = max;
+  return summary;
+}
+
+int LatencyHistogram::bucketIndex(uint32_t value) {
+  if (value < (uint32_t)LATENCY_SUB_BUCKETS) {
+    return value;
+  }
+  
+  int exponent = 31 - __builtin_clz(value);
+  if (exponent > LATENCY_MAX_EXPONENT) {
+    return LATENCY_BUCKET_COUNT - 1;
+  }
+  int subBucket = (value >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+  return LATENCY_SUB_BUCKETS * (exponent - LATENCY_SUB_BUCKET_BITS + 1) + subBucket;
+}
+
+uint32_t LatencyHistogram::bucketLowerBound(int index) {
+  if (index < LATENCY_SUB_BUCKETS) {
+    return index;
+  }
+  int exponent = index / LATENCY_SUB_BUCKETS - 1 + LATENCY_SUB_BUCKET_BITS;
+  int subBucket = index % LATENCY_SUB_BUCKETS;
+  return (uint32_t)(LATENCY_SUB_BUCKETS + subBucket) << (exponent - LATENCY_SUB_BUCKET_BITS);
+}
+
+uint32_t LatencyHistogram::bucketWidth(int index) {
+  if (index < LATENCY_SUB_BUCKETS) {
+    return 1;
+  }
+  return 1UL << (index / LATENCY_SUB_BUCKETS - 1);
+}
+
+const char* LatencyHistogram::metricName(uint8_t metric) {
+  switch (metric) {
+    case LATENCY_FIRST_BYTE: return "firstByte";
+    case LATENCY_ACK: return "ack";
+    case LATENCY_DISPATCH: return "dispatch";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <Arduino.h>
+
+static const int LATENCY_SUB_BUCKET_BITS = 2;
+static const int LATENCY_SUB_BUCKETS = 1 << LATENCY_SUB_BUCKET_BITS;
+static const int LATENCY_MAX_EXPONENT = 24;
+static const int LATENCY_BUCKET_COUNT = LATENCY_SUB_BUCKETS * (LATENCY_MAX_EXPONENT - LATENCY_SUB_BUCKET_BITS + 2);
+
+enum LatencyMetric : uint8_t {
+  LATENCY_FIRST_BYTE,
+  LATENCY_ACK,
+  LATENCY_DISPATCH,
+  LATENCY_METRIC_COUNT
+};
+
+struct LatencySummary {
+  unsigned long count;
+  unsigned long p50;
+  unsigned long p95;
+  unsigned long p99;
+  unsigned long max;
+};
+
+// Log-bucketed microsecond histogram in the HDR style: every power of two is
+// split into LATENCY_SUB_BUCKETS linear buckets, so any reported percentile
+// is within 1/8 of the true value. Samples past 2^LATENCY_MAX_EXPONENT us
+// (~16 s) land in the last bucket; max is kept exactly.
+class LatencyHistogram {
+private:
+  uint32_t buckets[LATENCY_BUCKET_COUNT];
+  uint32_t count;
+  uint32_t max;
+
+public:
+  LatencyHistogram();
+  void record(unsigned long micros);
+  void reset();
+  unsigned long percentile(int perMille) const;
+  LatencySummary summarize() const;
+  static int bucketIndex(uint32_t value);
+  static uint32_t bucketLowerBound(int index);
+  static uint32_t bucketWidth(int index);
+  static const char* metricName(uint8_t metric);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded lock-free multi-producer/single-consumer ring. Every cell carries a
+// sequence number, so a producer claims a slot with one compare-and-swap on
+// the tail and publishes it by bumping the cell's sequence; the consumer only
+// takes cells whose sequence says they are complete. Neither side blocks: a
+// full ring makes push() fail and an unfinished cell makes pop() wait its turn.
+template <typename T, size_t N>
+class MpscQueue {
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  Cell cells[N];
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+
+public:
+  MpscQueue() : head(0), tail(0) {
+    for (size_t i = 0; i < N; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T& item) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells[position % N];
+      intptr_t lag = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)position;
+      if (lag == 0) {
+        if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          cell.item = item;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (lag < 0) {
+        return false;
+      } else {
+        position = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool pop(T& item) {
+    size_t position = head.load(std::memory_order_relaxed);
+    Cell& cell = cells[position % N];
+    if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+      return false;
+    }
+    item = cell.item;
+    cell.sequence.store(position + N, std::memory_order_release);
+    head.store(position + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "ResponseRouter.h"
+
+ResponseRouter::ResponseRouter() {
+  bridge = nullptr;
+  armIndex = 0;
+  subscriberCount = 0;
+  routedCount = 0;
+  unroutedCount = 0;
+}
+
+void ResponseRouter::attach(SerialBridge* serialBridge, uint8_t arm) {
+  bridge = serialBridge;
+  armIndex = arm;
+}
+
+bool ResponseRouter::subscribe(uint8_t typeMask, ResponseHandler handler, void* context) {
+  if (!handler || subscriberCount >= ROUTER_MAX_SUBSCRIBERS) {
+    return false;
+  }
+  
+  ResponseSubscriber& subscriber = subscribers[subscriberCount++];
+  subscriber.typeMask = typeMask;
+  subscriber.handler = handler;
+  subscriber.context = context;
+  return true;
+}
+
+int ResponseRouter::route() {
+  if (!bridge) return 0;
+  
+  SerialResponse response;
+  int count = 0;
+  while (count < ROUTER_MAX_BATCH && bridge->readResponse(response)) {
+    uint8_t typeBit = 1 << response.type;
+    bool delivered = false;
+    for (int i = 0; i < subscriberCount; i++) {
+      if (subscribers[i].typeMask & typeBit) {
+        subscribers[i].handler(subscribers[i].context, armIndex, response);
+        delivered = true;
+      }
+    }
+    if (delivered) {
+      routedCount++;
+    } else {
+      unroutedCount++;
+    }
+    count++;
+  }
+  return count;
+}
+
+unsigned long ResponseRouter::getRoutedCount() {
+  return routedCount;
+}
+
+unsigned long ResponseRouter::getUnroutedCount() {
+  return unroutedCount;
+}
@@ -0,0 +1,45 @@
+#ifndef RESPONSE_ROUTER_H
+#define RESPONSE_ROUTER_H
+
+#include "SerialBridge.h"
+
+static const int ROUTER_MAX_SUBSCRIBERS = 4;
+static const int ROUTER_MAX_BATCH = SERIAL_QUEUE_SIZE;
+
+static const uint8_t ROUTE_INFO = 1 << RESPONSE_INFO;
+static const uint8_t ROUTE_OK = 1 << RESPONSE_OK;
+static const uint8_t ROUTE_DONE = 1 << RESPONSE_DONE;
+static const uint8_t ROUTE_ERROR = 1 << RESPONSE_ERROR;
+static const uint8_t ROUTE_COMPLETION = ROUTE_OK | ROUTE_DONE | ROUTE_ERROR;
+static const uint8_t ROUTE_ALL = ROUTE_INFO | ROUTE_COMPLETION;
+
+typedef void (*ResponseHandler)(void* context, uint8_t armIndex, const SerialResponse& response);
+
+struct ResponseSubscriber {
+  uint8_t typeMask;
+  ResponseHandler handler;
+  void* context;
+};
+
+// The only reader of a port. Each message is parsed once by the bridge and
+// handed to every subscriber whose mask includes its type, in subscription
+// order, so no consumer can take a message another one was waiting for.
+class ResponseRouter {
+private:
+  SerialBridge* bridge;
+  uint8_t armIndex;
+  ResponseSubscriber subscribers[ROUTER_MAX_SUBSCRIBERS];
+  int subscriberCount;
+  unsigned long routedCount;
+  unsigned long unroutedCount;
+
+public:
+  ResponseRouter();
+  void attach(SerialBridge* serialBridge, uint8_t arm);
+  bool subscribe(uint8_t typeMask, ResponseHandler handler, void* context);
+  int route();
+  unsigned long getRoutedCount();
+  unsigned long getUnroutedCount();
+};
+
+#endif
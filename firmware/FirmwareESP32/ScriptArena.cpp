@@ -0,0 +1,80 @@
+#include "ScriptArena.h"
+
+ScriptArena::ScriptArena() {
+  used = 0;
+  highWater = 0;
+  resets = 0;
+  failedAllocations = 0;
+}
+
+void* ScriptArena::allocate(size_t size, size_t alignment) {
+  size_t start = (used + alignment - 1) & ~(alignment - 1);
+  if (start + size > SCRIPT_ARENA_SIZE) {
+    failedAllocations++;
+    return nullptr;
+  }
+  
+  used = start + size;
+  if (used > highWater) {
+    highWater = used;
+  }
+  return storage + start;
+}
+
+const char* ScriptArena::copyString(const char* text, size_t maxLength) {
+  if (!text || !*text) {
+    return "";
+  }
+  
+  size_t length = strnlen(text, maxLength);
+  char* copy = static_cast<char*>(allocate(length + 1, 1));
+  if (!copy) {
+    return "";
+  }
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+size_t ScriptArena::mark() {
+  return used;
+}
+
+void ScriptArena::rewind(size_t position) {
+  if (position < used) {
+    used = position;
+  }
+}
+
+void ScriptArena::reset() {
+  used = 0;
+  resets++;
+}
+
+ArenaStats ScriptArena::getStats() const {
+  ArenaStats stats;
+  stats.capacity = SCRIPT_ARENA_SIZE;
+  stats.used = used;
+  stats.highWater = highWater;
+  stats.freeBytes = SCRIPT_ARENA_SIZE - used;
+  stats.largestFreeBlock = SCRIPT_ARENA_SIZE - used;
+  stats.resets = resets;
+  stats.failedAllocations = failedAllocations;
+  return stats;
+}
+
+size_t ScriptArena::largestHeapBlock() {
+#if defined(ESP32)
+  return ESP.getMaxAllocHeap();
+#else
+  return 0;
+#endif
+}
+
+size_t ScriptArena::freeHeap() {
+#if defined(ESP32)
+  return ESP.getFreeHeap();
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef SCRIPT_ARENA_H
+#define SCRIPT_ARENA_H
+
+#include <Arduino.h>
+
+static const size_t SCRIPT_ARENA_SIZE = 160;
+
+struct ArenaStats {
+  size_t capacity;
+  size_t used;
+  size_t highWater;
+  size_t freeBytes;
+  size_t largestFreeBlock;
+  unsigned long resets;
+  unsigned long failedAllocations;
+};
+
+// Bump allocator for the per-script strings of one arm. Everything is
+// released at once by reset() when the next script is loaded; mark() and
+// rewind() let a trailing field such as the error message be replaced
+// without growing the arena.
+class ScriptArena {
+private:
+  uint8_t storage[SCRIPT_ARENA_SIZE];
+  size_t used;
+  size_t highWater;
+  unsigned long resets;
+  unsigned long failedAllocations;
+
+public:
+  ScriptArena();
+  void* allocate(size_t size, size_t alignment = sizeof(void*));
+  const char* copyString(const char* text, size_t maxLength = SCRIPT_ARENA_SIZE);
+  size_t mark();
+  void rewind(size_t position);
+  void reset();
+  ArenaStats getStats() const;
+  static size_t largestHeapBlock();
+  static size_t freeHeap();
+};
+
+#endif
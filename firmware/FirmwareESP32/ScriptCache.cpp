@@ -0,0 +1,259 @@
+#include "ScriptCache.h"
+
+static const uint32_t FNV_OFFSET_BASIS = 2166136261UL;
+static const uint32_t FNV_PRIME = 16777619UL;
+
+ScriptCache::ScriptCache() {
+  stats = ScriptCacheStats();
+}
+
+bool ScriptCache::begin(const char* rootPath) {
+  return files.mount(rootPath);
+}
+
+bool ScriptCache::load(const char* armName, ScriptCacheHeader& header) {
+  return readHeader(armName, header) && verify(armName, header);
+}
+
+bool ScriptCache::readHeader(const char* armName, ScriptCacheHeader& header) {
+  char path[SCRIPT_PATH_SIZE];
+  if (!files.isMounted() || !files.path(path, sizeof(path), armName, "hdr") ||
+      files.read(path, 0, &header, sizeof(header)) != sizeof(header) || header.magic != SCRIPT_CACHE_MAGIC) {
+    return false;
+  }
+  header.scriptId[SCRIPT_CACHE_ID_SIZE - 1] = '\0';
+  header.format[SCRIPT_CACHE_FORMAT_SIZE - 1] = '\0';
+  return true;
+}
+
+bool ScriptCache::verify(const char* armName, const ScriptCacheHeader& header) {
+  char path[SCRIPT_PATH_SIZE];
+  if (!files.path(path, sizeof(path), armName, "rec") || files.size(path) != (long)header.recordBytes) {
+    return false;
+  }
+
+  uint8_t block[SCRIPT_CACHE_BLOCK_SIZE];
+  uint32_t digest = FNV_OFFSET_BASIS;
+  for (uint32_t offset = 0; offset < header.recordBytes;) {
+    size_t count = files.read(path, offset, block, sizeof(block));
+    if (count == 0) {
+      return false;
+    }
+    digest = hash(digest, block, count);
+    offset += count;
+  }
+  stats.bytesRead += header.recordBytes;
+  return digest == header.hash;
+}
+
+bool ScriptCache::open(const char* armName, const char* scriptId, int commandCount, ScriptCacheCursor& cursor) {
+  close(cursor);
+  ScriptCacheHeader header;
+  if (!readHeader(armName, header) || strcmp(header.scriptId, scriptId) != 0 ||
+      (int)header.commandCount != commandCount || !verify(armName, header)) {
+    return false;
+  }
+  cursor.header = header;
+  cursor.reading = true;
+  stats.hits++;
+  return true;
+}
+
+bool ScriptCache::beginWrite(const char* armName, const char* scriptId, const char* format, int commandCount, ScriptCacheCursor& cursor) {
+  close(cursor);
+  char headerPath[SCRIPT_PATH_SIZE];
+  char recordPath[SCRIPT_PATH_SIZE];
+  char endPath[SCRIPT_PATH_SIZE];
+  if (!files.isMounted() || !files.path(headerPath, sizeof(headerPath), armName, "hdr") ||
+      !files.path(recordPath, sizeof(recordPath), armName, "rec") || !files.path(endPath, sizeof(endPath), armName, "end")) {
+    return false;
+  }
+  if (!files.remove(headerPath) || !files.remove(endPath) || !files.write(recordPath, "", 0, false)) {
+    stats.failures++;
+    return false;
+  }
+
+  memset(&cursor.header, 0, sizeof(cursor.header));
+  cursor.header.magic = SCRIPT_CACHE_MAGIC;
+  snprintf(cursor.header.scriptId, sizeof(cursor.header.scriptId), "%s", scriptId);
+  snprintf(cursor.header.format, sizeof(cursor.header.format), "%s", format);
+  cursor.header.commandCount = commandCount;
+  cursor.header.hash = FNV_OFFSET_BASIS;
+  cursor.writing = true;
+  return true;
+}
+
+// text is the buffer the records' textOffset refers to.
+bool ScriptCache::append(const char* armName, ScriptCacheCursor& cursor, const CommandRecord* records, int count, const char* text) {
+  if (!cursor.writing) {
+    return false;
+  }
+
+  uint8_t record[BINARY_COMMAND_SIZE];
+  for (int i = 0; i < count; i++) {
+    size_t recordLength = CommandCodec::toBinary(records[i], text + records[i].textOffset, record, sizeof(record));
+    if (cursor.pendingLength + 1 + recordLength > sizeof(cursor.pending) && !flush(armName, cursor)) {
+      return false;
+    }
+    uint8_t* slot = cursor.pending + cursor.pendingLength;
+    slot[0] = recordLength;
+    memcpy(slot + 1, record, recordLength);
+    cursor.pendingLength += 1 + recordLength;
+  }
+  cursor.recordIndex += count;
+  return true;
+}
+
+// Every flash write stalls both cores, so appends are batched and the forwarder
+// flushes the remainder once the arms are idle.
+bool ScriptCache::flush(const char* armName, ScriptCacheCursor& cursor) {
+  char path[SCRIPT_PATH_SIZE];
+  if (!cursor.writing || cursor.pendingLength == 0) {
+    return cursor.writing;
+  }
+  if (!files.path(path, sizeof(path), armName, "rec") || !files.write(path, cursor.pending, cursor.pendingLength, true)) {
+    abortWrite(armName, cursor);
+    return false;
+  }
+  cursor.header.hash = hash(cursor.header.hash, cursor.pending, cursor.pendingLength);
+  cursor.header.recordBytes += cursor.pendingLength;
+  stats.bytesWritten += cursor.pendingLength;
+  cursor.pendingLength = 0;
+  return true;
+}
+
+bool ScriptCache::commit(const char* armName, ScriptCacheCursor& cursor) {
+  char path[SCRIPT_PATH_SIZE];
+  if (!flush(armName, cursor) || !files.path(path, sizeof(path), armName, "hdr")) {
+    return false;
+  }
+  cursor.writing = false;
+  if (!files.write(path, &cursor.header, sizeof(cursor.header), false)) {
+    abortWrite(armName, cursor);
+    return false;
+  }
+  stats.commits++;
+  return true;
+}
+
+// Reads up to count records from the cursor; records may be null to skip.
+// Their text is appended to text at textLength and reading stops early once
+// textSize would be exceeded. Returns the number read, or -1 if the slot is
+// unreadable.
+int ScriptCache::readRecords(const char* armName, ScriptCacheCursor& cursor, CommandRecord* records, int count,
+                             char* text, size_t textSize, size_t& textLength) {
+  char path[SCRIPT_PATH_SIZE];
+  if (!cursor.reading || !files.path(path, sizeof(path), armName, "rec")) {
+    return -1;
+  }
+
+  uint8_t block[SCRIPT_CACHE_BLOCK_SIZE];
+  int produced = 0;
+  bool textFull = false;
+  while (produced < count && !textFull && cursor.recordIndex < (int)cursor.header.commandCount) {
+    size_t length = files.read(path, cursor.offset, block, sizeof(block));
+    size_t position = 0;
+    while (produced < count && cursor.recordIndex < (int)cursor.header.commandCount &&
+           position < length && position + 1 + block[position] <= length) {
+      uint8_t recordLength = block[position];
+      if (records) {
+        CommandRecord& record = records[produced];
+        const char* source;
+        if (!CommandCodec::fromBinary(block + position + 1, recordLength, record, source)) {
+          memset(&record, 0, sizeof(record));
+        }
+        if (textLength + record.textLength > textSize) {
+          textFull = true;
+          break;
+        }
+        memcpy(text + textLength, source, record.textLength);
+        record.textOffset = textLength;
+        textLength += record.textLength;
+      }
+      position += 1 + recordLength;
+      produced++;
+      cursor.recordIndex++;
+    }
+    if (position == 0 && !textFull) {
+      stats.failures++;
+      close(cursor);
+      return -1;
+    }
+    cursor.offset += position;
+    stats.bytesRead += position;
+  }
+  return produced;
+}
+
+void ScriptCache::close(ScriptCacheCursor& cursor) {
+  cursor.writing = false;
+  cursor.reading = false;
+  cursor.offset = 0;
+  cursor.recordIndex = 0;
+  cursor.pendingLength = 0;
+}
+
+// Moves a slot over another. A header is only carried over if the source
+// had one, so a slot that is still being written stays invalid until commit.
+// The source has not run yet, so the target loses any completion mark.
+bool ScriptCache::promote(const char* fromSlot, const char* toSlot) {
+  char fromRecords[SCRIPT_PATH_SIZE];
+  char fromHeader[SCRIPT_PATH_SIZE];
+  char toRecords[SCRIPT_PATH_SIZE];
+  char toHeader[SCRIPT_PATH_SIZE];
+  char toEnd[SCRIPT_PATH_SIZE];
+  if (!files.isMounted() || !files.path(fromRecords, sizeof(fromRecords), fromSlot, "rec") ||
+      !files.path(fromHeader, sizeof(fromHeader), fromSlot, "hdr") ||
+      !files.path(toRecords, sizeof(toRecords), toSlot, "rec") || !files.path(toHeader, sizeof(toHeader), toSlot, "hdr") ||
+      !files.path(toEnd, sizeof(toEnd), toSlot, "end")) {
+    return false;
+  }
+  
+  if (!files.remove(toHeader) || !files.remove(toEnd) || !files.remove(toRecords) ||
+      (files.size(fromRecords) >= 0 && !files.rename(fromRecords, toRecords)) ||
+      (files.size(fromHeader) >= 0 && !files.rename(fromHeader, toHeader))) {
+    stats.failures++;
+    return false;
+  }
+  return true;
+}
+
+// Records that the slot's script ran to its last command. Only the hash is
+// kept, so a mark can never vouch for a different script written later.
+bool ScriptCache::markComplete(const char* armName) {
+  char path[SCRIPT_PATH_SIZE];
+  ScriptCacheHeader header;
+  if (!readHeader(armName, header) || !files.path(path, sizeof(path), armName, "end") ||
+      !files.write(path, &header.hash, sizeof(header.hash), false)) {
+    return false;
+  }
+  stats.bytesWritten += sizeof(header.hash);
+  return true;
+}
+
+bool ScriptCache::isComplete(const char* armName, const ScriptCacheHeader& header) {
+  char path[SCRIPT_PATH_SIZE];
+  uint32_t hash;
+  return files.path(path, sizeof(path), armName, "end") && files.read(path, 0, &hash, sizeof(hash)) == sizeof(hash) &&
+         hash == header.hash;
+}
+
+void ScriptCache::abortWrite(const char* armName, ScriptCacheCursor& cursor) {
+  char path[SCRIPT_PATH_SIZE];
+  stats.failures++;
+  close(cursor);
+  if (files.path(path, sizeof(path), armName, "hdr")) {
+    files.remove(path);
+  }
+}
+
+ScriptCacheStats ScriptCache::getStats() {
+  return stats;
+}
+
+uint32_t ScriptCache::hash(uint32_t seed, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    seed = (seed ^ data[i]) * FNV_PRIME;
+  }
+  return seed;
+}
@@ -0,0 +1,76 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include <Arduino.h>
+#include "CommandCodec.h"
+#include "ScriptFileSystem.h"
+
+static const uint32_t SCRIPT_CACHE_MAGIC = 0x31435350;
+static const int SCRIPT_CACHE_ID_SIZE = 48;
+static const int SCRIPT_CACHE_FORMAT_SIZE = 16;
+static const size_t SCRIPT_CACHE_BLOCK_SIZE = 256;
+static const size_t SCRIPT_CACHE_WRITE_SIZE = 1024;
+
+// On-flash layout, one slot per arm: "<arm>.rec" holds the records exactly as
+// the binary script image carries them (u8 length + CommandCodec binary) and
+// "<arm>.hdr" is written last, so a slot only counts once the whole script
+// landed and its FNV-1a hash still matches. "<arm>.end" holds that hash once
+// the script has run to its last command, so it is not restored to run again.
+struct ScriptCacheHeader {
+  uint32_t magic;
+  char scriptId[SCRIPT_CACHE_ID_SIZE];
+  char format[SCRIPT_CACHE_FORMAT_SIZE];
+  uint32_t commandCount;
+  uint32_t recordBytes;
+  uint32_t hash;
+};
+
+// Per-arm position in the slot. Owned by whoever feeds the arm. Appended
+// records collect in pending and reach flash SCRIPT_CACHE_WRITE_SIZE bytes at
+// a time, or when flushed.
+struct ScriptCacheCursor {
+  ScriptCacheHeader header;
+  bool writing;
+  bool reading;
+  uint32_t offset;
+  int recordIndex;
+  size_t pendingLength;
+  uint8_t pending[SCRIPT_CACHE_WRITE_SIZE];
+};
+
+struct ScriptCacheStats {
+  unsigned long hits;
+  unsigned long commits;
+  unsigned long failures;
+  unsigned long bytesWritten;
+  unsigned long bytesRead;
+};
+
+class ScriptCache {
+private:
+  ScriptFileSystem files;
+  ScriptCacheStats stats;
+
+  bool readHeader(const char* armName, ScriptCacheHeader& header);
+  bool verify(const char* armName, const ScriptCacheHeader& header);
+  void abortWrite(const char* armName, ScriptCacheCursor& cursor);
+
+public:
+  ScriptCache();
+  bool begin(const char* rootPath);
+  bool load(const char* armName, ScriptCacheHeader& header);
+  bool open(const char* armName, const char* scriptId, int commandCount, ScriptCacheCursor& cursor);
+  bool beginWrite(const char* armName, const char* scriptId, const char* format, int commandCount, ScriptCacheCursor& cursor);
+  bool append(const char* armName, ScriptCacheCursor& cursor, const CommandRecord* records, int count, const char* text);
+  bool flush(const char* armName, ScriptCacheCursor& cursor);
+  bool commit(const char* armName, ScriptCacheCursor& cursor);
+  int readRecords(const char* armName, ScriptCacheCursor& cursor, CommandRecord* records, int count, char* text, size_t textSize, size_t& textLength);
+  void close(ScriptCacheCursor& cursor);
+  bool promote(const char* fromSlot, const char* toSlot);
+  bool markComplete(const char* armName);
+  bool isComplete(const char* armName, const ScriptCacheHeader& header);
+  ScriptCacheStats getStats();
+  static uint32_t hash(uint32_t seed, const uint8_t* data, size_t length);
+};
+
+#endif
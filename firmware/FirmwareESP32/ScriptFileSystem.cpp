@@ -0,0 +1,121 @@
+#include "ScriptFileSystem.h"
+
+ScriptFileSystem::ScriptFileSystem() {
+  root[0] = '\0';
+  mounted = false;
+}
+
+bool ScriptFileSystem::isMounted() {
+  return mounted;
+}
+
+bool ScriptFileSystem::path(char* buffer, size_t size, const char* name, const char* extension) {
+  int length = snprintf(buffer, size, "%s/%s.%s", root, name, extension);
+  return length > 0 && (size_t)length < size;
+}
+
+#if defined(ESP32)
+
+#include <LittleFS.h>
+
+bool ScriptFileSystem::mount(const char* rootPath) {
+  snprintf(root, sizeof(root), "%s", rootPath);
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  if (!LittleFS.exists(root) && !LittleFS.mkdir(root)) {
+    return false;
+  }
+  mounted = true;
+  return true;
+}
+
+bool ScriptFileSystem::write(const char* path, const void* data, size_t size, bool append) {
+  File file = LittleFS.open(path, append ? FILE_APPEND : FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  size_t written = file.write(static_cast<const uint8_t*>(data), size);
+  file.close();
+  return written == size;
+}
+
+size_t ScriptFileSystem::read(const char* path, size_t offset, void* buffer, size_t size) {
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) {
+    return 0;
+  }
+  size_t count = file.seek(offset) ? file.read(static_cast<uint8_t*>(buffer), size) : 0;
+  file.close();
+  return count;
+}
+
+long ScriptFileSystem::size(const char* path) {
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) {
+    return -1;
+  }
+  long length = file.size();
+  file.close();
+  return length;
+}
+
+bool ScriptFileSystem::remove(const char* path) {
+  return !LittleFS.exists(path) || LittleFS.remove(path);
+}
+
+bool ScriptFileSystem::rename(const char* from, const char* to) {
+  return LittleFS.rename(from, to);
+}
+
+#else
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+// The flash root is absolute; on the host it is taken relative to the
+// working directory so a run never writes outside it.
+bool ScriptFileSystem::mount(const char* rootPath) {
+  snprintf(root, sizeof(root), "%s", rootPath[0] == '/' ? rootPath + 1 : rootPath);
+  struct stat info;
+  if (stat(root, &info) != 0 && mkdir(root, 0755) != 0) {
+    return false;
+  }
+  mounted = true;
+  return true;
+}
+
+bool ScriptFileSystem::write(const char* path, const void* data, size_t size, bool append) {
+  FILE* file = fopen(path, append ? "ab" : "wb");
+  if (!file) {
+    return false;
+  }
+  size_t written = fwrite(data, 1, size, file);
+  return fclose(file) == 0 && written == size;
+}
+
+size_t ScriptFileSystem::read(const char* path, size_t offset, void* buffer, size_t size) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return 0;
+  }
+  size_t count = fseek(file, offset, SEEK_SET) == 0 ? fread(buffer, 1, size, file) : 0;
+  fclose(file);
+  return count;
+}
+
+long ScriptFileSystem::size(const char* path) {
+  struct stat info;
+  return stat(path, &info) == 0 ? (long)info.st_size : -1;
+}
+
+bool ScriptFileSystem::remove(const char* path) {
+  struct stat info;
+  return stat(path, &info) != 0 || ::remove(path) == 0;
+}
+
+bool ScriptFileSystem::rename(const char* from, const char* to) {
+  return ::rename(from, to) == 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SCRIPT_FILE_SYSTEM_H
+#define SCRIPT_FILE_SYSTEM_H
+
+#include <Arduino.h>
+
+static const size_t SCRIPT_PATH_SIZE = 64;
+
+// Minimal whole-file operations under one root directory. On the ESP32 the
+// root lives on LittleFS; on the host it is a plain directory, so the cache
+// above it can be exercised without flash.
+class ScriptFileSystem {
+private:
+  char root[SCRIPT_PATH_SIZE / 2];
+  bool mounted;
+
+public:
+  ScriptFileSystem();
+  bool mount(const char* rootPath);
+  bool isMounted();
+  bool path(char* buffer, size_t size, const char* name, const char* extension);
+  bool write(const char* path, const void* data, size_t size, bool append);
+  size_t read(const char* path, size_t offset, void* buffer, size_t size);
+  long size(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+};
+
+#endif
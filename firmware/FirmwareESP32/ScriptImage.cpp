@@ -0,0 +1,85 @@
+#include "ScriptImage.h"
+
+ScriptImageReader::ScriptImageReader(const uint8_t* body, size_t size) {
+  cursor = body;
+  remaining = size;
+  failed = false;
+}
+
+bool ScriptImageReader::readHeader(uint8_t kind) {
+  uint8_t header[3];
+  return readBytes(header, sizeof(header)) && header[0] == 'P' && header[1] == kind && header[2] == SCRIPT_IMAGE_VERSION;
+}
+
+bool ScriptImageReader::readByte(uint8_t& value) {
+  return readBytes(&value, 1);
+}
+
+bool ScriptImageReader::readVarint(uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift <= 28; shift += 7) {
+    uint8_t byte;
+    if (!readByte(byte)) {
+      return false;
+    }
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  failed = true;
+  return false;
+}
+
+bool ScriptImageReader::readBytes(uint8_t* buffer, size_t length) {
+  if (failed || length > remaining) {
+    failed = true;
+    return false;
+  }
+  memcpy(buffer, cursor, length);
+  cursor += length;
+  remaining -= length;
+  return true;
+}
+
+bool ScriptImageReader::readString(char* buffer, size_t size) {
+  uint8_t length;
+  if (!readByte(length)) {
+    return false;
+  }
+  
+  uint8_t scratch[255];
+  if (!readBytes(scratch, length)) {
+    return false;
+  }
+  size_t copied = length < size ? length : size - 1;
+  memcpy(buffer, scratch, copied);
+  buffer[copied] = '\0';
+  return true;
+}
+
+// The record's text is left in the image; text points at it.
+bool ScriptImageReader::readRecord(CommandRecord& record, const char*& text) {
+  uint8_t length;
+  if (!readByte(length) || length > BINARY_COMMAND_SIZE || length > remaining) {
+    failed = true;
+    return false;
+  }
+  
+  if (!CommandCodec::fromBinary(cursor, length, record, text)) {
+    memset(&record, 0, sizeof(record));
+  }
+  cursor += length;
+  remaining -= length;
+  return true;
+}
+
+bool ScriptImageReader::skipRecord() {
+  CommandRecord record;
+  const char* text;
+  return readRecord(record, text);
+}
+
+bool ScriptImageReader::isComplete() {
+  return !failed && remaining == 0;
+}
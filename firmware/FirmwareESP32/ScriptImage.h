@@ -0,0 +1,34 @@
+#ifndef SCRIPT_IMAGE_H
+#define SCRIPT_IMAGE_H
+
+#include <Arduino.h>
+#include "CommandCodec.h"
+
+static const uint8_t SCRIPT_IMAGE_VERSION = 1;
+static const uint8_t SCRIPT_IMAGE_POLL = 'I';
+static const uint8_t SCRIPT_IMAGE_CHUNK = 'C';
+static const uint8_t SCRIPT_IMAGE_FLAG_START = 0x01;
+
+// Reads the binary script image served for ?encoding=bin (see
+// src/server/scriptImage.ts) straight out of the response buffer. Strings are a
+// u8 length plus bytes, counts are LEB128 varints and every record is a u8
+// length followed by the CommandCodec binary layout.
+class ScriptImageReader {
+private:
+  const uint8_t* cursor;
+  size_t remaining;
+  bool failed;
+
+public:
+  ScriptImageReader(const uint8_t* body, size_t size);
+  bool readHeader(uint8_t kind);
+  bool readByte(uint8_t& value);
+  bool readVarint(uint32_t& value);
+  bool readBytes(uint8_t* buffer, size_t length);
+  bool readString(char* buffer, size_t size);
+  bool readRecord(CommandRecord& record, const char*& text);
+  bool skipRecord();
+  bool isComplete();
+};
+
+#endif
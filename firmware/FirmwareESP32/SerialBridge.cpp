@@ -3,8 +3,14 @@
 SerialBridge::SerialBridge(HardwareSerial* serialPort) {
   serial = serialPort;
   responseTimeout = 5000;
-  lastResponse = "";
+  lastResponse[0] = '\0';
   waitingForResponse = false;
+  protocol = PROTOCOL_TEXT;
+  queueHead = 0;
+  queueCount = 0;
+  frameErrors = 0;
+  lineOverflows = 0;
+  resetAssembler();
 }
 
 void SerialBridge::begin(unsigned long baudRate) {
@@ -12,7 +18,24 @@ void SerialBridge::begin(unsigned long baudRate) {
   delay(100);
 }
 
+bool SerialBridge::negotiateBinary(unsigned long timeout) {
+  clearBuffer();
+  if (sendCommandAndWait("PROTO:BIN", "PROTO:BIN:OK", timeout)) {
+    protocol = PROTOCOL_BINARY;
+    resetAssembler();
+  }
+  return protocol == PROTOCOL_BINARY;
+}
+
+bool SerialBridge::isBinary() {
+  return protocol == PROTOCOL_BINARY;
+}
+
 bool SerialBridge::sendCommand(const String& command) {
+  return sendCommand(command.c_str());
+}
+
+bool SerialBridge::sendCommand(const char* command) {
   if (!serial) return false;
   
   serial->println(command);
@@ -20,6 +43,36 @@ bool SerialBridge::sendCommand(const String& command) {
   return true;
 }
 
+bool SerialBridge::sendCommand(const char* command, uint16_t sequence) {
+  if (!serial) return false;
+  
+  serial->print(command);
+  serial->print('#');
+  serial->println(sequence);
+  waitingForResponse = true;
+  return true;
+}
+
+bool SerialBridge::sendRecord(const CommandRecord& record, const char* text, const char* armName, uint16_t sequence, bool sequenced) {
+  if (!serial) return false;
+  
+  if (protocol == PROTOCOL_TEXT) {
+    char command[UART_COMMAND_SIZE];
+    if (CommandCodec::toUART(record, text, armName, command, sizeof(command)) == 0) return false;
+    return sequenced ? sendCommand(command, sequence) : sendCommand(command);
+  }
+  
+  uint8_t payload[BINARY_COMMAND_SIZE];
+  uint8_t frame[FRAME_MAX_ENCODED];
+  size_t payloadLength = CommandCodec::toBinary(record, text, payload, sizeof(payload));
+  size_t frameSize = payloadLength > 0 ? SerialFrame::encode(FRAME_COMMAND, sequence, payload, payloadLength, frame, sizeof(frame)) : 0;
+  if (frameSize == 0) return false;
+  
+  serial->write(frame, frameSize);
+  waitingForResponse = true;
+  return true;
+}
+
 bool SerialBridge::sendCommandAndWait(const String& command, const String& expectedResponse, unsigned long timeout) {
   if (!sendCommand(command)) return false;
   
@@ -37,27 +90,190 @@ bool SerialBridge::sendCommandAndWait(const String& command, const String& expec
 }
 
 String SerialBridge::getLastResponse() {
-  return lastResponse;
+  return String(lastResponse);
 }
 
 bool SerialBridge::hasResponse() {
-  return serial->available() > 0;
+  poll();
+  return queueCount > 0;
 }
 
 String SerialBridge::readResponse() {
-  if (!hasResponse()) return "";
+  SerialResponse response;
+  if (!readResponse(response)) return "";
+  return String(response.text);
+}
+
+bool SerialBridge::readResponse(SerialResponse& response) {
+  poll();
+  if (queueCount == 0) return false;
+  
+  response = queue[queueHead];
+  queueHead = (queueHead + 1) % SERIAL_QUEUE_SIZE;
+  queueCount--;
   
-  String response = serial->readStringUntil('\n');
-  response.trim();
-  lastResponse = response;
+  memcpy(lastResponse, response.text, SERIAL_RESPONSE_TEXT_SIZE);
   waitingForResponse = false;
-  return response;
+  return true;
+}
+
+void SerialBridge::poll() {
+  if (!serial) return;
+  
+  int available = serial->available();
+  while (available-- > 0 && queueCount < SERIAL_QUEUE_SIZE) {
+    int byte = serial->read();
+    if (byte < 0) break;
+    if (protocol == PROTOCOL_BINARY) {
+      consumeFrameByte(byte);
+    } else {
+      consumeTextByte(byte);
+    }
+  }
+}
+
+void SerialBridge::consumeTextByte(uint8_t byte) {
+  if (rxLength == 0 && !rxOverflow) {
+    rxStartMicros = micros();
+  }
+  if (byte != '\n') {
+    if (rxLength < SERIAL_LINE_SIZE - 1) {
+      rxBuffer[rxLength++] = byte;
+    } else {
+      rxOverflow = true;
+    }
+    return;
+  }
+  
+  if (rxOverflow) {
+    lineOverflows++;
+    resetAssembler();
+    return;
+  }
+  
+  while (rxLength > 0 && (rxBuffer[rxLength - 1] == '\r' || rxBuffer[rxLength - 1] == ' ' || rxBuffer[rxLength - 1] == '\t')) {
+    rxLength--;
+  }
+  rxBuffer[rxLength] = '\0';
+  
+  const char* line = (const char*)rxBuffer;
+  while (*line == ' ' || *line == '\t') line++;
+  
+  SerialResponse& response = queue[(queueHead + queueCount) % SERIAL_QUEUE_SIZE];
+  parseTextResponse(line, response);
+  response.firstByteMicros = rxStartMicros;
+  queueCount++;
+  resetAssembler();
+}
+
+void SerialBridge::consumeFrameByte(uint8_t byte) {
+  if (rxLength == 0 && !rxOverflow) {
+    rxStartMicros = micros();
+  }
+  if (byte != 0x00) {
+    if (rxLength < sizeof(rxBuffer)) {
+      rxBuffer[rxLength++] = byte;
+    } else {
+      rxOverflow = true;
+    }
+    return;
+  }
+  
+  SerialResponse& response = queue[(queueHead + queueCount) % SERIAL_QUEUE_SIZE];
+  if (!rxOverflow && rxLength > 0 && decodeFrame(response)) {
+    response.firstByteMicros = rxStartMicros;
+    queueCount++;
+  } else if (rxLength > 0 || rxOverflow) {
+    frameErrors++;
+  }
+  resetAssembler();
+}
+
+void SerialBridge::resetAssembler() {
+  rxLength = 0;
+  rxOverflow = false;
+  rxStartMicros = 0;
+}
+
+void SerialBridge::parseTextResponse(const char* line, SerialResponse& response) {
+  response.hasSequence = false;
+  response.sequence = 0;
+  response.credits = -1;
+  strncpy(response.text, line, SERIAL_RESPONSE_TEXT_SIZE - 1);
+  response.text[SERIAL_RESPONSE_TEXT_SIZE - 1] = '\0';
+  
+  if (strncmp(line, "OK", 2) == 0) {
+    response.type = RESPONSE_OK;
+  } else if (strncmp(line, "DONE", 4) == 0) {
+    response.type = RESPONSE_DONE;
+  } else if (strncmp(line, "ERROR", 5) == 0) {
+    response.type = RESPONSE_ERROR;
+  } else {
+    response.type = RESPONSE_INFO;
+    return;
+  }
+  
+  const char* hash = strrchr(line, '#');
+  if (!hash) {
+    return;
+  }
+  
+  char* end;
+  response.hasSequence = true;
+  response.sequence = (uint16_t)strtoul(hash + 1, &end, 10);
+  if (*end == '/') {
+    response.credits = (int)strtol(end + 1, nullptr, 10);
+  }
+}
+
+bool SerialBridge::decodeFrame(SerialResponse& response) {
+  uint8_t type;
+  uint8_t payload[FRAME_MAX_RAW];
+  size_t payloadLength = 0;
+  if (!SerialFrame::decode(rxBuffer, rxLength, type, response.sequence, payload, payloadLength)) {
+    return false;
+  }
+  
+  response.hasSequence = true;
+  response.credits = -1;
+  switch (type) {
+    case FRAME_OK:
+    case FRAME_DONE:
+      response.type = type == FRAME_OK ? RESPONSE_OK : RESPONSE_DONE;
+      if (payloadLength > 0) {
+        response.credits = payload[0];
+        snprintf(response.text, SERIAL_RESPONSE_TEXT_SIZE, "%s#%u/%d", type == FRAME_OK ? "OK" : "DONE", response.sequence, response.credits);
+      } else {
+        snprintf(response.text, SERIAL_RESPONSE_TEXT_SIZE, "%s#%u", type == FRAME_OK ? "OK" : "DONE", response.sequence);
+      }
+      return true;
+    case FRAME_ERROR:
+    case FRAME_INFO:
+      response.type = type == FRAME_ERROR ? RESPONSE_ERROR : RESPONSE_INFO;
+      if (payloadLength >= SERIAL_RESPONSE_TEXT_SIZE) payloadLength = SERIAL_RESPONSE_TEXT_SIZE - 1;
+      memcpy(response.text, payload, payloadLength);
+      response.text[payloadLength] = '\0';
+      return true;
+    default:
+      return false;
+  }
+}
+
+unsigned long SerialBridge::getFrameErrors() {
+  return frameErrors;
+}
+
+unsigned long SerialBridge::getLineOverflows() {
+  return lineOverflows;
 }
 
 void SerialBridge::clearBuffer() {
   while (serial->available()) {
     serial->read();
   }
+  queueHead = 0;
+  queueCount = 0;
+  resetAssembler();
 }
 
 bool SerialBridge::isReady() {
@@ -2,24 +2,77 @@
 #define SERIAL_BRIDGE_H
 
 #include <Arduino.h>
+#include "CommandCodec.h"
+#include "SerialFrame.h"
+
+static const int SERIAL_RESPONSE_TEXT_SIZE = 64;
+static const int SERIAL_LINE_SIZE = 96;
+static const int SERIAL_RX_BUFFER_SIZE = SERIAL_LINE_SIZE > FRAME_MAX_ENCODED ? SERIAL_LINE_SIZE : FRAME_MAX_ENCODED;
+static const int SERIAL_QUEUE_SIZE = 8;
+
+enum SerialProtocol : uint8_t {
+  PROTOCOL_TEXT,
+  PROTOCOL_BINARY
+};
+
+enum ResponseType : uint8_t {
+  RESPONSE_INFO,
+  RESPONSE_OK,
+  RESPONSE_DONE,
+  RESPONSE_ERROR
+};
+
+struct SerialResponse {
+  uint8_t type;
+  bool hasSequence;
+  uint16_t sequence;
+  int credits;
+  unsigned long firstByteMicros;
+  char text[SERIAL_RESPONSE_TEXT_SIZE];
+};
 
 class SerialBridge {
 private:
   HardwareSerial* serial;
   unsigned long responseTimeout;
-  String lastResponse;
+  char lastResponse[SERIAL_RESPONSE_TEXT_SIZE];
   bool waitingForResponse;
+  SerialProtocol protocol;
+  uint8_t rxBuffer[SERIAL_RX_BUFFER_SIZE];
+  size_t rxLength;
+  bool rxOverflow;
+  unsigned long rxStartMicros;
+  SerialResponse queue[SERIAL_QUEUE_SIZE];
+  uint8_t queueHead;
+  uint8_t queueCount;
+  unsigned long frameErrors;
+  unsigned long lineOverflows;
+
+  void poll();
+  void consumeTextByte(uint8_t byte);
+  void consumeFrameByte(uint8_t byte);
+  void resetAssembler();
+  bool decodeFrame(SerialResponse& response);
+  void parseTextResponse(const char* line, SerialResponse& response);
 
 public:
   SerialBridge(HardwareSerial* serialPort);
   void begin(unsigned long baudRate);
+  bool negotiateBinary(unsigned long timeout = 200);
+  bool isBinary();
   bool sendCommand(const String& command);
+  bool sendCommand(const char* command);
+  bool sendCommand(const char* command, uint16_t sequence);
+  bool sendRecord(const CommandRecord& record, const char* text, const char* armName, uint16_t sequence, bool sequenced);
   bool sendCommandAndWait(const String& command, const String& expectedResponse, unsigned long timeout = 5000);
   String getLastResponse();
   bool hasResponse();
   String readResponse();
+  bool readResponse(SerialResponse& response);
+  unsigned long getFrameErrors();
+  unsigned long getLineOverflows();
   void clearBuffer();
   bool isReady();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,96 @@
+#include "SerialFrame.h"
+
+uint16_t SerialFrame::crc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+size_t SerialFrame::encode(uint8_t type, uint16_t sequence, const uint8_t* payload, size_t payloadLength, uint8_t* out, size_t outSize) {
+  if (payloadLength > FRAME_MAX_PAYLOAD || outSize < FRAME_MAX_ENCODED) {
+    return 0;
+  }
+
+  uint8_t raw[FRAME_MAX_RAW];
+  raw[0] = type;
+  raw[1] = sequence & 0xFF;
+  raw[2] = sequence >> 8;
+  memcpy(raw + FRAME_HEADER_SIZE, payload, payloadLength);
+
+  size_t rawLength = FRAME_HEADER_SIZE + payloadLength;
+  uint16_t crc = crc16(raw, rawLength);
+  raw[rawLength++] = crc & 0xFF;
+  raw[rawLength++] = crc >> 8;
+
+  size_t encodedLength = cobsEncode(raw, rawLength, out);
+  out[encodedLength++] = 0x00;
+  return encodedLength;
+}
+
+bool SerialFrame::decode(const uint8_t* encoded, size_t length, uint8_t& type, uint16_t& sequence, uint8_t* payload, size_t& payloadLength) {
+  if (length == 0 || length > FRAME_MAX_ENCODED) {
+    return false;
+  }
+
+  uint8_t raw[FRAME_MAX_ENCODED];
+  size_t rawLength = cobsDecode(encoded, length, raw);
+  if (rawLength < FRAME_HEADER_SIZE + FRAME_CRC_SIZE || rawLength > FRAME_MAX_RAW) {
+    return false;
+  }
+
+  size_t dataLength = rawLength - FRAME_CRC_SIZE;
+  uint16_t crc = raw[dataLength] | ((uint16_t)raw[dataLength + 1] << 8);
+  if (crc != crc16(raw, dataLength)) {
+    return false;
+  }
+
+  type = raw[0];
+  sequence = raw[1] | ((uint16_t)raw[2] << 8);
+  payloadLength = dataLength - FRAME_HEADER_SIZE;
+  memcpy(payload, raw + FRAME_HEADER_SIZE, payloadLength);
+  return true;
+}
+
+size_t SerialFrame::cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t codeIndex = 0;
+  size_t outIndex = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] != 0) {
+      out[outIndex++] = in[i];
+      code++;
+    }
+    if (in[i] == 0 || code == 0xFF) {
+      out[codeIndex] = code;
+      codeIndex = outIndex++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  return outIndex;
+}
+
+size_t SerialFrame::cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+  size_t inIndex = 0;
+  size_t outIndex = 0;
+
+  while (inIndex < length) {
+    uint8_t code = in[inIndex++];
+    if (code == 0 || inIndex + code - 1 > length) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      out[outIndex++] = in[inIndex++];
+    }
+    if (code != 0xFF && inIndex < length) {
+      out[outIndex++] = 0;
+    }
+  }
+  return outIndex;
+}
@@ -0,0 +1,34 @@
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <Arduino.h>
+#include "CommandCodec.h"
+
+enum FrameType : uint8_t {
+  FRAME_COMMAND = 0x01,
+  FRAME_OK = 0x81,
+  FRAME_DONE = 0x82,
+  FRAME_ERROR = 0x83,
+  FRAME_INFO = 0x84
+};
+
+static const int FRAME_HEADER_SIZE = 3;
+static const int FRAME_CRC_SIZE = 2;
+static const int FRAME_MAX_PAYLOAD = BINARY_COMMAND_SIZE;
+static const int FRAME_MAX_RAW = FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE;
+static const int FRAME_MAX_ENCODED = FRAME_MAX_RAW + FRAME_MAX_RAW / 254 + 2;
+
+// Binary frames are [type][seq lo][seq hi][payload...][crc lo][crc hi],
+// COBS-encoded and terminated by a single 0x00 byte on the wire.
+class SerialFrame {
+public:
+  static uint16_t crc16(const uint8_t* data, size_t length);
+  static size_t encode(uint8_t type, uint16_t sequence, const uint8_t* payload, size_t payloadLength, uint8_t* out, size_t outSize);
+  static bool decode(const uint8_t* encoded, size_t length, uint8_t& type, uint16_t& sequence, uint8_t* payload, size_t& payloadLength);
+
+private:
+  static size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+  static size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out);
+};
+
+#endif
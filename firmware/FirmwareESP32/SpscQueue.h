@@ -0,0 +1,52 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free single-producer/single-consumer ring. One task may push and one
+// other task may pop; neither side ever blocks or takes a lock.
+template <typename T, size_t N>
+class SpscQueue {
+private:
+  T items[N];
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  bool push(const T& item) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    items[currentTail % N] = item;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[currentHead % N];
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+
+  size_t freeSlots() const {
+    return N - size();
+  }
+
+  bool isEmpty() const {
+    return size() == 0;
+  }
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "TaskRunner.h"
+
+#if defined(ESP32)
+
+TaskRunner::TaskRunner() : function(nullptr), context(nullptr), finished(xSemaphoreCreateBinary()), running(false) {
+}
+
+TaskRunner::~TaskRunner() {
+  join();
+  vSemaphoreDelete(finished);
+}
+
+bool TaskRunner::start(const char* name, TaskFunction function, void* context, uint32_t stackSize, int priority, int core) {
+  if (running || !finished) {
+    return false;
+  }
+  this->function = function;
+  this->context = context;
+  running = xTaskCreatePinnedToCore(run, name, stackSize, this, priority, nullptr, core) == pdPASS;
+  return running;
+}
+
+void TaskRunner::run(void* runner) {
+  TaskRunner* self = static_cast<TaskRunner*>(runner);
+  self->function(self->context);
+  xSemaphoreGive(self->finished);
+  vTaskDelete(nullptr);
+}
+
+void TaskRunner::join() {
+  if (!running) {
+    return;
+  }
+  xSemaphoreTake(finished, portMAX_DELAY);
+  running = false;
+}
+
+// Always blocks for at least one tick: taskYIELD() only gives way to tasks of
+// the same priority, so it would starve loopTask on the dispatch core.
+void TaskRunner::sleep(unsigned long milliseconds) {
+  TickType_t ticks = pdMS_TO_TICKS(milliseconds);
+  vTaskDelay(ticks > 0 ? ticks : 1);
+}
+
+#else
+
+#include <chrono>
+
+TaskRunner::TaskRunner() : function(nullptr), context(nullptr), running(false) {
+}
+
+TaskRunner::~TaskRunner() {
+  join();
+}
+
+bool TaskRunner::start(const char* name, TaskFunction function, void* context, uint32_t stackSize, int priority, int core) {
+  if (running) {
+    return false;
+  }
+  this->function = function;
+  this->context = context;
+  thread = std::thread(function, context);
+  running = true;
+  return true;
+}
+
+void TaskRunner::join() {
+  if (!running) {
+    return;
+  }
+  thread.join();
+  running = false;
+}
+
+void TaskRunner::sleep(unsigned long milliseconds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds > 0 ? milliseconds : 1));
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TASK_RUNNER_H
+#define TASK_RUNNER_H
+
+#include <Arduino.h>
+
+#if !defined(ESP32)
+#include <thread>
+#endif
+
+typedef void (*TaskFunction)(void* context);
+
+// One pinned FreeRTOS task on the ESP32, a thread on the host. join() returns
+// once the task function has returned.
+class TaskRunner {
+private:
+  TaskFunction function;
+  void* context;
+#if defined(ESP32)
+  SemaphoreHandle_t finished;
+  static void run(void* runner);
+#else
+  std::thread thread;
+#endif
+  bool running;
+
+public:
+  TaskRunner();
+  ~TaskRunner();
+  bool start(const char* name, TaskFunction function, void* context, uint32_t stackSize, int priority, int core);
+  void join();
+  static void sleep(unsigned long milliseconds);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "TelemetryRing.h"
+
+TelemetryRing::TelemetryRing() : count(0) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool TelemetryRing::add(const TelemetryRecord& record) {
+  if (coalesce(record)) {
+    stats.coalesced++;
+    return true;
+  }
+
+  if (count == TELEMETRY_RING_SIZE) {
+    int victim = lowestPriority();
+    if (records[victim].kind > record.kind) {
+      stats.dropped[record.kind]++;
+      return false;
+    }
+    stats.dropped[records[victim].kind]++;
+    removeAt(victim);
+  }
+
+  records[count++] = record;
+  stats.added++;
+  return true;
+}
+
+// Only the arm's most recent record is a merge candidate, so an error or a
+// script change between two completions keeps them apart.
+bool TelemetryRing::coalesce(const TelemetryRecord& record) {
+  if (record.kind == TELEMETRY_POSITION) {
+    for (int i = count - 1; i >= 0; i--) {
+      if (records[i].armIndex == record.armIndex && records[i].kind == TELEMETRY_POSITION) {
+        records[i] = record;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (record.kind != TELEMETRY_COMPLETION) {
+    return false;
+  }
+  for (int i = count - 1; i >= 0; i--) {
+    TelemetryRecord& last = records[i];
+    if (last.armIndex != record.armIndex || last.kind == TELEMETRY_POSITION) {
+      continue;
+    }
+    if (last.kind != TELEMETRY_COMPLETION || last.lastIndex + 1 != record.firstIndex || last.count == UINT16_MAX) {
+      return false;
+    }
+    last.lastIndex = record.lastIndex;
+    last.count += record.count;
+    last.timeMs = record.timeMs;
+    return true;
+  }
+  return false;
+}
+
+// Oldest record of the lowest kind present.
+int TelemetryRing::lowestPriority() const {
+  int victim = 0;
+  for (int i = 1; i < count; i++) {
+    if (records[i].kind < records[victim].kind) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+void TelemetryRing::removeAt(int index) {
+  for (int i = index; i < count - 1; i++) {
+    records[i] = records[i + 1];
+  }
+  count--;
+}
+
+int TelemetryRing::drain(TelemetryRecord* out, int maxRecords) {
+  int taken = count < maxRecords ? count : maxRecords;
+  memcpy(out, records, taken * sizeof(TelemetryRecord));
+  for (int i = taken; i < count; i++) {
+    records[i - taken] = records[i];
+  }
+  count -= taken;
+  return taken;
+}
+
+int TelemetryRing::size() const {
+  return count;
+}
+
+TelemetryRingStats TelemetryRing::getStats() const {
+  return stats;
+}
+
+const char* TelemetryRing::kindName(uint8_t kind) {
+  switch (kind) {
+    case TELEMETRY_POSITION: return "position";
+    case TELEMETRY_COMPLETION: return "completion";
+    case TELEMETRY_SCRIPT: return "script";
+    case TELEMETRY_ERROR: return "error";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <Arduino.h>
+
+static const int TELEMETRY_RING_SIZE = 32;
+static const int TELEMETRY_TEXT_SIZE = 24;
+
+// Ordered by priority: when the ring is full the lowest kind is dropped first.
+enum TelemetryKind : uint8_t {
+  TELEMETRY_POSITION,
+  TELEMETRY_COMPLETION,
+  TELEMETRY_SCRIPT,
+  TELEMETRY_ERROR,
+  TELEMETRY_KIND_COUNT
+};
+
+// One upload record. A completion covers the command range firstIndex..
+// lastIndex; the other kinds carry the arm's index in firstIndex and its
+// command count in lastIndex. text is the error, the info line for a
+// position, or the script id.
+struct TelemetryRecord {
+  uint8_t kind;
+  uint8_t armIndex;
+  uint16_t count;
+  int firstIndex;
+  int lastIndex;
+  unsigned long timeMs;
+  char text[TELEMETRY_TEXT_SIZE];
+};
+
+struct TelemetryRingStats {
+  unsigned long added;
+  unsigned long coalesced;
+  unsigned long dropped[TELEMETRY_KIND_COUNT];
+};
+
+// Fixed-size, single-owner buffer of pending upload records. Completions that
+// follow on from the arm's previous completion extend it instead of taking a
+// slot, and a position replaces the arm's pending one, so a busy arm costs a
+// couple of slots between flushes no matter how many commands it runs.
+class TelemetryRing {
+private:
+  TelemetryRecord records[TELEMETRY_RING_SIZE];
+  int count;
+  TelemetryRingStats stats;
+
+  bool coalesce(const TelemetryRecord& record);
+  int lowestPriority() const;
+  void removeAt(int index);
+
+public:
+  TelemetryRing();
+  bool add(const TelemetryRecord& record);
+  int drain(TelemetryRecord* out, int maxRecords);
+  int size() const;
+  TelemetryRingStats getStats() const;
+  static const char* kindName(uint8_t kind);
+};
+
+#endif
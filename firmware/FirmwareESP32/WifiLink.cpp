@@ -0,0 +1,173 @@
+#include "WifiLink.h"
+
+static const char* WIFI_PREFS_NAMESPACE = "wifilink";
+static const char* WIFI_PREFS_AP_KEY = "ap";
+
+WifiLink::WifiLink() {
+  ssid = "";
+  password = "";
+  state = LINK_IDLE;
+  useStaticIp = false;
+  hasCachedAp = false;
+  fastAttempt = false;
+  cachedApFailures = 0;
+  attemptStart = 0;
+  retryTime = 0;
+  backoffMs = WIFI_BACKOFF_MIN_MS;
+  stats = WifiStats();
+  log = nullptr;
+}
+
+void WifiLink::setStaticIp(IPAddress ip, IPAddress gatewayIp, IPAddress subnetMask, IPAddress dnsServer) {
+  localIp = ip;
+  gateway = gatewayIp;
+  subnet = subnetMask;
+  dns = dnsServer;
+  useStaticIp = true;
+}
+
+void WifiLink::begin(const char* networkSsid, const char* networkPassword, DeferredLog& deferredLog) {
+  ssid = networkSsid;
+  password = networkPassword;
+  log = &deferredLog;
+
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+  WiFi.setSleep(false);
+  if (useStaticIp) {
+    WiFi.config(localIp, gateway, subnet, dns);
+  }
+
+  loadCachedAp();
+  startAttempt();
+}
+
+// Returns true while the link is up. Call it often; it only ever checks
+// status and, when a deadline has passed, kicks off the next attempt.
+bool WifiLink::update() {
+  bool connected = WiFi.status() == WL_CONNECTED;
+
+  switch (state) {
+    case LINK_CONNECTING:
+      if (connected) {
+        onConnected();
+      } else if (millis() - attemptStart >= (fastAttempt ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS)) {
+        onAttemptFailed();
+      }
+      break;
+    case LINK_CONNECTED:
+      if (!connected) {
+        stats.disconnects++;
+        DLOG(*log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "WiFi lost, reconnecting", nullptr);
+        backoffMs = WIFI_BACKOFF_MIN_MS;
+        startAttempt();
+      }
+      break;
+    case LINK_BACKOFF:
+      if ((long)(millis() - retryTime) >= 0) {
+        startAttempt();
+      }
+      break;
+    default:
+      break;
+  }
+  return state == LINK_CONNECTED;
+}
+
+void WifiLink::startAttempt() {
+  WiFi.disconnect();
+  fastAttempt = hasCachedAp;
+  if (fastAttempt) {
+    WiFi.begin(ssid, password, cachedAp.channel, cachedAp.bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+  attemptStart = millis();
+  state = LINK_CONNECTING;
+}
+
+void WifiLink::onConnected() {
+  stats.connects++;
+  stats.lastConnectMs = millis() - attemptStart;
+  if (stats.associatedAtMs == 0) {
+    stats.associatedAtMs = millis();
+  }
+  if (fastAttempt) {
+    stats.fastConnects++;
+  }
+  backoffMs = WIFI_BACKOFF_MIN_MS;
+  cachedApFailures = 0;
+  state = LINK_CONNECTED;
+  storeCachedAp();
+  DLOG(*log, LOG_LEVEL_INFO, LOG_TAG_SYSTEM, "WiFi connected in %dms%s", fastAttempt ? " (cached AP)" : "", stats.lastConnectMs);
+}
+
+void WifiLink::onAttemptFailed() {
+  stats.failedAttempts++;
+  WiFi.disconnect();
+  // The AP may just be rebooting, so the cache outlives a few misses.
+  if (fastAttempt && ++cachedApFailures >= WIFI_CACHED_AP_MAX_FAILURES) {
+    DLOG(*log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "Cached AP failed %d times, scanning", nullptr, cachedApFailures);
+    cachedApFailures = 0;
+    clearCachedAp();
+    startAttempt();
+    return;
+  }
+
+  retryTime = millis() + backoffMs;
+  DLOG(*log, LOG_LEVEL_WARN, LOG_TAG_SYSTEM, "WiFi connect failed, retry in %dms", nullptr, backoffMs);
+  backoffMs = backoffMs * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : backoffMs * 2;
+  state = LINK_BACKOFF;
+}
+
+void WifiLink::loadCachedAp() {
+  Preferences prefs;
+  hasCachedAp = prefs.begin(WIFI_PREFS_NAMESPACE, true) &&
+                prefs.getBytes(WIFI_PREFS_AP_KEY, &cachedAp, sizeof(cachedAp)) == sizeof(cachedAp) &&
+                cachedAp.channel > 0;
+  prefs.end();
+}
+
+void WifiLink::storeCachedAp() {
+  WifiAccessPoint current;
+  memset(&current, 0, sizeof(current));
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) {
+    return;
+  }
+  memcpy(current.bssid, bssid, WIFI_BSSID_SIZE);
+  current.channel = WiFi.channel();
+  if (hasCachedAp && memcmp(current.bssid, cachedAp.bssid, WIFI_BSSID_SIZE) == 0 && current.channel == cachedAp.channel) {
+    return;
+  }
+
+  cachedAp = current;
+  hasCachedAp = true;
+  Preferences prefs;
+  if (prefs.begin(WIFI_PREFS_NAMESPACE, false)) {
+    prefs.putBytes(WIFI_PREFS_AP_KEY, &cachedAp, sizeof(cachedAp));
+  }
+  prefs.end();
+}
+
+void WifiLink::clearCachedAp() {
+  hasCachedAp = false;
+  Preferences prefs;
+  if (prefs.begin(WIFI_PREFS_NAMESPACE, false)) {
+    prefs.remove(WIFI_PREFS_AP_KEY);
+  }
+  prefs.end();
+}
+
+bool WifiLink::isConnected() {
+  return state == LINK_CONNECTED;
+}
+
+LinkState WifiLink::getState() {
+  return state;
+}
+
+WifiStats WifiLink::getStats() {
+  return stats;
+}
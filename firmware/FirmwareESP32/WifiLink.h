@@ -0,0 +1,80 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <WiFi.h>
+#include <Preferences.h>
+#include "DeferredLog.h"
+
+static const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+static const unsigned long WIFI_CONNECT_TIMEOUT_MS = 15000;
+static const unsigned long WIFI_BACKOFF_MIN_MS = 500;
+static const unsigned long WIFI_BACKOFF_MAX_MS = 30000;
+static const int WIFI_BSSID_SIZE = 6;
+static const int WIFI_CACHED_AP_MAX_FAILURES = 3;
+
+enum LinkState : uint8_t {
+  LINK_IDLE,
+  LINK_CONNECTING,
+  LINK_CONNECTED,
+  LINK_BACKOFF
+};
+
+struct WifiStats {
+  unsigned long connects;
+  unsigned long fastConnects;
+  unsigned long disconnects;
+  unsigned long failedAttempts;
+  unsigned long lastConnectMs;
+  unsigned long associatedAtMs;
+};
+
+struct WifiAccessPoint {
+  uint8_t bssid[WIFI_BSSID_SIZE];
+  int32_t channel;
+};
+
+// Station link that never blocks the caller. The first attempt after boot
+// reuses the BSSID and channel of the last good association (kept in NVS)
+// so it skips the scan. Only after WIFI_CACHED_AP_MAX_FAILURES fast attempts
+// in a row fail is the cache dropped and the next attempt a normal scan, so
+// one missed reconnect does not cost a flash write. Drops are retried with
+// exponential backoff.
+
+class WifiLink {
+private:
+  const char* ssid;
+  const char* password;
+  LinkState state;
+  bool useStaticIp;
+  IPAddress localIp;
+  IPAddress gateway;
+  IPAddress subnet;
+  IPAddress dns;
+  WifiAccessPoint cachedAp;
+  bool hasCachedAp;
+  bool fastAttempt;
+  int cachedApFailures;
+  unsigned long attemptStart;
+  unsigned long retryTime;
+  unsigned long backoffMs;
+  WifiStats stats;
+  DeferredLog* log;
+
+  void startAttempt();
+  void onConnected();
+  void onAttemptFailed();
+  void loadCachedAp();
+  void storeCachedAp();
+  void clearCachedAp();
+
+public:
+  WifiLink();
+  void setStaticIp(IPAddress ip, IPAddress gatewayIp, IPAddress subnetMask, IPAddress dnsServer);
+  void begin(const char* networkSsid, const char* networkPassword, DeferredLog& deferredLog);
+  bool update();
+  bool isConnected();
+  LinkState getState();
+  WifiStats getStats();
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include <signal.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "CommandForwarder.h"
+#include "TraceRecorder.h"
+
+// Host entry point standing in for FirmwareESP32.ino. Arm UARTs are ptys by
+// default; their paths are printed so an arm simulator can open them.
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal) {
+  stopRequested = 1;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--server host:port] [--arm1 pty|path] [--arm2 pty|path]\n"
+          "          [--pipeline depth] [--binary] [--encoding json|bin]\n"
+          "          [--duration seconds] [--data dir] [--record trace]\n",
+          program);
+}
+
+static bool attachArm(HardwareSerial& port, const char* name, const char* target) {
+  if (strcmp(target, "pty") == 0) {
+    const char* path = port.openPty();
+    if (!path) {
+      fprintf(stderr, "%s: cannot open pty\n", name);
+      return false;
+    }
+    printf("%s UART: %s\n", name, path);
+    return true;
+  }
+  if (!port.openDevice(target)) {
+    fprintf(stderr, "%s: cannot open %s\n", name, target);
+    return false;
+  }
+  printf("%s UART: %s\n", name, target);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  String serverHost = "127.0.0.1";
+  int serverPort = 3006;
+  const char* arm1 = "pty";
+  const char* arm2 = "pty";
+  const char* dataDir = nullptr;
+  const char* tracePath = nullptr;
+  int pipelineDepth = 0;
+  bool binaryProtocol = false;
+  bool binaryEncoding = false;
+  long durationSeconds = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char* option = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(option, "--binary") == 0) {
+      binaryProtocol = true;
+      continue;
+    }
+    if (!value) {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+    if (strcmp(option, "--server") == 0) {
+      String address = value;
+      int colon = address.lastIndexOf(':');
+      serverHost = colon < 0 ? address : address.substring(0, colon);
+      serverPort = colon < 0 ? serverPort : address.substring(colon + 1).toInt();
+    } else if (strcmp(option, "--arm1") == 0) {
+      arm1 = value;
+    } else if (strcmp(option, "--arm2") == 0) {
+      arm2 = value;
+    } else if (strcmp(option, "--pipeline") == 0) {
+      pipelineDepth = atoi(value);
+    } else if (strcmp(option, "--encoding") == 0) {
+      binaryEncoding = strcmp(value, "bin") == 0;
+    } else if (strcmp(option, "--duration") == 0) {
+      durationSeconds = atol(value);
+    } else if (strcmp(option, "--data") == 0) {
+      dataDir = value;
+    } else if (strcmp(option, "--record") == 0) {
+      tracePath = value;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  // Resolved before --data moves the working directory.
+  std::string traceFile = tracePath ? std::filesystem::absolute(tracePath).string() : "";
+
+  // The script cache and NVS stand-in live under the working directory.
+  if (dataDir && chdir(dataDir) != 0) {
+    fprintf(stderr, "cannot enter %s\n", dataDir);
+    return 1;
+  }
+  if (!attachArm(Serial1, "arm1", arm1) || !attachArm(Serial2, "arm2", arm2)) {
+    return 1;
+  }
+  fflush(stdout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  static CommandForwarder forwarder;
+  if (pipelineDepth > 0 && !forwarder.setPipelineDepth(pipelineDepth)) {
+    fprintf(stderr, "invalid pipeline depth %d\n", pipelineDepth);
+    return 2;
+  }
+  forwarder.setBinaryProtocol(binaryProtocol);
+  forwarder.setScriptEncoding(binaryEncoding ? SCRIPT_ENCODING_BINARY : SCRIPT_ENCODING_JSON);
+
+  // Recording starts before initialize() so the binary handshake is in the
+  // trace. Replay expects an empty script cache, like a fresh --data.
+  static TraceRecorder recorder;
+  if (tracePath) {
+    String config = "pipeline=" + String(forwarder.getPipelineDepth()) + "\nbinary=" + String(binaryProtocol ? 1 : 0) +
+                    "\nencoding=" + (binaryEncoding ? "bin" : "json") + "\n";
+    if (!recorder.start(traceFile.c_str(), config.c_str())) {
+      fprintf(stderr, "cannot write %s\n", traceFile.c_str());
+      return 1;
+    }
+  }
+  forwarder.initialize("host", "", serverHost.c_str(), serverPort);
+  if (!forwarder.startTasks()) {
+    fprintf(stderr, "cannot start forwarder tasks\n");
+    return 1;
+  }
+
+  unsigned long start = millis();
+  while (!stopRequested && (durationSeconds <= 0 || millis() - start < (unsigned long)durationSeconds * 1000)) {
+    forwarder.update();
+  }
+
+  forwarder.stopTasks();
+  recorder.stop();
+  forwarder.printDetailedStatus();
+  return 0;
+}
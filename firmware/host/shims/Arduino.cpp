@@ -0,0 +1,259 @@
+#include "Arduino.h"
+#include "HostClock.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static std::string formatInteger(unsigned long long magnitude, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  char digits[72];
+  int count = 0;
+  do {
+    int digit = magnitude % base;
+    digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    magnitude /= base;
+  } while (magnitude > 0);
+  std::string text = negative ? "-" : "";
+  while (count > 0) {
+    text += digits[--count];
+  }
+  return text;
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+  // Like the core, only base 10 prints a sign; other bases show the bit pattern.
+  if (base == 10 && value < 0) {
+    return formatInteger(0ULL - (unsigned long long)value, true, base);
+  }
+  return formatInteger((unsigned long long)value, false, base);
+}
+
+String::String(unsigned char value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : text(base == 10 ? formatSigned(value, base) : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : text(base == 10 ? formatSigned(value, base) : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : text(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : text(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : text(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned int decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+  text = buffer;
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+  return text.size() == other.text.size() && strcasecmp(text.c_str(), other.text.c_str()) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return text.size() >= suffix.text.size() &&
+         text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+  size_t position = text.find(value, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const String& value, unsigned int from) const {
+  size_t position = text.find(value.text, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char value, unsigned int from) const {
+  size_t position = text.rfind(value, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(const String& value) const {
+  size_t position = text.rfind(value.text);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= text.size()) {
+    return String();
+  }
+  return String(text.substr(from, to - from));
+}
+
+void String::replace(const String& find, const String& replacement) {
+  if (find.text.empty()) {
+    return;
+  }
+  size_t position = 0;
+  while ((position = text.find(find.text, position)) != std::string::npos) {
+    text.replace(position, find.text.size(), replacement.text);
+    position += replacement.text.size();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < text.size()) {
+    text.erase(index, count);
+  }
+}
+
+void String::toLowerCase() {
+  for (char& c : text) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char& c : text) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < text.size() && isspace((unsigned char)text[begin])) begin++;
+  size_t end = text.size();
+  while (end > begin && isspace((unsigned char)text[end - 1])) end--;
+  text = text.substr(begin, end - begin);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (written < size && write(buffer[written])) {
+    written++;
+  }
+  return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  if ((size_t)length < sizeof(buffer)) {
+    return write((const uint8_t*)buffer, length);
+  }
+
+  std::string large(length + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&large[0], large.size(), format, args);
+  va_end(args);
+  return write((const uint8_t*)large.data(), length);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    yield();
+  } while (millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+String Stream::readString() {
+  String result;
+  for (int c = timedRead(); c >= 0; c = timedRead()) {
+    result += (char)c;
+  }
+  return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  for (int c = timedRead(); c >= 0 && c != terminator; c = timedRead()) {
+    result += (char)c;
+  }
+  return result;
+}
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+static std::atomic<bool> virtualClock(false);
+static std::atomic<uint64_t> virtualMicros(0);
+static ClockHook clockHook = nullptr;
+static void* clockHookContext = nullptr;
+
+void HostClock::useVirtual(uint64_t startMicros) {
+  virtualMicros = startMicros;
+  virtualClock = true;
+}
+
+bool HostClock::isVirtual() {
+  return virtualClock;
+}
+
+uint64_t HostClock::now() {
+  if (virtualClock) {
+    return virtualMicros;
+  }
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void HostClock::set(uint64_t nowMicros) {
+  virtualMicros = nowMicros;
+}
+
+void HostClock::setHook(ClockHook hook, void* context) {
+  clockHook = hook;
+  clockHookContext = context;
+}
+
+static void advanceVirtual(uint64_t microseconds) {
+  if (clockHook) {
+    clockHook(clockHookContext, virtualMicros);
+  }
+  virtualMicros += microseconds;
+  if (clockHook) {
+    clockHook(clockHookContext, virtualMicros);
+  }
+}
+
+unsigned long millis() {
+  return (unsigned long)(HostClock::now() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)HostClock::now();
+}
+
+void delay(unsigned long milliseconds) {
+  if (virtualClock) {
+    advanceVirtual((uint64_t)milliseconds * 1000);
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+  }
+}
+
+void delayMicroseconds(unsigned int microseconds) {
+  if (virtualClock) {
+    advanceVirtual(microseconds);
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+  }
+}
+
+void yield() {
+  std::this_thread::yield();
+}
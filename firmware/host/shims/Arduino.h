@@ -0,0 +1,158 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino-ESP32 core the forwarder and the
+// vendored HTTPClient use. Behaviour follows the core where the firmware
+// depends on it; everything else is left out rather than faked.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper*>(text))
+#define PSTR(text) (text)
+
+class String {
+private:
+  std::string text;
+
+public:
+  String() {}
+  String(const char* value) : text(value ? value : "") {}
+  String(const __FlashStringHelper* value) : text(value ? reinterpret_cast<const char*>(value) : "") {}
+  String(const std::string& value) : text(value) {}
+  explicit String(char value) : text(1, value) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimals = 2);
+  explicit String(double value, unsigned int decimals = 2);
+
+  unsigned int length() const { return text.size(); }
+  const char* c_str() const { return text.c_str(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size) { text.reserve(size); return true; }
+  void clear() { text.clear(); }
+  explicit operator bool() const { return true; }
+
+  bool concat(const String& value) { text += value.text; return true; }
+  bool concat(const char* value) { if (value) text += value; return value != nullptr; }
+  bool concat(const char* value, unsigned int count) { if (value) text.append(value, count); return value != nullptr; }
+  bool concat(char value) { text += value; return true; }
+  template <typename T>
+  bool concat(T value) { return concat(String(value)); }
+
+  template <typename T>
+  String& operator+=(const T& value) { concat(value); return *this; }
+
+  bool equals(const String& other) const { return text == other.text; }
+  bool equals(const char* other) const { return text == (other ? other : ""); }
+  bool equalsIgnoreCase(const String& other) const;
+  bool operator==(const String& other) const { return equals(other); }
+  bool operator==(const char* other) const { return equals(other); }
+  bool operator!=(const String& other) const { return !equals(other); }
+  bool operator!=(const char* other) const { return !equals(other); }
+  bool operator<(const String& other) const { return text < other.text; }
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  bool endsWith(const String& suffix) const;
+
+  char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  void setCharAt(unsigned int index, char value) { if (index < text.size()) text[index] = value; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index) { return text[index]; }
+
+  int indexOf(char value, unsigned int from = 0) const;
+  int indexOf(const String& value, unsigned int from = 0) const;
+  int lastIndexOf(char value) const { return lastIndexOf(value, (unsigned int)-1); }
+  int lastIndexOf(char value, unsigned int from) const;
+  int lastIndexOf(const String& value) const;
+  String substring(unsigned int from) const { return substring(from, text.size()); }
+  String substring(unsigned int from, unsigned int to) const;
+
+  void replace(const String& find, const String& replacement);
+  void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return (float)atof(text.c_str()); }
+
+  friend String operator+(const String& left, const String& right) { String sum(left); sum.concat(right); return sum; }
+  friend String operator+(const String& left, const char* right) { String sum(left); sum.concat(right); return sum; }
+  friend String operator+(const char* left, const String& right) { String sum(left); sum.concat(right); return sum; }
+  friend String operator+(const String& left, char right) { String sum(left); sum.concat(right); return sum; }
+};
+
+class Print {
+private:
+  int writeError;
+
+protected:
+  void setWriteError(int error = 1) { writeError = error; }
+
+public:
+  Print() : writeError(0) {}
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+  int getWriteError() { return writeError; }
+  void clearWriteError() { setWriteError(0); }
+
+  size_t print(const String& value) { return write((const uint8_t*)value.c_str(), value.length()); }
+  size_t print(const char* value) { return write(value); }
+  size_t print(const __FlashStringHelper* value) { return write(reinterpret_cast<const char*>(value)); }
+  size_t print(char value) { return write((uint8_t)value); }
+  template <typename T>
+  size_t print(T value) { return print(String(value)); }
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(T value) { return print(value) + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+protected:
+  unsigned long timeout;
+  int timedRead();
+
+public:
+  Stream() : timeout(1000) {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long milliseconds) { timeout = milliseconds; }
+  unsigned long getTimeout() const { return timeout; }
+  virtual size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readString();
+  String readStringUntil(char terminator);
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long milliseconds);
+void delayMicroseconds(unsigned int microseconds);
+void yield();
+
+#include "HardwareSerial.h"
+
+#endif
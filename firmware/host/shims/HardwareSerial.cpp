@@ -0,0 +1,184 @@
+#include "HardwareSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+static void setNonBlocking(int descriptor) {
+  fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL, 0) | O_NONBLOCK);
+}
+
+HardwareSerial::HardwareSerial(int uartNumber)
+    : uartNumber(uartNumber), fd(-1), ownsFd(false), rxHead(0), rxTail(0), txBytes(0), rxBytes(0), tap(nullptr), tapContext(nullptr) {
+  if (uartNumber == 0) {
+    fd = STDOUT_FILENO;
+  }
+}
+
+HardwareSerial::~HardwareSerial() {
+  detach();
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+}
+
+void HardwareSerial::end() {
+}
+
+bool HardwareSerial::attach(int descriptor, bool takeOwnership) {
+  detach();
+  if (descriptor < 0) {
+    return false;
+  }
+  fd = descriptor;
+  ownsFd = takeOwnership;
+  setNonBlocking(fd);
+  return true;
+}
+
+void HardwareSerial::detach() {
+  if (ownsFd && fd >= 0) {
+    ::close(fd);
+  }
+  fd = -1;
+  ownsFd = false;
+  rxHead = 0;
+  rxTail = 0;
+}
+
+// Raw mode, so bytes pass through the line discipline untouched in both
+// directions. Returns the slave path for the simulator to open.
+const char* HardwareSerial::openPty() {
+  int master;
+  int slave;
+  static char names[3][64];
+  if (openpty(&master, &slave, names[uartNumber % 3], nullptr, nullptr) < 0) {
+    return nullptr;
+  }
+  struct termios settings;
+  tcgetattr(slave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(slave, TCSANOW, &settings);
+  ::close(slave);
+  attach(master, true);
+  return names[uartNumber % 3];
+}
+
+bool HardwareSerial::openDevice(const char* path) {
+  int descriptor = ::open(path, O_RDWR | O_NOCTTY);
+  if (descriptor < 0) {
+    return false;
+  }
+  if (isatty(descriptor)) {
+    struct termios settings;
+    tcgetattr(descriptor, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(descriptor, TCSANOW, &settings);
+  }
+  return attach(descriptor, true);
+}
+
+// Connects the UART to an in-memory socket pair and returns the other end,
+// which belongs to the caller.
+int HardwareSerial::openLoopback() {
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+    return -1;
+  }
+  attach(pair[0], true);
+  return pair[1];
+}
+
+bool HardwareSerial::fill() {
+  if (rxHead < rxTail) {
+    return true;
+  }
+  if (fd < 0 || uartNumber == 0) {
+    return false;
+  }
+  ssize_t count = ::read(fd, rxBuffer, sizeof(rxBuffer));
+  if (count <= 0) {
+    return false;
+  }
+  rxHead = 0;
+  rxTail = count;
+  rxBytes += count;
+  if (tap) {
+    tap(tapContext, uartNumber, true, rxBuffer, count);
+  }
+  return true;
+}
+
+int HardwareSerial::available() {
+  fill();
+  return rxTail - rxHead;
+}
+
+int HardwareSerial::read() {
+  return fill() ? rxBuffer[rxHead++] : -1;
+}
+
+int HardwareSerial::peek() {
+  return fill() ? rxBuffer[rxHead] : -1;
+}
+
+size_t HardwareSerial::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length && fill()) {
+    size_t chunk = rxTail - rxHead < length - count ? rxTail - rxHead : length - count;
+    memcpy(buffer + count, rxBuffer + rxHead, chunk);
+    rxHead += chunk;
+    count += chunk;
+  }
+  return count;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+  return write(&value, 1);
+}
+
+// Blocks only while the peer is not draining, like a full TX FIFO would.
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (fd < 0) {
+    return size;
+  }
+  size_t written = 0;
+  while (written < size) {
+    ssize_t count = ::write(fd, buffer + written, size - written);
+    if (count > 0) {
+      written += count;
+    } else if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+      yield();
+    } else {
+      break;
+    }
+  }
+  txBytes += written;
+  if (tap && written > 0) {
+    tap(tapContext, uartNumber, false, buffer, written);
+  }
+  return written;
+}
+
+void HardwareSerial::setTap(SerialTap serialTap, void* context) {
+  tap = serialTap;
+  tapContext = context;
+}
+
+int HardwareSerial::availableForWrite() {
+  return fd < 0 ? 0 : 128;
+}
+
+void HardwareSerial::flush() {
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+  return size;
+}
@@ -0,0 +1,67 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+#include "Arduino.h"
+
+#define SERIAL_8N1 0x800001c
+
+static const size_t HOST_SERIAL_BUFFER_SIZE = 256;
+
+// Host only: sees every chunk the firmware reads from or writes to a port.
+typedef void (*SerialTap)(void* context, int uartNumber, bool inbound, const uint8_t* data, size_t length);
+
+// A UART backed by a file descriptor. Serial writes to stdout; Serial1 and
+// Serial2 stay silent until they are attached to a pty (for an external arm
+// simulator), a device path, or one end of an in-memory socket pair. Reads
+// never block, as on the ESP32 where available() only reports the RX FIFO.
+class HardwareSerial : public Stream {
+private:
+  int uartNumber;
+  int fd;
+  bool ownsFd;
+  uint8_t rxBuffer[HOST_SERIAL_BUFFER_SIZE];
+  size_t rxHead;
+  size_t rxTail;
+  unsigned long txBytes;
+  unsigned long rxBytes;
+  SerialTap tap;
+  void* tapContext;
+
+  bool fill();
+
+public:
+  explicit HardwareSerial(int uartNumber);
+  ~HardwareSerial();
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void end();
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  using Stream::readBytes;
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int availableForWrite() override;
+  void flush() override;
+  size_t setRxBufferSize(size_t size);
+  operator bool() const { return true; }
+
+  // Host only.
+  bool attach(int descriptor, bool takeOwnership);
+  void detach();
+  const char* openPty();
+  bool openDevice(const char* path);
+  int openLoopback();
+  int descriptor() const { return fd; }
+  unsigned long bytesWritten() const { return txBytes; }
+  unsigned long bytesRead() const { return rxBytes; }
+  void setTap(SerialTap serialTap, void* context);
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif
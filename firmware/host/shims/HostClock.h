@@ -0,0 +1,23 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+
+typedef void (*ClockHook)(void* context, uint64_t nowMicros);
+
+// Host only: the time base behind millis(), micros() and delay(). It follows
+// the steady clock until useVirtual() is called. From then on time moves only
+// through set(), or by the requested amount when the firmware calls delay(),
+// so one thread can step the forwarder through hours in seconds. The hook
+// runs on both sides of every delay(), so a harness can pick up what the
+// firmware just wrote and deliver whatever fell due while it was blocked.
+class HostClock {
+public:
+  static void useVirtual(uint64_t startMicros);
+  static bool isVirtual();
+  static uint64_t now();
+  static void set(uint64_t nowMicros);
+  static void setHook(ClockHook hook, void* context);
+};
+
+#endif
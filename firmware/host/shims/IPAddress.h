@@ -0,0 +1,35 @@
+#ifndef HOST_IP_ADDRESS_H
+#define HOST_IP_ADDRESS_H
+
+#include "Arduino.h"
+
+// IPv4 only. The uint32_t form is in network byte order, as on the ESP32,
+// so it can go straight into a sockaddr_in.
+class IPAddress {
+private:
+  union {
+    uint8_t bytes[4];
+    uint32_t dword;
+  } address;
+
+public:
+  IPAddress() { address.dword = 0; }
+  IPAddress(uint32_t value) { address.dword = value; }
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+    address.bytes[0] = first;
+    address.bytes[1] = second;
+    address.bytes[2] = third;
+    address.bytes[3] = fourth;
+  }
+
+  operator uint32_t() const { return address.dword; }
+  bool operator==(const IPAddress& other) const { return address.dword == other.address.dword; }
+  bool operator!=(const IPAddress& other) const { return address.dword != other.address.dword; }
+  uint8_t operator[](int index) const { return address.bytes[index]; }
+  uint8_t& operator[](int index) { return address.bytes[index]; }
+  bool fromString(const char* text);
+  bool fromString(const String& text) { return fromString(text.c_str()); }
+  String toString() const;
+};
+
+#endif
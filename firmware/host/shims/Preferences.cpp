@@ -0,0 +1,105 @@
+#include "Preferences.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* NVS_ROOT = "nvs";
+static unsigned long writeCount = 0;
+
+Preferences::Preferences() {
+  directory[0] = '\0';
+  opened = false;
+  readOnly = true;
+}
+
+Preferences::~Preferences() {
+  end();
+}
+
+bool Preferences::begin(const char* name, bool readOnlyMode) {
+  end();
+  if (!name || !name[0] || strchr(name, '/')) {
+    return false;
+  }
+  snprintf(directory, sizeof(directory), "%s/%s", NVS_ROOT, name);
+  struct stat info;
+  if (stat(directory, &info) != 0) {
+    // Read-only opens of a missing namespace fail, as they do in NVS.
+    if (readOnlyMode) {
+      return false;
+    }
+    if ((stat(NVS_ROOT, &info) != 0 && mkdir(NVS_ROOT, 0755) != 0) || mkdir(directory, 0755) != 0) {
+      return false;
+    }
+  }
+  opened = true;
+  readOnly = readOnlyMode;
+  return true;
+}
+
+void Preferences::end() {
+  opened = false;
+}
+
+bool Preferences::keyPath(char* buffer, size_t size, const char* key) {
+  if (!opened || !key || !key[0] || strchr(key, '/')) {
+    return false;
+  }
+  int length = snprintf(buffer, size, "%s/%s", directory, key);
+  return length > 0 && (size_t)length < size;
+}
+
+bool Preferences::remove(const char* key) {
+  char path[96];
+  if (readOnly || !keyPath(path, sizeof(path), key)) {
+    return false;
+  }
+  writeCount++;
+  return unlink(path) == 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  char path[96];
+  struct stat info;
+  return keyPath(path, sizeof(path), key) && stat(path, &info) == 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  char path[96];
+  if (readOnly || !keyPath(path, sizeof(path), key)) {
+    return 0;
+  }
+  writeCount++;
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    return 0;
+  }
+  size_t written = fwrite(value, 1, length, file);
+  return fclose(file) == 0 && written == length ? length : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  char path[96];
+  struct stat info;
+  return keyPath(path, sizeof(path), key) && stat(path, &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+// Like NVS, a buffer smaller than the stored value reads nothing.
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  size_t length = getBytesLength(key);
+  char path[96];
+  if (length == 0 || length > maxLength || !keyPath(path, sizeof(path), key)) {
+    return 0;
+  }
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return 0;
+  }
+  size_t count = fread(buffer, 1, length, file);
+  fclose(file);
+  return count == length ? length : 0;
+}
+
+unsigned long Preferences::getWriteCount() {
+  return writeCount;
+}
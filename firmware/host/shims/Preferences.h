@@ -0,0 +1,33 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+
+// NVS stand-in. Each namespace is a directory under nvs/ in the working
+// directory and each key one file, so values survive between runs the way
+// they survive a reboot on the device.
+class Preferences {
+private:
+  char directory[48];
+  bool opened;
+  bool readOnly;
+
+  bool keyPath(char* buffer, size_t size, const char* key);
+
+public:
+  Preferences();
+  ~Preferences();
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t getBytes(const char* key, void* buffer, size_t maxLength);
+  size_t getBytesLength(const char* key);
+
+  // Host only: puts and removes so far, each of which costs a flash write
+  // on the device.
+  static unsigned long getWriteCount();
+};
+
+#endif
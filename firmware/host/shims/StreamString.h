@@ -0,0 +1,37 @@
+#ifndef HOST_STREAM_STRING_H
+#define HOST_STREAM_STRING_H
+
+#include "Arduino.h"
+
+// A String that can be written to and read back as a Stream.
+class StreamString : public Stream, public String {
+public:
+  size_t write(uint8_t value) override {
+    return concat((char)value) ? 1 : 0;
+  }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return concat((const char*)buffer, size) ? size : 0;
+  }
+
+  using Print::write;
+
+  int available() override {
+    return length();
+  }
+
+  int read() override {
+    if (length() == 0) {
+      return -1;
+    }
+    char value = charAt(0);
+    remove(0, 1);
+    return (uint8_t)value;
+  }
+
+  int peek() override {
+    return length() ? (uint8_t)charAt(0) : -1;
+  }
+};
+
+#endif
@@ -0,0 +1,375 @@
+#include "WiFi.h"
+#include "WiFiClientSecure.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+bool IPAddress::fromString(const char* text) {
+  struct in_addr parsed;
+  if (!text || inet_pton(AF_INET, text, &parsed) != 1) {
+    return false;
+  }
+  address.dword = parsed.s_addr;
+  return true;
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", address.bytes[0], address.bytes[1], address.bytes[2], address.bytes[3]);
+  return String(text);
+}
+
+static SocketTap socketTap = nullptr;
+static void* socketTapContext = nullptr;
+static std::atomic<uint32_t> nextConnection(1);
+
+// The ESP32 client reads through a buffer of one TCP segment, so byte-at-a-
+// time reads cost a copy rather than a socket call.
+static const size_t RX_BUFFER_SIZE = 1436;
+
+struct WiFiClient::Socket {
+  int fd;
+  uint32_t connection;
+  bool peerClosed;
+  uint8_t rxBuffer[RX_BUFFER_SIZE];
+  size_t rxHead;
+  size_t rxTail;
+
+  explicit Socket(int descriptor)
+      : fd(descriptor), connection(nextConnection++), peerClosed(false), rxHead(0), rxTail(0) {}
+
+  size_t buffered() const {
+    return rxTail - rxHead;
+  }
+
+  ~Socket() {
+    close();
+  }
+
+  void close() {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+};
+
+WiFiClient::WiFiClient() : noDelay(false) {
+}
+
+WiFiClient::WiFiClient(int fd) : socket(std::make_shared<Socket>(fd)), noDelay(false) {
+}
+
+WiFiClient::~WiFiClient() {
+}
+
+int WiFiClient::descriptor() const {
+  return socket ? socket->fd : -1;
+}
+
+void WiFiClient::setTap(SocketTap tap, void* context) {
+  socketTap = tap;
+  socketTapContext = context;
+}
+
+void WiFiClient::report(SocketTapEvent event, const uint8_t* data, size_t length) {
+  if (!socketTap || !socket) {
+    return;
+  }
+  if (event == SOCKET_CLOSED) {
+    if (socket->peerClosed) {
+      return;
+    }
+    socket->peerClosed = true;
+  }
+  socketTap(socketTapContext, socket->connection, event, data, length);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, (int32_t)(timeout));
+}
+
+// Non-blocking connect bounded by timeoutMs, then back to a blocking socket as
+// the ESP32 client leaves it.
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+  stop();
+  int fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  server.sin_addr.s_addr = (uint32_t)ip;
+
+  if (::connect(fd, (struct sockaddr*)&server, sizeof(server)) < 0) {
+    struct pollfd pending = { fd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (errno != EINPROGRESS || poll(&pending, 1, timeoutMs) <= 0 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+      ::close(fd);
+      return 0;
+    }
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+  socket = std::make_shared<Socket>(fd);
+  clearWriteError();
+  if (noDelay) {
+    setNoDelay(true);
+  }
+  return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, (int32_t)(timeout));
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) {
+    return 0;
+  }
+  return connect(ip, port, timeoutMs);
+}
+
+void WiFiClient::setTimeout(uint32_t seconds) {
+  Stream::setTimeout(seconds * 1000);
+  int fd = descriptor();
+  if (fd >= 0) {
+    struct timeval limit = { (time_t)seconds, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+  }
+}
+
+size_t WiFiClient::write(uint8_t value) {
+  return write(&value, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  int fd = descriptor();
+  if (fd < 0) {
+    setWriteError();
+    return 0;
+  }
+  size_t written = 0;
+  while (written < size) {
+    ssize_t count = ::send(fd, buffer + written, size - written, MSG_NOSIGNAL);
+    if (count > 0) {
+      written += count;
+    } else if (count < 0 && errno == EINTR) {
+      continue;
+    } else {
+      setWriteError();
+      break;
+    }
+  }
+  if (written > 0) {
+    report(SOCKET_SENT, buffer, written);
+  }
+  return written;
+}
+
+bool WiFiClient::fill() {
+  int fd = descriptor();
+  if (fd < 0) {
+    return false;
+  }
+  if (socket->buffered() > 0) {
+    return true;
+  }
+  ssize_t count = ::recv(fd, socket->rxBuffer, RX_BUFFER_SIZE, MSG_DONTWAIT);
+  if (count > 0) {
+    socket->rxHead = 0;
+    socket->rxTail = count;
+    report(SOCKET_RECEIVED, socket->rxBuffer, count);
+    return true;
+  }
+  if (count == 0) {
+    report(SOCKET_CLOSED, nullptr, 0);
+  }
+  return false;
+}
+
+// Only asks the kernel once the buffer is empty: the ESP32 asks lwIP, which
+// is a function call rather than a syscall.
+int WiFiClient::available() {
+  int fd = descriptor();
+  int count = 0;
+  if (fd >= 0 && socket->buffered() > 0) {
+    return (int)socket->buffered();
+  }
+  if (fd < 0 || ioctl(fd, FIONREAD, &count) < 0) {
+    return 0;
+  }
+  return count;
+}
+
+int WiFiClient::read() {
+  return fill() ? socket->rxBuffer[socket->rxHead++] : -1;
+}
+
+// Returns what is already buffered without waiting, or -1 if nothing is.
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  if (size == 0 || !fill()) {
+    return -1;
+  }
+  size_t count = socket->buffered() < size ? socket->buffered() : size;
+  memcpy(buffer, socket->rxBuffer + socket->rxHead, count);
+  socket->rxHead += count;
+  return (int)count;
+}
+
+int WiFiClient::peek() {
+  return fill() ? socket->rxBuffer[socket->rxHead] : -1;
+}
+
+// Waits up to the stream timeout for the rest, like Stream::readBytes.
+size_t WiFiClient::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  unsigned long start = millis();
+  while (count < length && descriptor() >= 0) {
+    int chunk = read((uint8_t*)buffer + count, length - count);
+    if (chunk > 0) {
+      count += chunk;
+      continue;
+    }
+    long remaining = (long)timeout - (long)(millis() - start);
+    struct pollfd pending = { descriptor(), POLLIN, 0 };
+    if (remaining <= 0 || poll(&pending, 1, remaining) <= 0 || !connected()) {
+      break;
+    }
+  }
+  return count;
+}
+
+void WiFiClient::flush() {
+}
+
+// Closes the socket for every copy sharing it.
+void WiFiClient::stop() {
+  if (socket) {
+    socket->close();
+    socket.reset();
+  }
+}
+
+uint8_t WiFiClient::connected() {
+  int fd = descriptor();
+  if (fd < 0) {
+    return 0;
+  }
+  if (socket->buffered() > 0) {
+    return 1;
+  }
+  uint8_t value;
+  ssize_t count = ::recv(fd, &value, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (count > 0 || (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
+    return 1;
+  }
+  if (count == 0) {
+    report(SOCKET_CLOSED, nullptr, 0);
+  }
+  stop();
+  return 0;
+}
+
+int WiFiClient::setNoDelay(bool enabled) {
+  noDelay = enabled;
+  int fd = descriptor();
+  int flag = enabled ? 1 : 0;
+  return fd >= 0 ? setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) : 0;
+}
+
+WiFiClass::WiFiClass() {
+  state = WL_IDLE_STATUS;
+  linkUp = true;
+  currentChannel = 0;
+  static const uint8_t HOST_BSSID[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  memcpy(bssid, HOST_BSSID, sizeof(bssid));
+}
+
+wl_status_t WiFiClass::status() {
+  if (state == WL_CONNECTED && !linkUp) {
+    state = WL_CONNECTION_LOST;
+  }
+  return state;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* requestedBssid, bool connect) {
+  currentChannel = channel > 0 ? channel : 1;
+  state = connect && linkUp ? WL_CONNECTED : WL_DISCONNECTED;
+  return state;
+}
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  staticIp = localIp;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  state = WL_DISCONNECTED;
+  return true;
+}
+
+bool WiFiClass::reconnect() {
+  state = linkUp ? WL_CONNECTED : WL_DISCONNECTED;
+  return linkUp;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  return true;
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+  if (result.fromString(host)) {
+    return 1;
+  }
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* found = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &found) != 0 || !found) {
+    return 0;
+  }
+  result = IPAddress((uint32_t)((struct sockaddr_in*)found->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(found);
+  return 1;
+}
+
+uint8_t* WiFiClass::BSSID() {
+  return state == WL_CONNECTED ? bssid : nullptr;
+}
+
+int32_t WiFiClass::channel() {
+  return currentChannel;
+}
+
+IPAddress WiFiClass::localIP() {
+  return (uint32_t)staticIp ? staticIp : IPAddress(127, 0, 0, 1);
+}
+
+int8_t WiFiClass::RSSI() {
+  return state == WL_CONNECTED ? -40 : 0;
+}
+
+void WiFiClass::setLinkUp(bool up) {
+  linkUp = up;
+}
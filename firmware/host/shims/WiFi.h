@@ -0,0 +1,60 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+// The host is always on a network, so the station associates as soon as
+// begin() is called. setLinkUp(false) takes the link down until it is raised
+// again, which is how reconnect handling can be exercised.
+class WiFiClass {
+private:
+  wl_status_t state;
+  bool linkUp;
+  int32_t currentChannel;
+  uint8_t bssid[6];
+  IPAddress staticIp;
+
+public:
+  WiFiClass();
+  wl_status_t status();
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+  bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  bool reconnect();
+  bool mode(wifi_mode_t mode);
+  bool setAutoReconnect(bool enabled) { return true; }
+  void persistent(bool enabled) {}
+  bool setSleep(bool enabled) { return true; }
+  int hostByName(const char* host, IPAddress& result);
+  uint8_t* BSSID();
+  int32_t channel();
+  IPAddress localIP();
+  int8_t RSSI();
+
+  // Host only.
+  void setLinkUp(bool up);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include <memory>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+enum SocketTapEvent {
+  SOCKET_SENT,
+  SOCKET_RECEIVED,
+  SOCKET_CLOSED
+};
+
+// Host only: sees every socket's traffic, keyed by a connection number that
+// is unique for the life of the process. SOCKET_CLOSED is reported when the
+// peer closes, not when the firmware does.
+typedef void (*SocketTap)(void* context, uint32_t connection, SocketTapEvent event, const uint8_t* data, size_t length);
+
+// TCP client over a POSIX socket. Copies share the socket and its receive
+// buffer, and the socket closes when the last copy lets go or stop() is
+// called. As on the ESP32 client, setTimeout() takes seconds.
+class WiFiClient : public Stream {
+private:
+  struct Socket;
+  std::shared_ptr<Socket> socket;
+  bool noDelay;
+
+  int descriptor() const;
+  bool fill();
+  void report(SocketTapEvent event, const uint8_t* data, size_t length);
+
+public:
+  WiFiClient();
+  explicit WiFiClient(int fd);
+  virtual ~WiFiClient();
+
+  virtual int connect(IPAddress ip, uint16_t port);
+  virtual int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+  virtual int connect(const char* host, uint16_t port);
+  virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+  void setTimeout(uint32_t seconds);
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size);
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  using Stream::readBytes;
+  void flush() override;
+  void stop();
+  uint8_t connected();
+  operator bool() { return connected(); }
+  int setNoDelay(bool enabled);
+  bool getNoDelay() const { return noDelay; }
+  int fd() const { return descriptor(); }
+  static void setTap(SocketTap socketTap, void* context);
+};
+
+#endif
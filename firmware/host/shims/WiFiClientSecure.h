@@ -0,0 +1,16 @@
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include "WiFiClient.h"
+
+// The forwarder only talks plain HTTP; this exists so the vendored HTTPClient
+// compiles. Connections made through it are not encrypted.
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setCACert(const char* rootCA) {}
+  void setCertificate(const char* clientCA) {}
+  void setPrivateKey(const char* privateKey) {}
+  void setInsecure() {}
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "base64.h"
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+String base64::encode(const uint8_t* data, size_t length) {
+  String encoded;
+  encoded.reserve(((length + 2) / 3) * 4);
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t block = (uint32_t)data[i] << 16;
+    if (i + 1 < length) {
+      block |= (uint32_t)data[i + 1] << 8;
+    }
+    if (i + 2 < length) {
+      block |= data[i + 2];
+    }
+    encoded += BASE64_ALPHABET[(block >> 18) & 0x3F];
+    encoded += BASE64_ALPHABET[(block >> 12) & 0x3F];
+    encoded += i + 1 < length ? BASE64_ALPHABET[(block >> 6) & 0x3F] : '=';
+    encoded += i + 2 < length ? BASE64_ALPHABET[block & 0x3F] : '=';
+  }
+  return encoded;
+}
+
+String base64::encode(const String& text) {
+  return encode((const uint8_t*)text.c_str(), text.length());
+}
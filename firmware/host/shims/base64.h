@@ -0,0 +1,12 @@
+#ifndef HOST_BASE64_H
+#define HOST_BASE64_H
+
+#include "Arduino.h"
+
+class base64 {
+public:
+  static String encode(const uint8_t* data, size_t length);
+  static String encode(const String& text);
+};
+
+#endif
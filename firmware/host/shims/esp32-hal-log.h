@@ -0,0 +1,11 @@
+#ifndef HOST_ESP32_HAL_LOG_H
+#define HOST_ESP32_HAL_LOG_H
+
+// Core debug logging is compiled out, as in a release firmware build.
+#define log_v(format, ...) do {} while (0)
+#define log_d(format, ...) do {} while (0)
+#define log_i(format, ...) do {} while (0)
+#define log_w(format, ...) do {} while (0)
+#define log_e(format, ...) do {} while (0)
+
+#endif
@@ -0,0 +1,121 @@
+#include "ArmRig.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+ArmRig::ArmRig() : slotCount(0), running(false) {
+}
+
+ArmRig::~ArmRig() {
+  stop();
+  for (int i = 0; i < slotCount; i++) {
+    delete slots[i].arm;
+  }
+}
+
+int ArmRig::add(int fd, const VirtualArmConfig& config) {
+  if (running || slotCount >= ARM_RIG_MAX_ARMS || fd < 0) {
+    return -1;
+  }
+  slots[slotCount].fd = fd;
+  slots[slotCount].arm = new VirtualArm(config);
+  return slotCount++;
+}
+
+bool ArmRig::start() {
+  if (running) {
+    return true;
+  }
+  running = true;
+  worker = std::thread(&ArmRig::run, this);
+  return true;
+}
+
+void ArmRig::stop() {
+  running = false;
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+// Sleeps in poll() until a byte arrives or the earliest reply is due, so an
+// idle rig costs nothing and replies go out within the poll granularity.
+void ArmRig::run() {
+  struct pollfd watched[ARM_RIG_MAX_ARMS];
+  uint8_t buffer[256];
+  while (running) {
+    uint64_t now = micros();
+    uint64_t next = now + 20000;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      for (int i = 0; i < slotCount; i++) {
+        watched[i] = { slots[i].fd, POLLIN, 0 };
+        uint64_t due = slots[i].arm->nextEventMicros();
+        next = due < next ? due : next;
+      }
+    }
+    int waitMs = next > now ? (int)((next - now + 999) / 1000) : 0;
+    poll(watched, slotCount, waitMs);
+
+    std::lock_guard<std::mutex> guard(lock);
+    now = micros();
+    for (int i = 0; i < slotCount; i++) {
+      Slot& slot = slots[i];
+      if (watched[i].revents & POLLIN) {
+        ssize_t count = read(slot.fd, buffer, sizeof(buffer));
+        if (count > 0) {
+          slot.arm->receive(buffer, count, now);
+        }
+      } else if (watched[i].revents & (POLLHUP | POLLERR)) {
+        // The other end went away; stop watching rather than spin on it.
+        slot.fd = -1;
+      }
+      slot.arm->update(now);
+      flush(slot);
+    }
+  }
+}
+
+void ArmRig::flush(Slot& slot) {
+  if (slot.fd < 0) {
+    return;
+  }
+  uint8_t buffer[256];
+  size_t count;
+  while ((count = slot.arm->takeOutput(buffer, sizeof(buffer))) > 0) {
+    for (size_t written = 0; written < count;) {
+      ssize_t result = write(slot.fd, buffer + written, count - written);
+      if (result > 0) {
+        written += result;
+      } else if (result < 0 && errno != EAGAIN && errno != EINTR) {
+        return;
+      }
+    }
+  }
+}
+
+VirtualArmStats ArmRig::getStats(int index) {
+  std::lock_guard<std::mutex> guard(lock);
+  return slots[index].arm->getStats();
+}
+
+void ArmRig::resetStats(int index) {
+  std::lock_guard<std::mutex> guard(lock);
+  slots[index].arm->resetStats();
+}
+
+bool ArmRig::isConnected(int index) {
+  std::lock_guard<std::mutex> guard(lock);
+  return slots[index].fd >= 0;
+}
+
+bool ArmRig::isIdle(int index) {
+  std::lock_guard<std::mutex> guard(lock);
+  return slots[index].arm->isIdle();
+}
+
+int32_t ArmRig::getPosition(int index, int axis) {
+  std::lock_guard<std::mutex> guard(lock);
+  return slots[index].arm->getPosition(axis);
+}
@@ -0,0 +1,42 @@
+#ifndef ARM_RIG_H
+#define ARM_RIG_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "VirtualArm.h"
+
+static const int ARM_RIG_MAX_ARMS = 2;
+
+// Runs virtual arms against real descriptors (a pty, a device, or the far end
+// of a HardwareSerial loopback) on one thread, timed by micros().
+class ArmRig {
+private:
+  struct Slot {
+    int fd;
+    VirtualArm* arm;
+  };
+
+  Slot slots[ARM_RIG_MAX_ARMS];
+  int slotCount;
+  std::thread worker;
+  std::atomic<bool> running;
+  std::mutex lock;
+
+  void run();
+  void flush(Slot& slot);
+
+public:
+  ArmRig();
+  ~ArmRig();
+  int add(int fd, const VirtualArmConfig& config);
+  bool start();
+  void stop();
+  VirtualArmStats getStats(int index);
+  void resetStats(int index);
+  bool isIdle(int index);
+  int32_t getPosition(int index, int axis);
+  bool isConnected(int index);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef FORWARDER_PROBE_H
+#define FORWARDER_PROBE_H
+
+#include "CommandForwarder.h"
+
+// Host only: reaches the forwarder's private steps so a test or benchmark can
+// feed it a poll body or run one side of the task split without the network
+// or the clock in the way.
+class ForwarderProbe {
+private:
+  CommandForwarder& forwarder;
+
+public:
+  explicit ForwarderProbe(CommandForwarder& target) : forwarder(target) {}
+  bool readPollJson(const char* body, size_t length) { return forwarder.readPollJson((const uint8_t*)body, length); }
+  bool readPollImage(const uint8_t* body, size_t length) { return forwarder.readPollImage(body, length); }
+  void receiveTelemetry() { forwarder.receiveTelemetry(); }
+  void dispatchStep() { forwarder.dispatchStep(); }
+  void drainLog(int maxEntries) { forwarder.drainLog(maxEntries); }
+  void reportEvent(int armIndex, TelemetryKind kind, int index, const char* text) {
+    forwarder.reportEvent(forwarder.arms[armIndex], kind, index, text);
+  }
+
+  // Chunks for the script a poll just staged on the arm.
+  bool readChunkJson(int armIndex, const char* body, size_t length) {
+    return forwarder.readChunkJson(armIndex, forwarder.stagedFeeds[armIndex], (const uint8_t*)body, length);
+  }
+  bool readChunkImage(int armIndex, const uint8_t* body, size_t length) {
+    return forwarder.readChunkImage(armIndex, forwarder.stagedFeeds[armIndex], body, length);
+  }
+  int stagedFetched(int armIndex) { return forwarder.stagedFeeds[armIndex].fetchedCount; }
+  bool releaseHeldPages() { return forwarder.releaseHeldPages(); }
+
+  // Marks the staged script consumed up to what was fetched, as if dispatch
+  // had run it, but leaves the pages queued.
+  void consumeStaged(int armIndex) {
+    ArmFeed& feed = forwarder.stagedFeeds[armIndex];
+    feed.consumedIndex = feed.fetchedCount;
+    feed.consumedText = feed.fetchedText;
+  }
+
+  // Drops the queued pages and marks the staged script consumed up to what
+  // was fetched, as if dispatch had run it, so the next chunk has room.
+  void discardPages(int armIndex) {
+    ScriptPage page;
+    while (forwarder.pageQueue.pop(page)) {
+    }
+    ControlMessage control;
+    while (forwarder.controlQueue.pop(control)) {
+    }
+    consumeStaged(armIndex);
+  }
+};
+
+#endif
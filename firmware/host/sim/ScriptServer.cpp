@@ -0,0 +1,327 @@
+#include "ScriptServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+
+static const char* ARM_IDS[SCRIPT_SERVER_ARMS] = { "arm1", "arm2" };
+
+static std::string queryValue(const std::string& target, const char* key) {
+  size_t query = target.find('?');
+  std::string pattern = std::string(key) + "=";
+  for (size_t at = query; at != std::string::npos && at < target.size(); at = target.find('&', at + 1)) {
+    if (target.compare(at + 1, pattern.size(), pattern) == 0) {
+      size_t begin = at + 1 + pattern.size();
+      size_t end = target.find('&', begin);
+      return target.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+    }
+  }
+  return "";
+}
+
+static void appendJsonString(std::string& out, const std::string& text) {
+  out += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+static void appendCommands(std::string& out, const std::vector<std::string>& commands, size_t offset, size_t count) {
+  out += '[';
+  for (size_t i = offset; i < commands.size() && i < offset + count; i++) {
+    if (i > offset) out += ',';
+    appendJsonString(out, commands[i]);
+  }
+  out += ']';
+}
+
+ScriptServer::ScriptServer()
+    : listenFd(-1), boundPort(0), running(false), shouldStart(true), keepTelemetry(false), chunkDelayMs(0), chunkDropRate(0) {
+  for (int i = 0; i < SCRIPT_SERVER_ARMS; i++) {
+    arms[i].pending = false;
+  }
+  memset(&stats, 0, sizeof(stats));
+}
+
+ScriptServer::~ScriptServer() {
+  stop();
+}
+
+bool ScriptServer::start(uint16_t port) {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t length = sizeof(address);
+  if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 4) < 0 ||
+      getsockname(listenFd, (struct sockaddr*)&address, &length) < 0) {
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  boundPort = ntohs(address.sin_port);
+  running = true;
+  worker = std::thread(&ScriptServer::serve, this);
+  return true;
+}
+
+void ScriptServer::stop() {
+  running = false;
+  if (worker.joinable()) {
+    worker.join();
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+    listenFd = -1;
+  }
+}
+
+void ScriptServer::publish(int armIndex, const std::string& scriptId, const std::vector<std::string>& commands) {
+  std::lock_guard<std::mutex> guard(lock);
+  arms[armIndex].scriptId = scriptId;
+  arms[armIndex].commands = commands;
+  arms[armIndex].pending = true;
+}
+
+// As after a server restart: chunks for the arm's script get a 409.
+void ScriptServer::withdraw(int armIndex) {
+  std::lock_guard<std::mutex> guard(lock);
+  arms[armIndex].scriptId.clear();
+  arms[armIndex].commands.clear();
+  arms[armIndex].pending = false;
+}
+
+void ScriptServer::setShouldStart(bool start) {
+  std::lock_guard<std::mutex> guard(lock);
+  shouldStart = start;
+}
+
+ScriptServerStats ScriptServer::getStats() {
+  std::lock_guard<std::mutex> guard(lock);
+  return stats;
+}
+
+void ScriptServer::setKeepTelemetry(bool keep) {
+  std::lock_guard<std::mutex> guard(lock);
+  keepTelemetry = keep;
+}
+
+std::vector<std::string> ScriptServer::takeTelemetry() {
+  std::lock_guard<std::mutex> guard(lock);
+  std::vector<std::string> batches;
+  batches.swap(telemetry);
+  return batches;
+}
+
+void ScriptServer::setChunkFaults(unsigned long delayMs, float dropRate, uint32_t seed) {
+  std::lock_guard<std::mutex> guard(lock);
+  chunkDelayMs = delayMs;
+  chunkDropRate = dropRate;
+  random.seed(seed);
+}
+
+void ScriptServer::serve() {
+  std::vector<Connection> connections;
+  while (running) {
+    std::vector<struct pollfd> watched;
+    watched.push_back({ listenFd, POLLIN, 0 });
+    for (const Connection& connection : connections) {
+      watched.push_back({ connection.fd, POLLIN, 0 });
+    }
+    if (poll(watched.data(), watched.size(), 50) <= 0) {
+      continue;
+    }
+
+    if (watched[0].revents & POLLIN) {
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0) {
+        connections.push_back({ fd, "" });
+      }
+    }
+    for (size_t i = 1; i < watched.size(); i++) {
+      Connection& connection = connections[i - 1];
+      if (!(watched[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+      char buffer[4096];
+      ssize_t count = recv(connection.fd, buffer, sizeof(buffer), 0);
+      if (count <= 0) {
+        close(connection.fd);
+        connection.fd = -1;
+        continue;
+      }
+      connection.request.append(buffer, count);
+      while (handle(connection)) {
+      }
+    }
+    for (size_t i = connections.size(); i-- > 0;) {
+      if (connections[i].fd < 0) {
+        connections.erase(connections.begin() + i);
+      }
+    }
+  }
+  for (const Connection& connection : connections) {
+    close(connection.fd);
+  }
+}
+
+// Answers one complete request from the connection's buffer, if there is one.
+bool ScriptServer::handle(Connection& connection) {
+  size_t headerEnd = connection.request.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) {
+    return false;
+  }
+  std::string head = connection.request.substr(0, headerEnd);
+  size_t bodyLength = 0;
+  size_t lengthField = head.find("Content-Length:");
+  if (lengthField == std::string::npos) {
+    lengthField = head.find("content-length:");
+  }
+  if (lengthField != std::string::npos) {
+    bodyLength = strtoul(head.c_str() + lengthField + 15, nullptr, 10);
+  }
+  if (connection.request.size() < headerEnd + 4 + bodyLength) {
+    return false;
+  }
+  std::string requestBody = connection.request.substr(headerEnd + 4, bodyLength);
+  connection.request.erase(0, headerEnd + 4 + bodyLength);
+
+  size_t methodEnd = head.find(' ');
+  size_t targetEnd = head.find(' ', methodEnd + 1);
+  int status = 400;
+  std::string body;
+  bool isChunk = false;
+  if (methodEnd != std::string::npos && targetEnd != std::string::npos) {
+    std::string target = head.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    isChunk = target.compare(0, 18, "/api/script/chunk?") == 0;
+    body = route(head.substr(0, methodEnd), target, requestBody, status);
+  }
+
+  unsigned long delayMs = 0;
+  bool drop = false;
+  if (isChunk) {
+    std::lock_guard<std::mutex> guard(lock);
+    delayMs = chunkDelayMs;
+    drop = chunkDropRate > 0 && std::uniform_real_distribution<float>(0, 1)(random) < chunkDropRate;
+    stats.delayed += delayMs > 0 ? 1 : 0;
+    stats.dropped += drop ? 1 : 0;
+  }
+  if (delayMs > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+  }
+  if (drop) {
+    close(connection.fd);
+    connection.fd = -1;
+    return false;
+  }
+
+  char header[160];
+  int headerLength = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: keep-alive\r\n\r\n",
+                              status, status == 200 ? "OK" : status == 409 ? "Conflict" : "Not Found", body.size());
+  std::string response(header, headerLength);
+  response += body;
+  for (size_t sent = 0; sent < response.size();) {
+    ssize_t count = send(connection.fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+    if (count <= 0) {
+      close(connection.fd);
+      connection.fd = -1;
+      return false;
+    }
+    sent += count;
+  }
+  return true;
+}
+
+std::string ScriptServer::route(const std::string& method, const std::string& target, const std::string& body, int& status) {
+  std::lock_guard<std::mutex> guard(lock);
+  status = 200;
+  std::string path = target.substr(0, target.find('?'));
+  if (method == "POST") {
+    stats.posts++;
+    if (keepTelemetry && path == "/api/telemetry/batch") {
+      telemetry.push_back(body);
+    }
+    return "{\"success\":true}";
+  }
+  if (path == "/api/script/poll") {
+    stats.polls++;
+    return pollBody(atoi(queryValue(target, "pageSize").c_str()));
+  }
+  if (path == "/api/script/chunk") {
+    stats.chunks++;
+    return chunkBody(queryValue(target, "armId"), queryValue(target, "scriptId"),
+                     atoi(queryValue(target, "offset").c_str()), atoi(queryValue(target, "limit").c_str()), status);
+  }
+  stats.notFound++;
+  status = 404;
+  return "{}";
+}
+
+std::string ScriptServer::pollBody(int pageSize) {
+  std::string body = "{\"shouldStart\":";
+  body += shouldStart ? "true" : "false";
+  for (int i = 0; i < SCRIPT_SERVER_ARMS; i++) {
+    ArmSlot& arm = arms[i];
+    body += ",\"";
+    body += ARM_IDS[i];
+    body += "\":{\"hasNewScript\":";
+    if (!arm.pending) {
+      body += "false}";
+      continue;
+    }
+    arm.pending = false;
+    body += "true,\"scriptId\":";
+    appendJsonString(body, arm.scriptId);
+    body += ",\"format\":\"msl\",\"totalCommands\":" + std::to_string(arm.commands.size()) + ",\"commands\":";
+    appendCommands(body, arm.commands, 0, pageSize > 0 ? pageSize : arm.commands.size());
+    body += '}';
+  }
+  body += '}';
+  return body;
+}
+
+std::string ScriptServer::chunkBody(const std::string& armId, const std::string& scriptId, int offset, int limit, int& status) {
+  const std::vector<std::string>* commands = nullptr;
+  for (int i = 0; i < SCRIPT_SERVER_ARMS; i++) {
+    if (armId == ARM_IDS[i] && !scriptId.empty() && scriptId == arms[i].scriptId) {
+      commands = &arms[i].commands;
+    }
+  }
+  if (!commands) {
+    status = 409;
+    return "{\"success\":false,\"error\":\"Script is no longer loaded\"}";
+  }
+
+  std::string body = "{\"scriptId\":";
+  appendJsonString(body, scriptId);
+  body += ",\"offset\":" + std::to_string(offset) + ",\"commands\":";
+  appendCommands(body, *commands, offset < 0 ? 0 : offset, limit > 0 ? limit : commands->size());
+  body += '}';
+  return body;
+}
@@ -0,0 +1,80 @@
+#ifndef SCRIPT_SERVER_H
+#define SCRIPT_SERVER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int SCRIPT_SERVER_ARMS = 2;
+
+struct ScriptServerStats {
+  unsigned long polls;
+  unsigned long chunks;
+  unsigned long posts;
+  unsigned long notFound;
+  unsigned long delayed;
+  unsigned long dropped;
+};
+
+// Just enough of the web server for the forwarder to run against: the poll
+// and chunk endpoints in JSON, and a 200 for every POST. A published script
+// is offered once on the next poll; later pages come from /api/script/chunk,
+// which answers 409 for a script it no longer has, as the real server does.
+// With setKeepTelemetry(true), telemetry batch bodies are kept until taken.
+// setChunkFaults() makes chunk answers slow or missing: each is held back by
+// the delay, and the given fraction is never answered at all (the connection
+// is closed instead). Requests are served one at a time, so a held chunk
+// holds up every endpoint behind it, as a stalled server would.
+class ScriptServer {
+private:
+  struct Connection {
+    int fd;
+    std::string request;
+  };
+
+  struct ArmSlot {
+    std::string scriptId;
+    std::vector<std::string> commands;
+    bool pending;
+  };
+
+  int listenFd;
+  uint16_t boundPort;
+  std::thread worker;
+  std::atomic<bool> running;
+  std::mutex lock;
+  ArmSlot arms[SCRIPT_SERVER_ARMS];
+  bool shouldStart;
+  ScriptServerStats stats;
+  bool keepTelemetry;
+  std::vector<std::string> telemetry;
+  unsigned long chunkDelayMs;
+  float chunkDropRate;
+  std::mt19937 random;
+
+  void serve();
+  bool handle(Connection& connection);
+  std::string route(const std::string& method, const std::string& target, const std::string& body, int& status);
+  std::string pollBody(int pageSize);
+  std::string chunkBody(const std::string& armId, const std::string& scriptId, int offset, int limit, int& status);
+
+public:
+  ScriptServer();
+  ~ScriptServer();
+  bool start(uint16_t port = 0);
+  void stop();
+  uint16_t port() const { return boundPort; }
+  void publish(int armIndex, const std::string& scriptId, const std::vector<std::string>& commands);
+  void withdraw(int armIndex);
+  void setShouldStart(bool start);
+  ScriptServerStats getStats();
+  void setKeepTelemetry(bool keep);
+  std::vector<std::string> takeTelemetry();
+  void setChunkFaults(unsigned long delayMs, float dropRate, uint32_t seed = 1);
+};
+
+#endif
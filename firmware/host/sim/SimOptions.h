@@ -0,0 +1,76 @@
+#ifndef SIM_OPTIONS_H
+#define SIM_OPTIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "VirtualArm.h"
+
+#define SIM_ARM_OPTIONS_USAGE \
+  "[--speed units/s] [--accel units/s^2] [--time-scale f]\n" \
+  "          [--jitter-ms n] [--error-rate p] [--drop-rate p] [--queue n]\n" \
+  "          [--credits] [--text-only] [--seed n]"
+
+// Parses one virtual arm option at argv[index]. Returns how many arguments it
+// used, or 0 if argv[index] is not an arm option.
+inline int parseArmOption(int argc, char** argv, int index, VirtualArmConfig& config) {
+  const char* option = argv[index];
+  if (strcmp(option, "--credits") == 0) {
+    config.advertiseCredits = true;
+    return 1;
+  }
+  if (strcmp(option, "--text-only") == 0) {
+    config.allowBinary = false;
+    return 1;
+  }
+  if (index + 1 >= argc) {
+    return 0;
+  }
+  const char* value = argv[index + 1];
+  if (strcmp(option, "--speed") == 0) {
+    config.speed = atof(value);
+  } else if (strcmp(option, "--accel") == 0) {
+    config.acceleration = atof(value);
+  } else if (strcmp(option, "--time-scale") == 0) {
+    config.timeScale = atof(value);
+  } else if (strcmp(option, "--jitter-ms") == 0) {
+    config.jitterMicros = (unsigned long)(atof(value) * 1000);
+  } else if (strcmp(option, "--error-rate") == 0) {
+    config.errorRate = atof(value);
+  } else if (strcmp(option, "--drop-rate") == 0) {
+    config.dropRate = atof(value);
+  } else if (strcmp(option, "--queue") == 0) {
+    config.queueDepth = atoi(value);
+  } else if (strcmp(option, "--seed") == 0) {
+    config.seed = strtoul(value, nullptr, 10);
+  } else {
+    return 0;
+  }
+  return 2;
+}
+
+// One web command per line, as the server sends them ("MOVE:X100",
+// "GROUP:X100:Y50", "SPEED:ALL:2000"); blank lines and # comments skipped.
+inline bool loadScript(const char* path, std::vector<std::string>& commands) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    char* begin = line;
+    while (*begin == ' ' || *begin == '\t') begin++;
+    char* end = begin + strlen(begin);
+    while (end > begin && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    *end = '\0';
+    if (*begin && *begin != '#') {
+      commands.push_back(begin);
+    }
+  }
+  fclose(file);
+  return !commands.empty();
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "TraceFile.h"
+
+#include <string.h>
+#include <algorithm>
+
+static const char TRACE_MAGIC[8] = { 'F', 'W', 'T', 'R', 'A', 'C', 'E', '1' };
+static const size_t TRACE_HEADER_SIZE = 17;
+
+static void putLittle(uint8_t* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint64_t getLittle(const uint8_t* in, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+TraceWriter::TraceWriter() : file(nullptr) {
+}
+
+TraceWriter::~TraceWriter() {
+  close();
+}
+
+bool TraceWriter::open(const char* path) {
+  close();
+  file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), file);
+  return true;
+}
+
+void TraceWriter::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+void TraceWriter::write(TraceKind kind, uint32_t channel, uint64_t micros, const void* data, size_t length) {
+  if (!file) {
+    return;
+  }
+  uint8_t header[TRACE_HEADER_SIZE];
+  header[0] = kind;
+  putLittle(header + 1, channel, 4);
+  putLittle(header + 5, micros, 8);
+  putLittle(header + 13, length, 4);
+  fwrite(header, 1, sizeof(header), file);
+  if (length > 0) {
+    fwrite(data, 1, length, file);
+  }
+}
+
+bool readTrace(const char* path, std::vector<TraceRecord>& records) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[sizeof(TRACE_MAGIC)];
+  bool valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+  uint8_t header[TRACE_HEADER_SIZE];
+  while (valid && fread(header, 1, sizeof(header), file) == sizeof(header)) {
+    TraceRecord record;
+    record.kind = (TraceKind)header[0];
+    record.channel = (uint32_t)getLittle(header + 1, 4);
+    record.micros = getLittle(header + 5, 8);
+    record.data.resize((size_t)getLittle(header + 13, 4));
+    // A recorder that was killed leaves a truncated last record; keep the rest.
+    if (!record.data.empty() && fread(&record.data[0], 1, record.data.size(), file) != record.data.size()) {
+      break;
+    }
+    records.push_back(std::move(record));
+  }
+  fclose(file);
+  std::stable_sort(records.begin(), records.end(),
+                   [](const TraceRecord& a, const TraceRecord& b) { return a.micros < b.micros; });
+  return valid;
+}
+
+std::string traceConfigValue(const std::vector<TraceRecord>& records, const char* key) {
+  std::string pattern = std::string(key) + "=";
+  for (const TraceRecord& record : records) {
+    if (record.kind != TRACE_CONFIG) {
+      continue;
+    }
+    for (size_t at = 0; at < record.data.size();) {
+      size_t end = record.data.find('\n', at);
+      if (end == std::string::npos) end = record.data.size();
+      if (record.data.compare(at, pattern.size(), pattern) == 0) {
+        return record.data.substr(at + pattern.size(), end - at - pattern.size());
+      }
+      at = end + 1;
+    }
+  }
+  return "";
+}
@@ -0,0 +1,46 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum TraceKind : uint8_t {
+  TRACE_CONFIG = 1,
+  TRACE_UART_TX,
+  TRACE_UART_RX,
+  TRACE_HTTP_SENT,
+  TRACE_HTTP_RECEIVED,
+  TRACE_HTTP_CLOSED
+};
+
+// channel is the arm index for UART records and the connection number for
+// HTTP ones. CONFIG holds the forwarder settings as "key=value" lines.
+struct TraceRecord {
+  TraceKind kind;
+  uint32_t channel;
+  uint64_t micros;
+  std::string data;
+};
+
+// A trace is "FWTRACE1" followed by records, each a little-endian header
+// (kind u8, channel u32, micros u64, length u32) and the payload. Records are
+// appended as they are flushed, so readers sort them by time.
+class TraceWriter {
+private:
+  FILE* file;
+
+public:
+  TraceWriter();
+  ~TraceWriter();
+  bool open(const char* path);
+  void close();
+  bool isOpen() const { return file != nullptr; }
+  void write(TraceKind kind, uint32_t channel, uint64_t micros, const void* data, size_t length);
+};
+
+bool readTrace(const char* path, std::vector<TraceRecord>& records);
+std::string traceConfigValue(const std::vector<TraceRecord>& records, const char* key);
+
+#endif
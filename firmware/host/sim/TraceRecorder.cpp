@@ -0,0 +1,71 @@
+#include "TraceRecorder.h"
+
+#include "HostClock.h"
+
+TraceRecorder::~TraceRecorder() {
+  stop();
+}
+
+bool TraceRecorder::start(const char* path, const std::string& config) {
+  if (!writer.open(path)) {
+    return false;
+  }
+  writer.write(TRACE_CONFIG, 0, HostClock::now(), config.data(), config.size());
+  Serial1.setTap(onSerial, this);
+  Serial2.setTap(onSerial, this);
+  WiFiClient::setTap(onSocket, this);
+  return true;
+}
+
+void TraceRecorder::stop() {
+  Serial1.setTap(nullptr, nullptr);
+  Serial2.setTap(nullptr, nullptr);
+  WiFiClient::setTap(nullptr, nullptr);
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto& entry : sockets) {
+    flushSocket(entry.first, entry.second);
+  }
+  sockets.clear();
+  writer.close();
+}
+
+void TraceRecorder::onSerial(void* context, int uartNumber, bool inbound, const uint8_t* data, size_t length) {
+  TraceRecorder* recorder = static_cast<TraceRecorder*>(context);
+  std::lock_guard<std::mutex> guard(recorder->lock);
+  recorder->writer.write(inbound ? TRACE_UART_RX : TRACE_UART_TX, uartNumber - 1, HostClock::now(), data, length);
+}
+
+void TraceRecorder::onSocket(void* context, uint32_t connection, SocketTapEvent event, const uint8_t* data, size_t length) {
+  TraceRecorder* recorder = static_cast<TraceRecorder*>(context);
+  uint64_t now = HostClock::now();
+  std::lock_guard<std::mutex> guard(recorder->lock);
+  // The forwarder holds one connection at a time, so a new one means it has
+  // let the others go.
+  if (recorder->sockets.find(connection) == recorder->sockets.end()) {
+    for (auto& entry : recorder->sockets) {
+      recorder->flushSocket(entry.first, entry.second);
+    }
+    recorder->sockets.clear();
+  }
+  Pending& pending = recorder->sockets[connection];
+  if (event == SOCKET_CLOSED) {
+    recorder->flushSocket(connection, pending);
+    recorder->writer.write(TRACE_HTTP_CLOSED, connection, now, nullptr, 0);
+    recorder->sockets.erase(connection);
+    return;
+  }
+  TraceKind kind = event == SOCKET_SENT ? TRACE_HTTP_SENT : TRACE_HTTP_RECEIVED;
+  if (pending.data.empty() || pending.kind != kind) {
+    recorder->flushSocket(connection, pending);
+    pending.kind = kind;
+    pending.micros = now;
+  }
+  pending.data.append((const char*)data, length);
+}
+
+void TraceRecorder::flushSocket(uint32_t connection, Pending& pending) {
+  if (!pending.data.empty()) {
+    writer.write(pending.kind, connection, pending.micros, pending.data.data(), pending.data.size());
+    pending.data.clear();
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <map>
+#include <mutex>
+#include "TraceFile.h"
+#include "WiFiClient.h"
+
+// Records what the forwarder reads and writes on Serial1/Serial2 and on its
+// HTTP sockets, through the shim taps. UART chunks are written as they
+// happen. Socket bytes are gathered per connection until the direction
+// changes, so one record holds a whole request or response, stamped with its
+// first byte.
+class TraceRecorder {
+private:
+  struct Pending {
+    TraceKind kind;
+    uint64_t micros;
+    std::string data;
+  };
+
+  TraceWriter writer;
+  std::mutex lock;
+  std::map<uint32_t, Pending> sockets;
+
+  static void onSerial(void* context, int uartNumber, bool inbound, const uint8_t* data, size_t length);
+  static void onSocket(void* context, uint32_t connection, SocketTapEvent event, const uint8_t* data, size_t length);
+  void flushSocket(uint32_t connection, Pending& pending);
+
+public:
+  ~TraceRecorder();
+  bool start(const char* path, const std::string& config);
+  void stop();
+};
+
+#endif
@@ -0,0 +1,358 @@
+#include "TraceReplay.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const int REQUEST_WAIT_MS = 50;
+static const int REQUEST_WAIT_LIMIT = 20;
+static const char NOT_FOUND_RESPONSE[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+static bool endsMessage(char c) {
+  // Text lines end in '\n', binary frames in the COBS delimiter.
+  return c == '\n' || c == '\0';
+}
+
+static std::string pathKey(const std::string& requestLine) {
+  size_t methodEnd = requestLine.find(' ');
+  size_t targetEnd = requestLine.find_first_of("? ", methodEnd + 1);
+  return requestLine.substr(0, targetEnd);
+}
+
+TraceReplay::TraceReplay() : startMicros(0), endMicros(0), listenFd(-1), boundPort(0) {
+  memset(&stats, 0, sizeof(stats));
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    ports[i].fd = -1;
+    ports[i].nextChunk = 0;
+    ports[i].lastRelease = 0;
+    stats.firstMismatch[i] = -1;
+  }
+}
+
+TraceReplay::~TraceReplay() {
+  for (Connection& connection : connections) {
+    if (connection.fd >= 0) close(connection.fd);
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+  }
+}
+
+bool TraceReplay::load(const std::vector<TraceRecord>& records) {
+  if (records.empty()) {
+    return false;
+  }
+  startMicros = records.front().micros;
+  endMicros = records.back().micros;
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    loadPort(i, records);
+  }
+  loadExchanges(records);
+  return true;
+}
+
+void TraceReplay::loadPort(int armIndex, const std::vector<TraceRecord>& records) {
+  Port& port = ports[armIndex];
+  uint64_t lastMessage = startMicros;
+  std::string partial;
+  for (const TraceRecord& record : records) {
+    if (record.channel != (uint32_t)armIndex) {
+      continue;
+    }
+    if (record.kind == TRACE_UART_TX) {
+      for (char c : record.data) {
+        partial += c;
+        if (endsMessage(c)) {
+          port.recordedMessages.push_back(partial);
+          partial.clear();
+          lastMessage = record.micros;
+        }
+      }
+    } else if (record.kind == TRACE_UART_RX) {
+      port.chunks.push_back({ (uint32_t)port.recordedMessages.size(), record.micros - lastMessage, record.data });
+    }
+  }
+}
+
+void TraceReplay::loadExchanges(const std::vector<TraceRecord>& records) {
+  std::map<uint32_t, size_t> current;
+  std::vector<uint64_t> sentMicros;
+  for (const TraceRecord& record : records) {
+    auto open = current.find(record.channel);
+    if (record.kind == TRACE_HTTP_SENT) {
+      if (open != current.end() && exchanges[open->second].response.empty()) {
+        continue;
+      }
+      Exchange exchange;
+      exchange.requestLine = record.data.substr(0, record.data.find("\r\n"));
+      exchange.latencyMicros = 0;
+      exchange.closeAfter = false;
+      exchange.used = false;
+      current[record.channel] = exchanges.size();
+      byRequestLine[exchange.requestLine].push_back(exchanges.size());
+      byPath[pathKey(exchange.requestLine)].push_back(exchanges.size());
+      exchanges.push_back(exchange);
+      sentMicros.push_back(record.micros);
+    } else if (record.kind == TRACE_HTTP_RECEIVED && open != current.end()) {
+      Exchange& exchange = exchanges[open->second];
+      if (exchange.response.empty()) {
+        exchange.latencyMicros = record.micros - sentMicros[open->second];
+      }
+      exchange.response += record.data;
+    } else if (record.kind == TRACE_HTTP_CLOSED && open != current.end()) {
+      exchanges[open->second].closeAfter = true;
+      current.erase(open);
+    }
+  }
+}
+
+bool TraceReplay::start() {
+  listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (listenFd < 0) {
+    return false;
+  }
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 4) < 0 ||
+      getsockname(listenFd, (struct sockaddr*)&address, &length) < 0) {
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  boundPort = ntohs(address.sin_port);
+  return true;
+}
+
+void TraceReplay::attachPort(int armIndex, int fd) {
+  ports[armIndex].fd = fd;
+}
+
+void TraceReplay::service(uint64_t nowMicros) {
+  collect(nowMicros);
+  deliver(nowMicros);
+}
+
+// The UART socket pairs hand bytes over inside the sending call, and so does
+// loopback TCP apart from what readRequests() waits for, so everything the
+// forwarder wrote before this point is readable now.
+void TraceReplay::collect(uint64_t nowMicros) {
+  acceptConnections();
+  for (Connection& connection : connections) {
+    readRequests(connection, nowMicros);
+  }
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    readPort(i, nowMicros);
+  }
+}
+
+void TraceReplay::deliver(uint64_t nowMicros) {
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    Port& port = ports[i];
+    for (uint64_t due = chunkDue(port); due <= nowMicros; due = chunkDue(port)) {
+      const std::string& data = port.chunks[port.nextChunk].data;
+      if (port.fd >= 0 && send(port.fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+        break;
+      }
+      port.lastRelease = due;
+      port.nextChunk++;
+      stats.uartDelivered[i]++;
+    }
+  }
+
+  for (Connection& connection : connections) {
+    while (connection.fd >= 0 && !connection.deliveries.empty() && connection.deliveries.front().dueMicros <= nowMicros) {
+      Delivery& delivery = connection.deliveries.front();
+      ssize_t sent = delivery.data.empty() ? 0 : send(connection.fd, delivery.data.data(), delivery.data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (sent < 0 && errno == EAGAIN) {
+        break;
+      }
+      if (sent > 0 && (size_t)sent < delivery.data.size()) {
+        delivery.data.erase(0, sent);
+        break;
+      }
+      if (sent < 0 || delivery.close) {
+        close(connection.fd);
+        connection.fd = -1;
+      }
+      connection.deliveries.pop_front();
+    }
+  }
+  for (size_t i = connections.size(); i-- > 0;) {
+    if (connections[i].fd < 0) {
+      connections.erase(connections.begin() + i);
+    }
+  }
+}
+
+uint64_t TraceReplay::nextEventMicros() const {
+  uint64_t next = UINT64_MAX;
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    uint64_t due = chunkDue(ports[i]);
+    next = due < next ? due : next;
+  }
+  for (const Connection& connection : connections) {
+    if (!connection.deliveries.empty() && connection.deliveries.front().dueMicros < next) {
+      next = connection.deliveries.front().dueMicros;
+    }
+  }
+  return next;
+}
+
+TraceReplayStats TraceReplay::getStats() const {
+  TraceReplayStats result = stats;
+  for (const Exchange& exchange : exchanges) {
+    if (!exchange.used) result.httpUnused++;
+  }
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    result.uartPending[i] = ports[i].chunks.size() - ports[i].nextChunk;
+  }
+  return result;
+}
+
+long TraceReplay::takeExchange(std::map<std::string, std::deque<size_t>>& index, const std::string& key) {
+  auto found = index.find(key);
+  if (found == index.end()) {
+    return -1;
+  }
+  std::deque<size_t>& queue = found->second;
+  while (!queue.empty() && exchanges[queue.front()].used) {
+    queue.pop_front();
+  }
+  if (queue.empty()) {
+    return -1;
+  }
+  size_t taken = queue.front();
+  queue.pop_front();
+  exchanges[taken].used = true;
+  return (long)taken;
+}
+
+void TraceReplay::acceptConnections() {
+  for (;;) {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+    if (fd < 0) {
+      return;
+    }
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    connections.push_back({ fd, "", {} });
+  }
+}
+
+// A request split across segments (headers, then the body) can sit behind
+// the kernel's delayed ACK for a few wall-clock milliseconds, which would be
+// seconds of virtual time. The rest is awaited here without advancing the
+// clock.
+void TraceReplay::readRequests(Connection& connection, uint64_t nowMicros) {
+  char buffer[4096];
+  for (int waits = 0;;) {
+    ssize_t count = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+      close(connection.fd);
+      connection.fd = -1;
+      return;
+    }
+    if (count > 0) {
+      connection.request.append(buffer, count);
+      continue;
+    }
+    while (answer(connection, nowMicros)) {
+    }
+    if (connection.request.empty() || waits++ >= REQUEST_WAIT_LIMIT) {
+      return;
+    }
+    struct pollfd pending = { connection.fd, POLLIN, 0 };
+    poll(&pending, 1, REQUEST_WAIT_MS);
+  }
+}
+
+// Takes one complete request off the connection's buffer, if there is one,
+// and schedules its recorded response.
+bool TraceReplay::answer(Connection& connection, uint64_t nowMicros) {
+  size_t headerEnd = connection.request.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) {
+    return false;
+  }
+  size_t bodyLength = 0;
+  size_t lengthField = connection.request.find("Content-Length:");
+  if (lengthField != std::string::npos && lengthField < headerEnd) {
+    bodyLength = strtoul(connection.request.c_str() + lengthField + 15, nullptr, 10);
+  }
+  if (connection.request.size() < headerEnd + 4 + bodyLength) {
+    return false;
+  }
+  std::string requestLine = connection.request.substr(0, connection.request.find("\r\n"));
+  connection.request.erase(0, headerEnd + 4 + bodyLength);
+
+  long taken = takeExchange(byRequestLine, requestLine);
+  if (taken < 0) {
+    taken = takeExchange(byPath, pathKey(requestLine));
+  }
+  if (taken < 0) {
+    stats.httpUnmatched++;
+    connection.deliveries.push_back({ nowMicros, NOT_FOUND_RESPONSE, false });
+    return true;
+  }
+  stats.httpServed++;
+  const Exchange& exchange = exchanges[taken];
+  // A request the server never answered is left for the forwarder to time out.
+  if (!exchange.response.empty() || exchange.closeAfter) {
+    connection.deliveries.push_back({ nowMicros + exchange.latencyMicros, exchange.response, exchange.closeAfter });
+  }
+  return true;
+}
+
+void TraceReplay::readPort(int armIndex, uint64_t nowMicros) {
+  Port& port = ports[armIndex];
+  if (port.fd < 0) {
+    return;
+  }
+  char buffer[512];
+  for (;;) {
+    ssize_t count = recv(port.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (count <= 0) {
+      return;
+    }
+    for (ssize_t i = 0; i < count; i++) {
+      port.partialMessage += buffer[i];
+      if (endsMessage(buffer[i])) {
+        endMessage(port, armIndex, nowMicros);
+      }
+    }
+  }
+}
+
+void TraceReplay::endMessage(Port& port, int armIndex, uint64_t nowMicros) {
+  size_t index = port.messageMicros.size();
+  port.messageMicros.push_back(nowMicros);
+  if (index >= port.recordedMessages.size() || port.recordedMessages[index] != port.partialMessage) {
+    stats.txMismatches[armIndex]++;
+    if (stats.firstMismatch[armIndex] < 0) {
+      stats.firstMismatch[armIndex] = (long)index;
+    }
+  }
+  stats.txMessages[armIndex]++;
+  port.partialMessage.clear();
+}
+
+uint64_t TraceReplay::chunkDue(const Port& port) const {
+  if (port.nextChunk >= port.chunks.size()) {
+    return UINT64_MAX;
+  }
+  const RxChunk& chunk = port.chunks[port.nextChunk];
+  if (chunk.anchor > port.messageMicros.size()) {
+    return UINT64_MAX;
+  }
+  uint64_t base = chunk.anchor > 0 ? port.messageMicros[chunk.anchor - 1] : startMicros;
+  uint64_t due = base + chunk.offsetMicros;
+  return due > port.lastRelease ? due : port.lastRelease;
+}
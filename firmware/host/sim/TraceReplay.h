@@ -0,0 +1,108 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "TraceFile.h"
+
+static const int TRACE_REPLAY_ARMS = 2;
+
+struct TraceReplayStats {
+  unsigned long httpServed;
+  unsigned long httpUnmatched;
+  unsigned long httpUnused;
+  unsigned long uartDelivered[TRACE_REPLAY_ARMS];
+  unsigned long uartPending[TRACE_REPLAY_ARMS];
+  unsigned long txMessages[TRACE_REPLAY_ARMS];
+  unsigned long txMismatches[TRACE_REPLAY_ARMS];
+  long firstMismatch[TRACE_REPLAY_ARMS];
+};
+
+// Plays a recorded trace back into a forwarder that runs on the virtual
+// clock, from the same thread that steps it.
+//
+// HTTP requests are answered from the recorded exchange with the same
+// request line (or, failing that, the same path), in recorded order, after
+// the recorded response latency. Arm replies are tied to the outbound UART
+// message that preceded them when recorded, and are released that long after
+// the forwarder sends the matching message now. A firmware change that sends
+// commands sooner or later therefore moves the replies with them, which is
+// what makes cycle times comparable between builds.
+class TraceReplay {
+private:
+  struct RxChunk {
+    uint32_t anchor;
+    uint64_t offsetMicros;
+    std::string data;
+  };
+
+  struct Port {
+    int fd;
+    std::vector<RxChunk> chunks;
+    size_t nextChunk;
+    uint64_t lastRelease;
+    std::vector<std::string> recordedMessages;
+    std::vector<uint64_t> messageMicros;
+    std::string partialMessage;
+  };
+
+  struct Exchange {
+    std::string requestLine;
+    uint64_t latencyMicros;
+    std::string response;
+    bool closeAfter;
+    bool used;
+  };
+
+  struct Delivery {
+    uint64_t dueMicros;
+    std::string data;
+    bool close;
+  };
+
+  struct Connection {
+    int fd;
+    std::string request;
+    std::deque<Delivery> deliveries;
+  };
+
+  uint64_t startMicros;
+  uint64_t endMicros;
+  Port ports[TRACE_REPLAY_ARMS];
+  std::vector<Exchange> exchanges;
+  std::map<std::string, std::deque<size_t>> byRequestLine;
+  std::map<std::string, std::deque<size_t>> byPath;
+  std::vector<Connection> connections;
+  int listenFd;
+  uint16_t boundPort;
+  TraceReplayStats stats;
+
+  void loadPort(int armIndex, const std::vector<TraceRecord>& records);
+  void loadExchanges(const std::vector<TraceRecord>& records);
+  long takeExchange(std::map<std::string, std::deque<size_t>>& index, const std::string& key);
+  void acceptConnections();
+  void readRequests(Connection& connection, uint64_t nowMicros);
+  bool answer(Connection& connection, uint64_t nowMicros);
+  void readPort(int armIndex, uint64_t nowMicros);
+  void endMessage(Port& port, int armIndex, uint64_t nowMicros);
+  uint64_t chunkDue(const Port& port) const;
+
+public:
+  TraceReplay();
+  ~TraceReplay();
+  bool load(const std::vector<TraceRecord>& records);
+  bool start();
+  void attachPort(int armIndex, int fd);
+  void collect(uint64_t nowMicros);
+  void deliver(uint64_t nowMicros);
+  void service(uint64_t nowMicros);
+  uint64_t nextEventMicros() const;
+  uint64_t getStartMicros() const { return startMicros; }
+  uint64_t getEndMicros() const { return endMicros; }
+  uint16_t port() const { return boundPort; }
+  TraceReplayStats getStats() const;
+};
+
+#endif
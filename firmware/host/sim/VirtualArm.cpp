@@ -0,0 +1,340 @@
+#include "VirtualArm.h"
+
+#include <math.h>
+
+VirtualArm::VirtualArm(const VirtualArmConfig& armConfig) : config(armConfig), random(armConfig.seed) {
+  if (config.queueDepth < 1) config.queueDepth = 1;
+  if (config.queueDepth > VIRTUAL_ARM_QUEUE_SIZE) config.queueDepth = VIRTUAL_ARM_QUEUE_SIZE;
+  for (int i = 0; i < COMMAND_MAX_AXES; i++) {
+    position[i] = 0;
+    axisSpeed[i] = config.speed;
+  }
+  binary = false;
+  rxLength = 0;
+  rxOverflow = false;
+  queueHead = 0;
+  queueCount = 0;
+  executing = false;
+  finishMicros = 0;
+  outputLength = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+
+void VirtualArm::receive(const uint8_t* data, size_t length, uint64_t nowMicros) {
+  update(nowMicros);
+  for (size_t i = 0; i < length; i++) {
+    uint8_t byte = data[i];
+    uint8_t terminator = binary ? 0x00 : '\n';
+    if (byte != terminator) {
+      if (rxLength < sizeof(rx) - 1) {
+        rx[rxLength++] = byte;
+      } else {
+        rxOverflow = true;
+      }
+      continue;
+    }
+    if (rxOverflow) {
+      stats.malformed++;
+    } else if (binary) {
+      consumeFrame(nowMicros);
+    } else {
+      consumeLine(nowMicros);
+    }
+    rxLength = 0;
+    rxOverflow = false;
+  }
+}
+
+void VirtualArm::consumeLine(uint64_t nowMicros) {
+  while (rxLength > 0 && (rx[rxLength - 1] == '\r' || rx[rxLength - 1] == ' ')) {
+    rxLength--;
+  }
+  if (rxLength == 0) {
+    return;
+  }
+  rx[rxLength] = '\0';
+  char* line = (char*)rx;
+
+  if (strcmp(line, "PROTO:BIN") == 0) {
+    if (config.allowBinary) {
+      appendOutput("PROTO:BIN:OK\n", 13);
+      binary = true;
+    } else {
+      appendOutput("ERROR:PROTO\n", 12);
+    }
+    return;
+  }
+
+  bool hasSequence = false;
+  uint16_t sequence = 0;
+  char* hash = strrchr(line, '#');
+  if (hash) {
+    *hash = '\0';
+    hasSequence = true;
+    sequence = (uint16_t)strtoul(hash + 1, nullptr, 10);
+  }
+
+  // Undo the forwarder's UART rewrite ("arm1:X:100" is "MOVE:X100" on the
+  // web side) so CommandCodec can decode it the same way the forwarder did.
+  size_t nameLength = strlen(config.name);
+  CommandRecord record;
+  const char* text = "";
+  char web[UART_COMMAND_SIZE + 8];
+  if (strncmp(line, config.name, nameLength) != 0 || line[nameLength] != ':') {
+    stats.malformed++;
+    memset(&record, 0, sizeof(record));
+  } else {
+    const char* body = line + nameLength + 1;
+    if (CommandCodec::axisIndex(body[0]) >= 0 && body[1] == ':') {
+      snprintf(web, sizeof(web), "MOVE:%c%s", body[0], body + 2);
+    } else {
+      snprintf(web, sizeof(web), "%s", body);
+    }
+    CommandCodec::decode(web, record, text);
+  }
+  enqueue(record, text, hasSequence, sequence, nowMicros);
+}
+
+void VirtualArm::consumeFrame(uint64_t nowMicros) {
+  uint8_t type;
+  uint16_t sequence;
+  uint8_t payload[FRAME_MAX_RAW];
+  size_t payloadLength = 0;
+  CommandRecord record;
+  const char* text;
+  if (!SerialFrame::decode(rx, rxLength, type, sequence, payload, payloadLength) || type != FRAME_COMMAND) {
+    stats.malformed++;
+    return;
+  }
+  if (!CommandCodec::fromBinary(payload, payloadLength, record, text)) {
+    stats.malformed++;
+    memset(&record, 0, sizeof(record));
+  }
+  enqueue(record, text, true, sequence, nowMicros);
+}
+
+void VirtualArm::enqueue(const CommandRecord& record, const char* text, bool hasSequence, uint16_t sequence, uint64_t nowMicros) {
+  stats.received++;
+  if (stats.firstCommandMicros == 0) {
+    stats.firstCommandMicros = nowMicros;
+  }
+  if (roll(config.dropRate)) {
+    stats.dropped++;
+    return;
+  }
+  if (queueCount >= config.queueDepth) {
+    stats.rejected++;
+    reply(FRAME_ERROR, hasSequence, sequence, "ERROR:QUEUE FULL");
+    return;
+  }
+
+  Pending& pending = queue[(queueHead + queueCount) % VIRTUAL_ARM_QUEUE_SIZE];
+  pending.record = record;
+  memcpy(pending.text, text, record.textLength);
+  pending.text[record.textLength] = '\0';
+  pending.supported = record.opcode != CMD_INVALID;
+  pending.hasSequence = hasSequence;
+  pending.sequence = sequence;
+  pending.receivedMicros = nowMicros;
+  queueCount++;
+  if (!executing) {
+    start(nowMicros);
+  }
+}
+
+void VirtualArm::start(uint64_t nowMicros) {
+  uint64_t duration = commandMicros(queue[queueHead]);
+  stats.busyMicros += duration;
+  if (config.jitterMicros > 0) {
+    duration += std::uniform_int_distribution<unsigned long>(0, config.jitterMicros)(random);
+  }
+  finishMicros = nowMicros + duration;
+  executing = true;
+}
+
+void VirtualArm::update(uint64_t nowMicros) {
+  while (executing && finishMicros <= nowMicros) {
+    uint64_t finishedAt = finishMicros;
+    finish(finishedAt);
+    if (queueCount > 0) {
+      const Pending& next = queue[queueHead];
+      start(next.receivedMicros > finishedAt ? next.receivedMicros : finishedAt);
+    }
+  }
+}
+
+void VirtualArm::finish(uint64_t nowMicros) {
+  Pending head = queue[queueHead];
+  queueHead = (queueHead + 1) % VIRTUAL_ARM_QUEUE_SIZE;
+  queueCount--;
+  executing = false;
+  stats.lastReplyMicros = nowMicros;
+
+  const CommandRecord& record = head.record;
+  bool supported = head.supported;
+  if (!supported || roll(config.errorRate)) {
+    // A real arm master drops whatever it had queued after a fault; the
+    // forwarder resends from the failed command.
+    stats.errors++;
+    queueCount = 0;
+    reply(FRAME_ERROR, head.hasSequence, head.sequence, supported ? "ERROR:FAULT" : "ERROR:UNKNOWN COMMAND");
+    return;
+  }
+
+  stats.completed++;
+  bool moved = record.opcode == CMD_MOVE || record.opcode == CMD_GROUP || record.opcode == CMD_HOME || record.opcode == CMD_WAIT;
+  reply(moved ? FRAME_DONE : FRAME_OK, head.hasSequence, head.sequence, moved ? "DONE" : "OK");
+}
+
+// Also applies the command's effect on positions and speeds, so it must be
+// called once per command, in execution order.
+uint64_t VirtualArm::commandMicros(Pending& pending) {
+  const CommandRecord& record = pending.record;
+  float seconds = 0;
+  switch (record.opcode) {
+    case CMD_MOVE:
+    case CMD_GROUP: {
+      if (record.flags & CMD_FLAG_TEXT) {
+        pending.supported = textMoveSeconds(pending, seconds);
+        break;
+      }
+      int operand = 0;
+      for (int g = 0; g < record.axisCount; g++) {
+        int axis = record.axisGroups[g] >> 4;
+        int count = record.axisGroups[g] & 0x0F;
+        float axisSeconds = 0;
+        for (int i = 0; i < count; i++) {
+          axisSeconds += moveSeconds(axis, record.operands[operand]);
+          position[axis] = record.operands[operand++];
+        }
+        seconds = axisSeconds > seconds ? axisSeconds : seconds;
+      }
+      break;
+    }
+    case CMD_HOME:
+      for (int axis = 0; axis < COMMAND_MAX_AXES; axis++) {
+        float axisSeconds = moveSeconds(axis, 0);
+        position[axis] = 0;
+        seconds = axisSeconds > seconds ? axisSeconds : seconds;
+      }
+      break;
+    case CMD_ZERO:
+      memset(position, 0, sizeof(position));
+      break;
+    case CMD_SPEED:
+      if (record.flags & CMD_FLAG_TEXT || record.operands[0] <= 0) break;
+      for (int axis = 0; axis < COMMAND_MAX_AXES; axis++) {
+        if (record.axisCount == 0 || axis == record.axisGroups[0] >> 4) {
+          axisSpeed[axis] = record.operands[0];
+        }
+      }
+      break;
+    case CMD_WAIT:
+      seconds = atoi(pending.text) / 1000.0f;
+      break;
+    default:
+      break;
+  }
+  return (uint64_t)(seconds * config.timeScale * 1e6f);
+}
+
+// Moves the codec kept as text, e.g. more positions than it packs or
+// fractional ones: "100,200.5,300" for MOVE, "X100,200:Y50" for GROUP.
+bool VirtualArm::textMoveSeconds(const Pending& pending, float& seconds) {
+  const char* cursor = pending.text;
+  bool group = pending.record.opcode == CMD_GROUP;
+  int axis = pending.record.axisGroups[0] >> 4;
+  while (*cursor) {
+    if (group) {
+      axis = CommandCodec::axisIndex(*cursor++);
+      if (axis < 0) return false;
+    }
+    float axisSeconds = 0;
+    while (true) {
+      char* end;
+      float target = strtof(cursor, &end);
+      if (end == cursor) return false;
+      axisSeconds += moveSeconds(axis, (int32_t)target);
+      position[axis] = (int32_t)target;
+      cursor = end;
+      if (*cursor != ',') break;
+      cursor++;
+    }
+    seconds = axisSeconds > seconds ? axisSeconds : seconds;
+    if (*cursor == '\0') break;
+    if (*cursor != ':' || !group) return false;
+    cursor++;
+  }
+  return true;
+}
+
+// Trapezoidal profile: accelerate to the axis speed, cruise, decelerate. Short
+// moves never reach full speed and become a triangle.
+float VirtualArm::moveSeconds(int axis, int32_t target) {
+  float distance = fabsf((float)target - (float)position[axis]);
+  float speed = axisSpeed[axis];
+  float acceleration = config.acceleration;
+  if (distance == 0 || speed <= 0 || acceleration <= 0) {
+    return 0;
+  }
+  if (distance >= speed * speed / acceleration) {
+    return distance / speed + speed / acceleration;
+  }
+  return 2 * sqrtf(distance / acceleration);
+}
+
+void VirtualArm::reply(uint8_t type, bool hasSequence, uint16_t sequence, const char* text) {
+  int credits = config.queueDepth - queueCount;
+  if (binary) {
+    uint8_t frame[FRAME_MAX_ENCODED];
+    uint8_t payload = (uint8_t)credits;
+    size_t size = type == FRAME_ERROR
+                    ? SerialFrame::encode(type, sequence, (const uint8_t*)text, strlen(text), frame, sizeof(frame))
+                    : SerialFrame::encode(type, sequence, &payload, config.advertiseCredits ? 1 : 0, frame, sizeof(frame));
+    appendOutput(frame, size);
+    return;
+  }
+
+  char line[48];
+  int length;
+  if (hasSequence && config.advertiseCredits) {
+    length = snprintf(line, sizeof(line), "%s#%u/%d\n", text, sequence, credits);
+  } else if (hasSequence) {
+    length = snprintf(line, sizeof(line), "%s#%u\n", text, sequence);
+  } else {
+    length = snprintf(line, sizeof(line), "%s\n", text);
+  }
+  appendOutput(line, length);
+}
+
+void VirtualArm::appendOutput(const void* data, size_t length) {
+  if (outputLength + length > sizeof(output)) {
+    return;
+  }
+  memcpy(output + outputLength, data, length);
+  outputLength += length;
+}
+
+size_t VirtualArm::takeOutput(uint8_t* buffer, size_t size) {
+  size_t count = outputLength < size ? outputLength : size;
+  memcpy(buffer, output, count);
+  memmove(output, output + count, outputLength - count);
+  outputLength -= count;
+  return count;
+}
+
+uint64_t VirtualArm::nextEventMicros() const {
+  return executing ? finishMicros : UINT64_MAX;
+}
+
+bool VirtualArm::isIdle() const {
+  return !executing && queueCount == 0;
+}
+
+void VirtualArm::resetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool VirtualArm::roll(float probability) {
+  return probability > 0 && std::uniform_real_distribution<float>(0, 1)(random) < probability;
+}
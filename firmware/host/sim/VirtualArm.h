@@ -0,0 +1,99 @@
+#ifndef VIRTUAL_ARM_H
+#define VIRTUAL_ARM_H
+
+#include <stdint.h>
+#include <random>
+#include "CommandCodec.h"
+#include "SerialFrame.h"
+
+static const int VIRTUAL_ARM_QUEUE_SIZE = 32;
+static const int VIRTUAL_ARM_OUTPUT_SIZE = 1024;
+
+struct VirtualArmConfig {
+  const char* name;
+  float speed;
+  float acceleration;
+  float timeScale;
+  unsigned long jitterMicros;
+  float errorRate;
+  float dropRate;
+  int queueDepth;
+  bool advertiseCredits;
+  bool allowBinary;
+  uint32_t seed;
+
+  VirtualArmConfig()
+      : name("arm1"), speed(2000), acceleration(8000), timeScale(1), jitterMicros(0), errorRate(0), dropRate(0),
+        queueDepth(4), advertiseCredits(false), allowBinary(true), seed(1) {}
+};
+
+struct VirtualArmStats {
+  unsigned long received;
+  unsigned long completed;
+  unsigned long errors;
+  unsigned long dropped;
+  unsigned long rejected;
+  unsigned long malformed;
+  uint64_t busyMicros;
+  uint64_t firstCommandMicros;
+  uint64_t lastReplyMicros;
+};
+
+// Stand-in for an arm master on the other end of a UART. Lines such as
+// "arm1:X:100,200" or "arm1:GROUP:X100:Y50#7" are queued and executed one at
+// a time; each move takes the trapezoidal-profile time at the current SPEED
+// for the longest axis, and is acknowledged when it finishes. Time is passed
+// in, so the same model runs against the wall clock or a simulated one.
+class VirtualArm {
+private:
+  struct Pending {
+    CommandRecord record;
+    char text[COMMAND_TEXT_MAX + 1];
+    bool supported;
+    bool hasSequence;
+    uint16_t sequence;
+    uint64_t receivedMicros;
+  };
+
+  VirtualArmConfig config;
+  std::mt19937 random;
+  int32_t position[COMMAND_MAX_AXES];
+  float axisSpeed[COMMAND_MAX_AXES];
+  bool binary;
+  uint8_t rx[FRAME_MAX_ENCODED > UART_COMMAND_SIZE ? FRAME_MAX_ENCODED : UART_COMMAND_SIZE];
+  size_t rxLength;
+  bool rxOverflow;
+  Pending queue[VIRTUAL_ARM_QUEUE_SIZE];
+  int queueHead;
+  int queueCount;
+  bool executing;
+  uint64_t finishMicros;
+  uint8_t output[VIRTUAL_ARM_OUTPUT_SIZE];
+  size_t outputLength;
+  VirtualArmStats stats;
+
+  void consumeLine(uint64_t nowMicros);
+  void consumeFrame(uint64_t nowMicros);
+  void enqueue(const CommandRecord& record, const char* text, bool hasSequence, uint16_t sequence, uint64_t nowMicros);
+  void start(uint64_t nowMicros);
+  void finish(uint64_t nowMicros);
+  uint64_t commandMicros(Pending& pending);
+  bool textMoveSeconds(const Pending& pending, float& seconds);
+  float moveSeconds(int axis, int32_t target);
+  void reply(uint8_t type, bool hasSequence, uint16_t sequence, const char* text);
+  void appendOutput(const void* data, size_t length);
+  bool roll(float probability);
+
+public:
+  explicit VirtualArm(const VirtualArmConfig& armConfig);
+  void receive(const uint8_t* data, size_t length, uint64_t nowMicros);
+  void update(uint64_t nowMicros);
+  uint64_t nextEventMicros() const;
+  size_t takeOutput(uint8_t* buffer, size_t size);
+  bool isIdle() const;
+  void resetStats();
+  const VirtualArmStats& getStats() const { return stats; }
+  int32_t getPosition(int axis) const { return position[axis]; }
+};
+
+#endif
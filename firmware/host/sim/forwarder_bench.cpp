@@ -0,0 +1,303 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandForwarder.h"
+#include "ScriptServer.h"
+#include "SimOptions.h"
+#include "TraceRecorder.h"
+
+// Runs the real forwarder in-process against ScriptServer and two virtual
+// arms on HardwareSerial loopbacks, and reports throughput, arm idle ratio
+// and cycle time for a script. The forwarder's own log goes to stderr, the
+// report to stdout. --chunk-delay-ms and --chunk-drop-rate make the server
+// slow to answer, or not answer, refill requests. --record writes the run as
+// a trace for forwarder_replay.
+
+struct ArmTotals {
+  unsigned long completed;
+  unsigned long errors;
+  unsigned long dropped;
+  unsigned long rejected;
+  uint64_t busyMicros;
+  uint64_t activeMicros;
+};
+
+struct CycleResult {
+  uint64_t cycleMicros;
+  uint64_t publishToDoneMicros;
+};
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s --script file [--arm2-script file] [--cycles n]\n"
+          "          [--pipeline depth] [--binary] [--timeout s] [--json]\n"
+          "          [--chunk-delay-ms n] [--chunk-drop-rate p] [--record trace]\n"
+          "          %s\n",
+          program, SIM_ARM_OPTIONS_USAGE);
+}
+
+static void printSummary(const char* label, const LatencySummary& summary, bool json, bool last) {
+  if (json) {
+    printf("\"%s\":{\"count\":%lu,\"p50Us\":%lu,\"p99Us\":%lu,\"maxUs\":%lu}%s", label, summary.count, summary.p50,
+           summary.p99, summary.max, last ? "" : ",");
+  } else {
+    printf("    %-9s %lu samples, p50 %luus, p99 %luus, max %luus\n", label, summary.count, summary.p50, summary.p99,
+           summary.max);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* scriptPaths[ARM_RIG_MAX_ARMS] = { nullptr, nullptr };
+  int cycles = 1;
+  int pipelineDepth = 1;
+  bool binaryProtocol = false;
+  bool json = false;
+  long timeoutSeconds = 60;
+  unsigned long chunkDelayMs = 0;
+  float chunkDropRate = 0;
+  const char* tracePath = nullptr;
+  VirtualArmConfig armConfig;
+
+  for (int i = 1; i < argc; i++) {
+    int consumed = parseArmOption(argc, argv, i, armConfig);
+    if (consumed > 0) {
+      i += consumed - 1;
+      continue;
+    }
+    const char* option = argv[i];
+    if (strcmp(option, "--binary") == 0) {
+      binaryProtocol = true;
+      continue;
+    }
+    if (strcmp(option, "--json") == 0) {
+      json = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(option, "--script") == 0) {
+      scriptPaths[0] = value;
+    } else if (strcmp(option, "--arm2-script") == 0) {
+      scriptPaths[1] = value;
+    } else if (strcmp(option, "--cycles") == 0) {
+      cycles = atoi(value);
+    } else if (strcmp(option, "--pipeline") == 0) {
+      pipelineDepth = atoi(value);
+    } else if (strcmp(option, "--timeout") == 0) {
+      timeoutSeconds = atol(value);
+    } else if (strcmp(option, "--chunk-delay-ms") == 0) {
+      chunkDelayMs = strtoul(value, nullptr, 10);
+    } else if (strcmp(option, "--chunk-drop-rate") == 0) {
+      chunkDropRate = atof(value);
+    } else if (strcmp(option, "--record") == 0) {
+      tracePath = value;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!scriptPaths[0] || cycles < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<std::string> scripts[ARM_RIG_MAX_ARMS];
+  for (int i = 0; i < ARM_RIG_MAX_ARMS; i++) {
+    if (scriptPaths[i] && !loadScript(scriptPaths[i], scripts[i])) {
+      fprintf(stderr, "cannot read script %s\n", scriptPaths[i]);
+      return 1;
+    }
+  }
+
+  // Resolved before the working directory moves.
+  std::string traceFile = tracePath ? std::filesystem::absolute(tracePath).string() : "";
+
+  int logFd = open("/dev/stderr", O_WRONLY);
+  Serial.attach(logFd >= 0 ? logFd : open("/dev/null", O_WRONLY), true);
+
+  // The script cache and NVS stand-in would otherwise land in the caller's
+  // directory.
+  char dataDir[] = "/tmp/forwarder-bench-XXXXXX";
+  if (!mkdtemp(dataDir) || chdir(dataDir) != 0) {
+    fprintf(stderr, "cannot create a working directory\n");
+    return 1;
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+  server.setChunkFaults(chunkDelayMs, chunkDropRate, armConfig.seed);
+
+  ArmRig rig;
+  HardwareSerial* ports[ARM_RIG_MAX_ARMS] = { &Serial1, &Serial2 };
+  const char* names[ARM_RIG_MAX_ARMS] = { "arm1", "arm2" };
+  for (int i = 0; i < ARM_RIG_MAX_ARMS; i++) {
+    VirtualArmConfig config = armConfig;
+    config.name = names[i];
+    config.seed = armConfig.seed + i;
+    rig.add(ports[i]->openLoopback(), config);
+  }
+  rig.start();
+
+  static CommandForwarder forwarder;
+  if (!forwarder.setPipelineDepth(pipelineDepth)) {
+    fprintf(stderr, "invalid pipeline depth %d\n", pipelineDepth);
+    return 2;
+  }
+  forwarder.setBinaryProtocol(binaryProtocol);
+
+  // As in forwarder_host: before initialize(), so the handshake is recorded.
+  static TraceRecorder recorder;
+  if (tracePath) {
+    std::string config = "pipeline=" + std::to_string(forwarder.getPipelineDepth()) +
+                         "\nbinary=" + (binaryProtocol ? "1" : "0") + "\nencoding=json\n";
+    if (!recorder.start(traceFile.c_str(), config)) {
+      fprintf(stderr, "cannot write %s\n", traceFile.c_str());
+      return 1;
+    }
+  }
+  forwarder.initialize("bench", "", "127.0.0.1", server.port());
+  if (!forwarder.startTasks()) {
+    fprintf(stderr, "cannot start forwarder tasks\n");
+    return 1;
+  }
+
+  std::vector<CycleResult> results;
+  ArmTotals totals[ARM_RIG_MAX_ARMS];
+  memset(totals, 0, sizeof(totals));
+  bool timedOut = false;
+
+  for (int cycle = 1; cycle <= cycles && !timedOut; cycle++) {
+    std::string scriptId = "bench-" + std::to_string(cycle);
+    for (int i = 0; i < ARM_RIG_MAX_ARMS; i++) {
+      if (!scripts[i].empty()) {
+        rig.resetStats(i);
+        server.publish(i, scriptId, scripts[i]);
+      }
+    }
+    uint64_t published = micros();
+
+    // A cycle is over once every scripted arm has taken at least one command
+    // of the new script, gone idle, and the forwarder counts it complete.
+    bool done = false;
+    unsigned long lastCheck = 0;
+    while (!done) {
+      forwarder.update();
+      if (millis() == lastCheck) {
+        continue;
+      }
+      lastCheck = millis();
+      if (micros() - published > (uint64_t)timeoutSeconds * 1000000) {
+        timedOut = true;
+        break;
+      }
+      done = true;
+      for (int i = 0; i < ARM_RIG_MAX_ARMS && done; i++) {
+        if (!scripts[i].empty()) {
+          done = rig.getStats(i).received > 0 && rig.isIdle(i) && forwarder.getArmProgress(i) == 100;
+        }
+      }
+    }
+    if (timedOut) {
+      fprintf(stderr, "cycle %d timed out after %lds\n", cycle, timeoutSeconds);
+      break;
+    }
+
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (int i = 0; i < ARM_RIG_MAX_ARMS; i++) {
+      if (scripts[i].empty()) continue;
+      VirtualArmStats stats = rig.getStats(i);
+      first = stats.firstCommandMicros < first ? stats.firstCommandMicros : first;
+      last = stats.lastReplyMicros > last ? stats.lastReplyMicros : last;
+      totals[i].completed += stats.completed;
+      totals[i].errors += stats.errors;
+      totals[i].dropped += stats.dropped;
+      totals[i].rejected += stats.rejected;
+      totals[i].busyMicros += stats.busyMicros;
+      totals[i].activeMicros += stats.lastReplyMicros - stats.firstCommandMicros;
+    }
+    results.push_back({ last - first, last - published });
+    fprintf(stderr, "cycle %d: %.1fms\n", cycle, (last - first) / 1000.0);
+  }
+
+  forwarder.stopTasks();
+  recorder.stop();
+  rig.stop();
+  server.stop();
+  ScriptServerStats serverStats = server.getStats();
+  std::error_code ignored;
+  std::filesystem::remove_all(dataDir, ignored);
+
+  size_t scriptCommands = scripts[0].size() + scripts[1].size();
+  uint64_t activeMicros = 0;
+  uint64_t minCycle = UINT64_MAX;
+  uint64_t maxCycle = 0;
+  uint64_t publishToDone = 0;
+  for (const CycleResult& result : results) {
+    activeMicros += result.cycleMicros;
+    publishToDone += result.publishToDoneMicros;
+    minCycle = result.cycleMicros < minCycle ? result.cycleMicros : minCycle;
+    maxCycle = result.cycleMicros > maxCycle ? result.cycleMicros : maxCycle;
+  }
+  size_t completedCycles = results.size();
+  double commandsPerSecond = activeMicros > 0 ? scriptCommands * completedCycles * 1e6 / activeMicros : 0;
+  double averageCycleMs = completedCycles ? activeMicros / 1000.0 / completedCycles : 0;
+  double averagePublishMs = completedCycles ? publishToDone / 1000.0 / completedCycles : 0;
+  if (!completedCycles) minCycle = 0;
+
+  if (json) {
+    printf("{\"cycles\":%zu,\"timedOut\":%s,\"pipeline\":%d,\"binary\":%s,\"commandsPerCycle\":%zu,"
+           "\"commandsPerSecond\":%.2f,\"cycleMs\":{\"avg\":%.3f,\"min\":%.3f,\"max\":%.3f},\"publishToDoneMs\":%.3f,"
+           "\"chunks\":{\"served\":%lu,\"delayMs\":%lu,\"dropped\":%lu},\"arms\":{",
+           completedCycles, timedOut ? "true" : "false", pipelineDepth, binaryProtocol ? "true" : "false", scriptCommands,
+           commandsPerSecond, averageCycleMs, minCycle / 1000.0, maxCycle / 1000.0, averagePublishMs, serverStats.chunks,
+           chunkDelayMs, serverStats.dropped);
+  } else {
+    printf("Cycles: %zu%s, %zu commands each, pipeline %d, %s protocol\n", completedCycles, timedOut ? " (timed out)" : "",
+           scriptCommands, pipelineDepth, binaryProtocol ? "binary" : "text");
+    printf("Throughput: %.1f commands/s\n", commandsPerSecond);
+    printf("Cycle time: avg %.1fms, min %.1fms, max %.1fms\n", averageCycleMs, minCycle / 1000.0, maxCycle / 1000.0);
+    printf("Publish to done: avg %.1fms (includes the poll interval)\n", averagePublishMs);
+    printf("Chunks: %lu served, %lums delay, %lu dropped\n", serverStats.chunks, chunkDelayMs, serverStats.dropped);
+  }
+
+  bool firstArm = true;
+  for (int i = 0; i < ARM_RIG_MAX_ARMS; i++) {
+    if (scripts[i].empty()) continue;
+    const ArmTotals& arm = totals[i];
+    double idleRatio = arm.activeMicros > 0 ? 1.0 - (double)arm.busyMicros / arm.activeMicros : 0;
+    LatencySummary dispatch = forwarder.getArmLatency(i, LATENCY_DISPATCH);
+    LatencySummary ack = forwarder.getArmLatency(i, LATENCY_ACK);
+    if (json) {
+      printf("%s\"%s\":{\"completed\":%lu,\"errors\":%lu,\"dropped\":%lu,\"rejected\":%lu,\"busyMs\":%.3f,\"activeMs\":%.3f,"
+             "\"idleRatio\":%.4f,",
+             firstArm ? "" : ",", names[i], arm.completed, arm.errors, arm.dropped, arm.rejected, arm.busyMicros / 1000.0,
+             arm.activeMicros / 1000.0, idleRatio);
+      printSummary("dispatch", dispatch, true, false);
+      printSummary("ack", ack, true, true);
+      printf("}");
+    } else {
+      printf("%s: %lu completed, %lu errors, %lu dropped, %lu rejected\n", names[i], arm.completed, arm.errors, arm.dropped,
+             arm.rejected);
+      printf("    idle ratio %.3f (busy %.1fms of %.1fms)\n", idleRatio, arm.busyMicros / 1000.0, arm.activeMicros / 1000.0);
+      printSummary("dispatch", dispatch, false, false);
+      printSummary("ack", ack, false, true);
+    }
+    firstArm = false;
+  }
+  if (json) {
+    printf("}}\n");
+  }
+  return timedOut ? 1 : 0;
+}
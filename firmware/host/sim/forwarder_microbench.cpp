@@ -0,0 +1,637 @@
+#include <fcntl.h>
+#include <math.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "AsyncHTTPClient.h"
+#include "CommandForwarder.h"
+#include "ForwarderProbe.h"
+#include "ScriptServer.h"
+
+// Times the forwarder's per-message hot paths in a loop, Google Benchmark
+// style: each case runs enough iterations to fill --min-time and reports
+// ns/op and heap allocations/op. --json output can be saved and passed back
+// as --baseline to flag regressions.
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+// Every form of new takes its block from malloc() and every form of delete
+// hands it to free(). They are kept out of line: once a delete is inlined into
+// library code, GCC pairs the free() with its own operator new and warns.
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+  void* block = malloc(size ? size : 1);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* block) noexcept {
+  free(block);
+}
+
+__attribute__((noinline)) void operator delete[](void* block) noexcept {
+  operator delete(block);
+}
+
+__attribute__((noinline)) void operator delete(void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+__attribute__((noinline)) void operator delete[](void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+// Keeps a result alive so the compiler cannot drop the work behind it.
+static volatile size_t sink;
+
+class BenchState {
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  uint64_t remaining;
+  bool started;
+  Clock::time_point resumedAt;
+  uint64_t allocationsAtResume;
+  uint64_t bytesAtResume;
+  const char* skipReason;
+
+public:
+  uint64_t iterations;
+  uint64_t elapsedNanos;
+  uint64_t allocations;
+  uint64_t bytes;
+
+  explicit BenchState(uint64_t count)
+      : remaining(count), started(false), allocationsAtResume(0), bytesAtResume(0), skipReason(nullptr),
+        iterations(count), elapsedNanos(0), allocations(0), bytes(0) {}
+
+  // Setup before the first call and teardown after the last are not timed.
+  bool keepRunning() {
+    if (!started) {
+      started = true;
+      resume();
+    }
+    if (remaining > 0) {
+      remaining--;
+      return true;
+    }
+    pause();
+    return false;
+  }
+
+  void pause() {
+    elapsedNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - resumedAt).count();
+    allocations += allocationCount.load(std::memory_order_relaxed) - allocationsAtResume;
+    bytes += allocationBytes.load(std::memory_order_relaxed) - bytesAtResume;
+  }
+
+  void resume() {
+    allocationsAtResume = allocationCount.load(std::memory_order_relaxed);
+    bytesAtResume = allocationBytes.load(std::memory_order_relaxed);
+    resumedAt = Clock::now();
+  }
+
+  void skip(const char* reason) {
+    skipReason = reason;
+  }
+
+  const char* skipped() const {
+    return skipReason;
+  }
+};
+
+struct Benchmark {
+  const char* name;
+  void (*run)(BenchState& state);
+};
+
+struct BenchResult {
+  std::string name;
+  uint64_t iterations;
+  double nsPerOp;
+  double allocsPerOp;
+  double bytesPerOp;
+  const char* skipped;
+};
+
+struct BaselineEntry {
+  double nsPerOp;
+  double allocsPerOp;
+};
+
+// ---- CommandCodec::toUART ----
+
+static const char* const LONG_GROUP = "GROUP:X100,200,300:Y100,200,300:Z5";
+
+static void encodeCommand(BenchState& state, const char* webCommand) {
+  CommandRecord record;
+  const char* decoded;
+  if (!CommandCodec::decode(webCommand, record, decoded)) {
+    state.skip("cannot decode the command");
+    return;
+  }
+  // Dispatch reads the text out of the arm's window, not the JSON document.
+  static WindowText window;
+  window.reset();
+  window.append(record, decoded);
+  char buffer[UART_COMMAND_SIZE];
+  while (state.keepRunning()) {
+    sink = CommandCodec::toUART(record, window.at(record), "arm1", buffer, sizeof(buffer));
+  }
+}
+
+static void benchToUartMove(BenchState& state) {
+  encodeCommand(state, "MOVE:Z-400");
+}
+
+static void benchToUartGroup(BenchState& state) {
+  encodeCommand(state, "GROUP:X1200:Y300:Z-350");
+}
+
+static void benchToUartSpeed(BenchState& state) {
+  encodeCommand(state, "SPEED:ALL:3000");
+}
+
+static void benchToUartLongGroup(BenchState& state) {
+  encodeCommand(state, LONG_GROUP);
+}
+
+// The conversion the forwarder ran per dispatch before scripts were decoded
+// into records: the web command kept as a String, rewritten with String
+// concatenation every time it was sent.
+static String convertToUARTProtocol(String webCommand, String armId) {
+  String uartCommand = armId + ":";
+  
+  if (webCommand.startsWith("MOVE:X")) {
+    uartCommand += "X:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("MOVE:Y")) {
+    uartCommand += "Y:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("MOVE:Z")) {
+    uartCommand += "Z:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("MOVE:T")) {
+    uartCommand += "T:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("MOVE:G")) {
+    uartCommand += "G:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("GROUP:")) {
+    uartCommand += "GROUP:" + webCommand.substring(6);
+  } else if (webCommand.startsWith("WAIT:")) {
+    uartCommand += "WAIT:" + webCommand.substring(5);
+  } else if (webCommand.startsWith("ZERO")) {
+    uartCommand += "ZERO";
+  } else if (webCommand.startsWith("HOME")) {
+    uartCommand += "HOME";
+  } else if (webCommand.startsWith("SPEED:")) {
+    uartCommand += "SPEED:" + webCommand.substring(6);
+  } else {
+    uartCommand += "RAW:" + webCommand;
+  }
+  
+  return uartCommand;
+}
+
+static void convertCommand(BenchState& state, const char* webCommand) {
+  String command = webCommand;
+  String armId = "arm1";
+  while (state.keepRunning()) {
+    sink = convertToUARTProtocol(command, armId).length();
+  }
+}
+
+static void benchLegacyMove(BenchState& state) {
+  convertCommand(state, "MOVE:Z-400");
+}
+
+static void benchLegacyGroup(BenchState& state) {
+  convertCommand(state, "GROUP:X1200:Y300:Z-350");
+}
+
+static void benchLegacySpeed(BenchState& state) {
+  convertCommand(state, "SPEED:ALL:3000");
+}
+
+static void benchLegacyLongGroup(BenchState& state) {
+  convertCommand(state, LONG_GROUP);
+}
+
+// ---- Poll response JSON ----
+
+// CommandForwarder::readPollJson() through ForwarderProbe, on a forwarder that
+// was never initialized: with no script cache mounted, a new script costs the
+// parse, the decode into a page and the queue push. The page is dropped,
+// untimed, before the next iteration.
+static const char* const POLL_COMMANDS[] = {
+  "SPEED:ALL:3000", "HOME", "ZERO", "GROUP:X0:Y0:Z0", "MOVE:Z-400", "MOVE:G1", "MOVE:Z0", "GROUP:X1200:Y300",
+  "MOVE:T90", "MOVE:Z-350", "MOVE:G0", "MOVE:Z0", "GROUP:X0:Y0:T0", "MOVE:Z-400", "MOVE:G1", "MOVE:Z0",
+};
+
+static std::string pollBody(bool newScript) {
+  std::string body = "{\"shouldStart\":true";
+  for (int i = 0; i < ARM_COUNT; i++) {
+    body += ",\"";
+    body += ARM_PORTS[i].name;
+    body += "\":{\"hasNewScript\":";
+    if (!newScript || i > 0) {
+      body += "false}";
+      continue;
+    }
+    body += "true,\"scriptId\":\"pallet-layer-1\",\"format\":\"msl\",\"totalCommands\":48,\"commands\":[";
+    for (int c = 0; c < SCRIPT_PAGE_SIZE; c++) {
+      body += c ? ",\"" : "\"";
+      body += POLL_COMMANDS[c];
+      body += '"';
+    }
+    body += "]}";
+  }
+  body += '}';
+  return body;
+}
+
+static void parsePoll(BenchState& state, bool newScript) {
+  static CommandForwarder forwarder;
+  ForwarderProbe probe(forwarder);
+  std::string body = pollBody(newScript);
+
+  while (state.keepRunning()) {
+    if (!probe.readPollJson(body.data(), body.size())) {
+      state.skip("the poll body does not parse");
+      break;
+    }
+    state.pause();
+    probe.discardPages(0);
+    probe.drainLog(LOG_RING_SIZE);
+    state.resume();
+  }
+}
+
+static void benchPollNewScript(BenchState& state) {
+  parsePoll(state, true);
+}
+
+static void benchPollUnchanged(BenchState& state) {
+  parsePoll(state, false);
+}
+
+// ---- SerialBridge::readResponse ----
+
+// One reply queue's worth of acknowledgements is written ahead, untimed, and
+// then read back a reply per iteration.
+static void benchSerialText(BenchState& state) {
+  static const char REPLIES[] =
+    "OK#101/3\r\nDONE#100\r\nOK#102/2\r\nDONE#101/3\r\nOK#103/2\r\nDONE#102/3\r\nINFO:T=31.5\r\nDONE#103/4\r\n";
+  static HardwareSerial port(3);
+  static int peer = -1;
+  if (peer < 0) {
+    peer = port.openLoopback();
+  }
+  if (peer < 0) {
+    state.skip("cannot open a loopback UART");
+    return;
+  }
+  SerialBridge bridge(&port);
+  SerialResponse response;
+  int queued = 0;
+  while (state.keepRunning()) {
+    if (queued == 0) {
+      state.pause();
+      if (write(peer, REPLIES, sizeof(REPLIES) - 1) != (ssize_t)sizeof(REPLIES) - 1) {
+        state.skip("short write to the loopback UART");
+        break;
+      }
+      queued = SERIAL_QUEUE_SIZE;
+      state.resume();
+    }
+    if (bridge.readResponse(response)) {
+      sink = response.sequence;
+      queued--;
+    }
+  }
+  while (queued > 0 && !state.skipped()) {
+    if (bridge.readResponse(response)) {
+      queued--;
+    }
+  }
+}
+
+// ---- CommandForwarder::getArmStatus ----
+
+// A forwarder whose arm1 has halted on an ERROR reply and whose arm2 never
+// got a script. Built once, against ScriptServer and virtual arms that are
+// stopped again before anything is timed.
+static CommandForwarder* statusForwarder() {
+  static CommandForwarder forwarder;
+  static int state = 0;
+  if (state != 0) {
+    return state > 0 ? &forwarder : nullptr;
+  }
+  state = -1;
+
+  ScriptServer server;
+  if (!server.start()) {
+    return nullptr;
+  }
+  ArmRig rig;
+  VirtualArmConfig config;
+  config.name = ARM_PORTS[0].name;
+  config.timeScale = 0.01;
+  config.errorRate = 1;
+  rig.add(Serial1.openLoopback(), config);
+  config.name = ARM_PORTS[1].name;
+  config.errorRate = 0;
+  rig.add(Serial2.openLoopback(), config);
+  rig.start();
+
+  server.publish(0, "status-fixture", std::vector<std::string>(1, "MOVE:X100"));
+  forwarder.initialize("bench", "", "127.0.0.1", server.port());
+  unsigned long start = millis();
+  while (!forwarder.getArmStatus(0).startsWith("ERROR") && millis() - start < 10000) {
+    forwarder.update();
+  }
+  rig.stop();
+  server.stop();
+  if (forwarder.getArmStatus(0).startsWith("ERROR")) {
+    state = 1;
+  }
+  return state > 0 ? &forwarder : nullptr;
+}
+
+static void armStatus(BenchState& state, int armIndex) {
+  CommandForwarder* forwarder = statusForwarder();
+  if (!forwarder) {
+    state.skip("the forwarder fixture did not reach an arm error");
+    return;
+  }
+  while (state.keepRunning()) {
+    sink = forwarder->getArmStatus(armIndex).length();
+  }
+}
+
+static void benchStatusError(BenchState& state) {
+  armStatus(state, 0);
+}
+
+static void benchStatusIdle(BenchState& state) {
+  armStatus(state, 1);
+}
+
+// ---- AsyncHTTPClient::pollHeaders ----
+
+// A poll on a kept-alive connection, as HttpClient issues it: begin(),
+// sendRequestAsync() with the ETag, then pollHeaders() over a 304 reply. The
+// server side is a socket pair serviced while the clock is paused.
+static void benchHttpNotModified(BenchState& state) {
+  static const char RESPONSE[] =
+    "HTTP/1.1 304 Not Modified\r\n"
+    "X-Powered-By: Express\r\n"
+    "ETag: W/\"2f1-k9Yh0bXz2Ym0dQp3o4Uq1sA3l8c\"\r\n"
+    "Date: Thu, 15 Oct 2026 08:12:44 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "Keep-Alive: timeout=5\r\n"
+    "\r\n";
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+    state.skip("cannot open a socket pair");
+    return;
+  }
+  WiFiClient client(pair[0]);
+  AsyncHTTPClient http;
+  static const char* collected[] = { "ETag" };
+  http.collectHeaders(collected, 1);
+  String endpoint = "/api/script/poll?pageSize=" + String(SCRIPT_PAGE_SIZE);
+  char etag[HTTP_ETAG_SIZE] = "W/\"2f1-k9Yh0bXz2Ym0dQp3o4Uq1sA3l8c\"";
+  char request[1024];
+
+  while (state.keepRunning()) {
+    http.begin(client, "127.0.0.1", 3006, endpoint);
+    http.setReuse(true);
+    http.addHeader("If-None-Match", etag);
+    if (!http.sendRequestAsync("GET", 0)) {
+      state.skip("the request could not be written");
+      break;
+    }
+    state.pause();
+    while (recv(pair[1], request, sizeof(request), MSG_DONTWAIT) > 0) {
+    }
+    send(pair[1], RESPONSE, sizeof(RESPONSE) - 1, 0);
+    state.resume();
+    int code;
+    while ((code = http.pollHeaders()) == 0) {
+    }
+    sink = code;
+  }
+  client.stop();
+  close(pair[1]);
+}
+
+static const Benchmark BENCHMARKS[] = {
+  { "command_to_uart/move", benchToUartMove },
+  { "command_to_uart/group", benchToUartGroup },
+  { "command_to_uart/speed", benchToUartSpeed },
+  { "command_to_uart/long_group", benchToUartLongGroup },
+  { "legacy_convert/move", benchLegacyMove },
+  { "legacy_convert/group", benchLegacyGroup },
+  { "legacy_convert/speed", benchLegacySpeed },
+  { "legacy_convert/long_group", benchLegacyLongGroup },
+  { "poll_json/new_script", benchPollNewScript },
+  { "poll_json/unchanged", benchPollUnchanged },
+  { "serial_response/text", benchSerialText },
+  { "arm_status/idle", benchStatusIdle },
+  { "arm_status/error", benchStatusError },
+  { "http_headers/not_modified", benchHttpNotModified },
+};
+
+// Grows the iteration count until one run fills minSeconds, as Google
+// Benchmark does, and reports that run.
+static BenchResult measureOnce(const Benchmark& benchmark, double minSeconds) {
+  static const uint64_t MAX_ITERATIONS = 1000000000;
+  uint64_t iterations = 1;
+  for (;;) {
+    BenchState state(iterations);
+    benchmark.run(state);
+    double seconds = state.elapsedNanos / 1e9;
+    if (state.skipped() || seconds >= minSeconds || iterations >= MAX_ITERATIONS) {
+      BenchResult result;
+      result.name = benchmark.name;
+      result.iterations = iterations;
+      result.nsPerOp = (double)state.elapsedNanos / iterations;
+      result.allocsPerOp = (double)state.allocations / iterations;
+      result.bytesPerOp = (double)state.bytes / iterations;
+      result.skipped = state.skipped();
+      return result;
+    }
+    double scale = seconds > 0 ? minSeconds * 1.4 / seconds : 100;
+    scale = scale < 2 ? 2 : scale > 100 ? 100 : scale;
+    iterations = (uint64_t)ceil(iterations * scale);
+    iterations = iterations > MAX_ITERATIONS ? MAX_ITERATIONS : iterations;
+  }
+}
+
+// Scheduling noise only ever adds time, so the fastest repetition is the
+// one compared against the baseline.
+static BenchResult measure(const Benchmark& benchmark, double minSeconds, int repetitions) {
+  BenchResult best = measureOnce(benchmark, minSeconds);
+  for (int i = 1; i < repetitions && !best.skipped; i++) {
+    BenchResult result = measureOnce(benchmark, minSeconds);
+    if (result.nsPerOp < best.nsPerOp) {
+      best = result;
+    }
+  }
+  return best;
+}
+
+static bool loadBaseline(const char* path, std::map<std::string, BaselineEntry>& baseline) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  std::string text;
+  char chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    text.append(chunk, count);
+  }
+  fclose(file);
+
+  DynamicJsonDocument doc(text.size() * 2 + 1024);
+  if (deserializeJson(doc, text.data(), text.size())) {
+    return false;
+  }
+  JsonArray entries = doc["benchmarks"];
+  for (JsonVariant entry : entries) {
+    const char* name = entry["name"].as<const char*>();
+    if (name && !entry["skipped"].as<bool>()) {
+      baseline[name] = { entry["nsPerOp"].as<double>(), entry["allocsPerOp"].as<double>() };
+    }
+  }
+  return true;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--filter text] [--min-time s] [--repetitions n] [--json]\n"
+          "          [--baseline file] [--max-regression percent]\n",
+          program);
+}
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  double minSeconds = 0.5;
+  int repetitions = 3;
+  bool json = false;
+  const char* baselinePath = nullptr;
+  double maxRegression = 10;
+
+  for (int i = 1; i < argc; i++) {
+    const char* option = argv[i];
+    if (strcmp(option, "--json") == 0) {
+      json = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(option, "--filter") == 0) {
+      filter = value;
+    } else if (strcmp(option, "--min-time") == 0) {
+      minSeconds = atof(value);
+    } else if (strcmp(option, "--repetitions") == 0) {
+      repetitions = atoi(value);
+    } else if (strcmp(option, "--baseline") == 0) {
+      baselinePath = value;
+    } else if (strcmp(option, "--max-regression") == 0) {
+      maxRegression = atof(value);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (minSeconds <= 0 || repetitions < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::map<std::string, BaselineEntry> baseline;
+  if (baselinePath && !loadBaseline(baselinePath, baseline)) {
+    fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+    return 1;
+  }
+
+  Serial.attach(open("/dev/null", O_WRONLY), true);
+  char dataDir[] = "/tmp/forwarder-microbench-XXXXXX";
+  if (!mkdtemp(dataDir) || chdir(dataDir) != 0) {
+    fprintf(stderr, "cannot create a working directory\n");
+    return 1;
+  }
+
+  std::vector<BenchResult> results;
+  for (const Benchmark& benchmark : BENCHMARKS) {
+    if (!filter || strstr(benchmark.name, filter)) {
+      results.push_back(measure(benchmark, minSeconds, repetitions));
+    }
+  }
+
+  std::error_code ignored;
+  std::filesystem::remove_all(dataDir, ignored);
+
+  bool regressed = false;
+  if (json) {
+    printf("{\"minTime\":%.3f,\"repetitions\":%d,\"benchmarks\":[", minSeconds, repetitions);
+  } else {
+    printf("%-28s %12s %12s %10s %10s%s\n", "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op",
+           baseline.empty() ? "" : "   vs baseline");
+  }
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult& result = results[i];
+    auto previous = baseline.find(result.name);
+    bool compared = !result.skipped && previous != baseline.end() && previous->second.nsPerOp > 0;
+    double change = compared ? (result.nsPerOp / previous->second.nsPerOp - 1) * 100 : 0;
+    bool worse = compared && (change > maxRegression || result.allocsPerOp > previous->second.allocsPerOp + 0.01);
+    regressed = regressed || worse;
+
+    if (json) {
+      printf("%s{\"name\":\"%s\",", i ? "," : "", result.name.c_str());
+      if (result.skipped) {
+        printf("\"skipped\":true,\"reason\":\"%s\"}", result.skipped);
+        continue;
+      }
+      printf("\"iterations\":%llu,\"nsPerOp\":%.2f,\"allocsPerOp\":%.3f,\"bytesPerOp\":%.1f",
+             (unsigned long long)result.iterations, result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+      if (compared) {
+        printf(",\"baselineNsPerOp\":%.2f,\"baselineAllocsPerOp\":%.3f,\"changePercent\":%.1f,\"regressed\":%s",
+               previous->second.nsPerOp, previous->second.allocsPerOp, change, worse ? "true" : "false");
+      }
+      printf("}");
+    } else if (result.skipped) {
+      printf("%-28s skipped: %s\n", result.name.c_str(), result.skipped);
+    } else {
+      printf("%-28s %12llu %12.1f %10.2f %10.1f", result.name.c_str(), (unsigned long long)result.iterations,
+             result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+      if (compared) {
+        printf("   %+6.1f%%%s", change, worse ? "  REGRESSED" : "");
+      }
+      printf("\n");
+    }
+  }
+  if (json) {
+    printf("]}\n");
+  }
+  return regressed ? 1 : 0;
+}
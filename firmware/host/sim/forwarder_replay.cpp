@@ -0,0 +1,224 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "CommandForwarder.h"
+#include "HostClock.h"
+#include "TraceReplay.h"
+
+// Replays a trace recorded with forwarder_host --record into the forwarder,
+// single-threaded on the virtual clock: update() runs once per step, and the
+// clock jumps straight to the next step or the next recorded input, whichever
+// comes first. The same trace and build always give the same output, so a
+// shift recorded in production can be run against two firmware builds and
+// their cycle times compared.
+
+struct ArmJobs {
+  unsigned long promotions;
+  bool open;
+  uint64_t startMicros;
+  std::vector<uint64_t> cycles;
+};
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s --trace file [--step-ms n] [--tail s] [--pipeline depth]\n"
+          "          [--binary on|off] [--json] [--log]\n",
+          program);
+}
+
+static void onClock(void* context, uint64_t nowMicros) {
+  static_cast<TraceReplay*>(context)->service(nowMicros);
+}
+
+static uint64_t percentile(std::vector<uint64_t> values, int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  uint64_t stepMicros = 1000;
+  uint64_t tailMicros = 15000000;
+  int pipelineOverride = 0;
+  const char* binaryOverride = nullptr;
+  bool json = false;
+  bool log = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char* option = argv[i];
+    if (strcmp(option, "--json") == 0) {
+      json = true;
+      continue;
+    }
+    if (strcmp(option, "--log") == 0) {
+      log = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(option, "--trace") == 0) {
+      tracePath = value;
+    } else if (strcmp(option, "--step-ms") == 0) {
+      stepMicros = (uint64_t)(atof(value) * 1000);
+    } else if (strcmp(option, "--tail") == 0) {
+      tailMicros = (uint64_t)(atof(value) * 1000000);
+    } else if (strcmp(option, "--pipeline") == 0) {
+      pipelineOverride = atoi(value);
+    } else if (strcmp(option, "--binary") == 0) {
+      binaryOverride = value;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!tracePath || stepMicros == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<TraceRecord> records;
+  static TraceReplay replay;
+  if (!readTrace(tracePath, records) || !replay.load(records)) {
+    fprintf(stderr, "cannot read trace %s\n", tracePath);
+    return 1;
+  }
+  std::string encoding = traceConfigValue(records, "encoding");
+  int pipelineDepth = pipelineOverride > 0 ? pipelineOverride : atoi(traceConfigValue(records, "pipeline").c_str());
+  bool binaryProtocol = binaryOverride ? strcmp(binaryOverride, "on") == 0 : traceConfigValue(records, "binary") == "1";
+  records.clear();
+  records.shrink_to_fit();
+
+  if (!replay.start()) {
+    fprintf(stderr, "cannot start the replay server\n");
+    return 1;
+  }
+  int logFd = open(log ? "/dev/stderr" : "/dev/null", O_WRONLY);
+  Serial.attach(logFd, true);
+
+  // Replay starts from an empty script cache, as the recording should have.
+  char dataDir[] = "/tmp/forwarder-replay-XXXXXX";
+  if (!mkdtemp(dataDir) || chdir(dataDir) != 0) {
+    fprintf(stderr, "cannot create a working directory\n");
+    return 1;
+  }
+
+  HostClock::useVirtual(replay.getStartMicros());
+  HostClock::setHook(onClock, &replay);
+  replay.attachPort(0, Serial1.openLoopback());
+  replay.attachPort(1, Serial2.openLoopback());
+
+  static CommandForwarder forwarder;
+  if (pipelineDepth > 0 && !forwarder.setPipelineDepth(pipelineDepth)) {
+    fprintf(stderr, "invalid pipeline depth %d\n", pipelineDepth);
+    return 2;
+  }
+  forwarder.setBinaryProtocol(binaryProtocol);
+  forwarder.setScriptEncoding(encoding == "bin" ? SCRIPT_ENCODING_BINARY : SCRIPT_ENCODING_JSON);
+
+  auto wallStart = std::chrono::steady_clock::now();
+  forwarder.initialize("replay", "", "127.0.0.1", replay.port());
+
+  ArmJobs jobs[TRACE_REPLAY_ARMS];
+  for (ArmJobs& arm : jobs) {
+    arm.promotions = 0;
+    arm.open = false;
+    arm.startMicros = 0;
+  }
+  uint64_t endMicros = replay.getEndMicros() + tailMicros;
+  unsigned long steps = 0;
+  for (uint64_t now = HostClock::now(); now < endMicros;) {
+    replay.deliver(now);
+    forwarder.update();
+    replay.collect(now);
+    steps++;
+    for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+      ArmJobs& arm = jobs[i];
+      SwapStats swaps = forwarder.getArmSwapStats(i);
+      if (swaps.promotions != arm.promotions) {
+        arm.promotions = swaps.promotions;
+        arm.open = true;
+        arm.startMicros = now;
+      }
+      if (arm.open && forwarder.getArmProgress(i) == 100) {
+        arm.cycles.push_back(now - arm.startMicros);
+        arm.open = false;
+      }
+    }
+    uint64_t next = replay.nextEventMicros();
+    now = HostClock::now();
+    next = next > now ? std::min(next, now + stepMicros) : now + 1;
+    HostClock::set(next);
+    now = next;
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  std::error_code ignored;
+  std::filesystem::remove_all(dataDir, ignored);
+
+  TraceReplayStats stats = replay.getStats();
+  double tracedSeconds = (replay.getEndMicros() - replay.getStartMicros()) / 1e6;
+  if (json) {
+    printf("{\"tracedSeconds\":%.3f,\"wallSeconds\":%.3f,\"steps\":%lu,\"pipeline\":%d,\"binary\":%s,"
+           "\"http\":{\"served\":%lu,\"unmatched\":%lu,\"unused\":%lu},\"arms\":{",
+           tracedSeconds, wallSeconds, steps, forwarder.getPipelineDepth(), binaryProtocol ? "true" : "false",
+           stats.httpServed, stats.httpUnmatched, stats.httpUnused);
+  } else {
+    printf("Replayed %.1fs of trace in %.2fs (%.0fx), %lu steps, pipeline %d, %s protocol\n", tracedSeconds, wallSeconds,
+           wallSeconds > 0 ? tracedSeconds / wallSeconds : 0, steps, forwarder.getPipelineDepth(),
+           binaryProtocol ? "binary" : "text");
+    printf("HTTP: %lu served, %lu unmatched requests, %lu recorded exchanges unused\n", stats.httpServed,
+           stats.httpUnmatched, stats.httpUnused);
+  }
+
+  bool firstArm = true;
+  for (int i = 0; i < TRACE_REPLAY_ARMS; i++) {
+    const std::vector<uint64_t>& cycles = jobs[i].cycles;
+    if (stats.txMessages[i] == 0 && stats.uartDelivered[i] == 0 && stats.uartPending[i] == 0) {
+      continue;
+    }
+    uint64_t total = 0;
+    for (uint64_t cycle : cycles) total += cycle;
+    double averageMs = cycles.empty() ? 0 : total / 1000.0 / cycles.size();
+    ResponseStats responses = forwarder.getArmResponseStats(i);
+    LatencySummary dispatch = forwarder.getArmLatency(i, LATENCY_DISPATCH);
+    LatencySummary ack = forwarder.getArmLatency(i, LATENCY_ACK);
+    const char* name = forwarder.getArmName(i);
+    if (json) {
+      printf("%s\"%s\":{\"jobs\":%zu,\"cycleMs\":{\"avg\":%.3f,\"p50\":%.3f,\"p95\":%.3f,\"max\":%.3f},"
+             "\"acknowledged\":%lu,\"errors\":%lu,\"stray\":%lu,\"txMessages\":%lu,\"txMismatches\":%lu,\"firstMismatch\":%ld,"
+             "\"rxDelivered\":%lu,\"rxPending\":%lu,\"dispatchP99Us\":%lu,\"ackP50Us\":%lu,\"ackP99Us\":%lu}",
+             firstArm ? "" : ",", name, cycles.size(), averageMs, percentile(cycles, 50) / 1000.0,
+             percentile(cycles, 95) / 1000.0, percentile(cycles, 100) / 1000.0, responses.ok + responses.done,
+             responses.error, responses.stray, stats.txMessages[i], stats.txMismatches[i], stats.firstMismatch[i],
+             stats.uartDelivered[i], stats.uartPending[i], dispatch.p99, ack.p50, ack.p99);
+    } else {
+      printf("%s: %zu jobs, cycle avg %.1fms, p50 %.1fms, p95 %.1fms, max %.1fms\n", name, cycles.size(), averageMs,
+             percentile(cycles, 50) / 1000.0, percentile(cycles, 95) / 1000.0, percentile(cycles, 100) / 1000.0);
+      printf("    %lu acknowledged, %lu errors, %lu stray replies\n", responses.ok + responses.done, responses.error,
+             responses.stray);
+      printf("    UART: %lu messages sent, %lu differ from the recording", stats.txMessages[i], stats.txMismatches[i]);
+      if (stats.firstMismatch[i] >= 0) {
+        printf(" (first at message %ld)", stats.firstMismatch[i]);
+      }
+      printf("; %lu replies delivered, %lu never due\n", stats.uartDelivered[i], stats.uartPending[i]);
+      printf("    dispatch p99 %luus, ack p50 %luus, p99 %luus\n", dispatch.p99, ack.p50, ack.p99);
+    }
+    firstArm = false;
+  }
+  if (json) {
+    printf("}}\n");
+  }
+  return 0;
+}
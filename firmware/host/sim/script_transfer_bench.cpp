@@ -0,0 +1,244 @@
+#include <fcntl.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ForwarderProbe.h"
+#include "ScriptImage.h"
+#include "SimOptions.h"
+
+// Downloads one script as the forwarder would, a poll and then a chunk per
+// SCRIPT_PAGE_SIZE commands, once as JSON and once as the binary script image
+// (?encoding=bin), and reports the bytes on the wire and the time the
+// forwarder's own readers take to turn them into command pages. Bodies are
+// built up front, so only the readers are timed.
+
+struct Transfer {
+  const char* name;
+  std::vector<std::string> bodies;
+  size_t bytes;
+  double decodeMicros;
+  double bestMicros;
+};
+
+static void usage(const char* program) {
+  fprintf(stderr, "usage: %s --script file [--commands n] [--rounds n] [--json]\n", program);
+}
+
+static void appendJsonString(std::string& body, const std::string& text) {
+  body += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') body += '\\';
+    body += c;
+  }
+  body += '"';
+}
+
+static void appendJsonCommands(std::string& body, const std::vector<std::string>& commands, size_t offset, size_t count) {
+  body += '[';
+  for (size_t i = offset; i < offset + count; i++) {
+    if (i > offset) body += ',';
+    appendJsonString(body, commands[i]);
+  }
+  body += ']';
+}
+
+// Same layout as src/server/scriptImage.ts.
+static void appendVarint(std::string& body, uint32_t value) {
+  while (value >= 0x80) {
+    body += (char)((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  body += (char)value;
+}
+
+static void appendImageString(std::string& body, const std::string& text) {
+  body += (char)text.size();
+  body += text;
+}
+
+static void appendImageRecords(std::string& body, const std::vector<std::string>& commands, size_t offset, size_t count) {
+  appendVarint(body, count);
+  for (size_t i = offset; i < offset + count; i++) {
+    CommandRecord record;
+    const char* text;
+    uint8_t encoded[BINARY_COMMAND_SIZE];
+    size_t length = CommandCodec::decode(commands[i].c_str(), record, text)
+                      ? CommandCodec::toBinary(record, text, encoded, sizeof(encoded)) : 0;
+    body += (char)length;
+    body.append((const char*)encoded, length);
+  }
+}
+
+static size_t pageCount(size_t total, size_t offset) {
+  return total - offset < (size_t)SCRIPT_PAGE_SIZE ? total - offset : SCRIPT_PAGE_SIZE;
+}
+
+static void buildJson(Transfer& transfer, const std::string& scriptId, const std::vector<std::string>& commands) {
+  size_t total = commands.size();
+  std::string poll = "{\"shouldStart\":false,\"arm1\":{\"hasNewScript\":true,\"scriptId\":";
+  appendJsonString(poll, scriptId);
+  poll += ",\"format\":\"msl\",\"totalCommands\":" + std::to_string(total) + ",\"commands\":";
+  appendJsonCommands(poll, commands, 0, pageCount(total, 0));
+  poll += "},\"arm2\":{\"hasNewScript\":false}}";
+  transfer.bodies.push_back(poll);
+
+  for (size_t offset = SCRIPT_PAGE_SIZE; offset < total; offset += SCRIPT_PAGE_SIZE) {
+    std::string chunk = "{\"scriptId\":";
+    appendJsonString(chunk, scriptId);
+    chunk += ",\"offset\":" + std::to_string(offset) + ",\"commands\":";
+    appendJsonCommands(chunk, commands, offset, pageCount(total, offset));
+    chunk += '}';
+    transfer.bodies.push_back(chunk);
+  }
+}
+
+static void buildImage(Transfer& transfer, const std::string& scriptId, const std::vector<std::string>& commands) {
+  size_t total = commands.size();
+  std::string poll = { 'P', (char)SCRIPT_IMAGE_POLL, (char)SCRIPT_IMAGE_VERSION, 0, ARM_COUNT };
+  appendImageString(poll, "arm1");
+  poll += (char)1;
+  appendImageString(poll, scriptId);
+  appendImageString(poll, "msl");
+  appendVarint(poll, total);
+  appendImageRecords(poll, commands, 0, pageCount(total, 0));
+  appendImageString(poll, "arm2");
+  poll += (char)0;
+  transfer.bodies.push_back(poll);
+
+  for (size_t offset = SCRIPT_PAGE_SIZE; offset < total; offset += SCRIPT_PAGE_SIZE) {
+    std::string chunk = { 'P', (char)SCRIPT_IMAGE_CHUNK, (char)SCRIPT_IMAGE_VERSION };
+    appendImageString(chunk, scriptId);
+    appendVarint(chunk, offset);
+    appendVarint(chunk, total);
+    appendImageRecords(chunk, commands, offset, pageCount(total, offset));
+    transfer.bodies.push_back(chunk);
+  }
+}
+
+// Returns the microseconds the readers took, or a negative value if a body
+// was refused or the script came out short.
+static double decode(ForwarderProbe& probe, const Transfer& transfer, bool binary, size_t total) {
+  typedef std::chrono::steady_clock Clock;
+  double micros = 0;
+  for (size_t i = 0; i < transfer.bodies.size(); i++) {
+    const std::string& body = transfer.bodies[i];
+    Clock::time_point started = Clock::now();
+    bool read;
+    if (i == 0) {
+      read = binary ? probe.readPollImage((const uint8_t*)body.data(), body.size())
+                    : probe.readPollJson(body.data(), body.size());
+    } else {
+      read = binary ? probe.readChunkImage(0, (const uint8_t*)body.data(), body.size())
+                    : probe.readChunkJson(0, body.data(), body.size());
+    }
+    micros += std::chrono::duration<double, std::micro>(Clock::now() - started).count();
+    if (!read) {
+      return -1;
+    }
+    probe.discardPages(0);
+    probe.drainLog(LOG_RING_SIZE);
+  }
+  return probe.stagedFetched(0) == (int)total ? micros : -1;
+}
+
+int main(int argc, char** argv) {
+  const char* scriptPath = nullptr;
+  size_t commandCount = 5000;
+  int rounds = 20;
+  bool json = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char* option = argv[i];
+    if (strcmp(option, "--json") == 0) {
+      json = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(option, "--script") == 0) {
+      scriptPath = value;
+    } else if (strcmp(option, "--commands") == 0) {
+      commandCount = strtoul(value, nullptr, 10);
+    } else if (strcmp(option, "--rounds") == 0) {
+      rounds = atoi(value);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!scriptPath || commandCount < 1 || rounds < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<std::string> source;
+  if (!loadScript(scriptPath, source)) {
+    fprintf(stderr, "cannot read script %s\n", scriptPath);
+    return 1;
+  }
+  std::vector<std::string> commands;
+  while (commands.size() < commandCount) {
+    commands.push_back(source[commands.size() % source.size()]);
+  }
+
+  Serial.attach(open("/dev/null", O_WRONLY), true);
+
+  // Not initialized: with no script cache mounted, the readers do nothing
+  // but parse and decode.
+  static CommandForwarder forwarder;
+  ForwarderProbe probe(forwarder);
+
+  Transfer transfers[2] = { { "json", {}, 0, 0, 0 }, { "binary", {}, 0, 0, 0 } };
+  buildJson(transfers[0], "transfer-bench", commands);
+  buildImage(transfers[1], "transfer-bench", commands);
+  for (Transfer& transfer : transfers) {
+    for (const std::string& body : transfer.bodies) {
+      transfer.bytes += body.size();
+    }
+  }
+
+  // Rounds alternate between the encodings so both see the same cache and
+  // frequency conditions; the fastest round is reported next to the mean.
+  for (int round = 0; round < rounds; round++) {
+    for (int t = 0; t < 2; t++) {
+      Transfer& transfer = transfers[t];
+      double micros = decode(probe, transfer, t == 1, commands.size());
+      if (micros < 0) {
+        fprintf(stderr, "%s transfer did not decode all %zu commands\n", transfer.name, commands.size());
+        return 1;
+      }
+      transfer.decodeMicros += micros;
+      transfer.bestMicros = round == 0 || micros < transfer.bestMicros ? micros : transfer.bestMicros;
+    }
+  }
+
+  if (json) {
+    printf("{\"commands\":%zu,\"pages\":%zu,\"rounds\":%d", commands.size(), transfers[0].bodies.size(), rounds);
+  } else {
+    printf("%zu commands in %zu pages, %d rounds\n", commands.size(), transfers[0].bodies.size(), rounds);
+    printf("%-8s %12s %12s %12s %12s\n", "Encoding", "Bytes", "Decode us", "Best us", "ns/command");
+  }
+  for (const Transfer& transfer : transfers) {
+    double mean = transfer.decodeMicros / rounds;
+    if (json) {
+      printf(",\"%s\":{\"bytes\":%zu,\"decodeUs\":%.1f,\"bestUs\":%.1f,\"nsPerCommand\":%.1f}", transfer.name, transfer.bytes,
+             mean, transfer.bestMicros, mean * 1000 / commands.size());
+    } else {
+      printf("%-8s %12zu %12.1f %12.1f %12.1f\n", transfer.name, transfer.bytes, mean, transfer.bestMicros,
+             mean * 1000 / commands.size());
+    }
+  }
+  double byteRatio = (double)transfers[1].bytes / transfers[0].bytes;
+  double timeRatio = transfers[1].decodeMicros / transfers[0].decodeMicros;
+  if (json) {
+    printf(",\"binaryToJson\":{\"bytes\":%.3f,\"decode\":%.3f}}\n", byteRatio, timeRatio);
+  } else {
+    printf("binary/json: %.2fx the bytes, %.2fx the decode time\n", byteRatio, timeRatio);
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ArmRig.h"
+#include "SimOptions.h"
+
+// Standalone arm master on a pty, for forwarder_host or a real ESP32 on a
+// USB-serial adapter.
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal) {
+  stopRequested = 1;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--port pty|path] [--name arm1] %s\n",
+          program, SIM_ARM_OPTIONS_USAGE);
+}
+
+static void makeRaw(int fd) {
+  struct termios settings;
+  if (tcgetattr(fd, &settings) == 0) {
+    cfmakeraw(&settings);
+    tcsetattr(fd, TCSANOW, &settings);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* port = "pty";
+  VirtualArmConfig config;
+
+  for (int i = 1; i < argc; i++) {
+    int consumed = parseArmOption(argc, argv, i, config);
+    if (consumed > 0) {
+      i += consumed - 1;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(argv[i], "--port") == 0) {
+      port = argv[++i];
+    } else if (strcmp(argv[i], "--name") == 0) {
+      config.name = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  int fd;
+  int slave = -1;
+  if (strcmp(port, "pty") == 0) {
+    char path[64];
+    // The slave stays open here too, so the master does not report a hangup
+    // before the forwarder has opened it.
+    if (openpty(&fd, &slave, path, nullptr, nullptr) < 0) {
+      perror("openpty");
+      return 1;
+    }
+    makeRaw(slave);
+    printf("%s UART: %s\n", config.name, path);
+  } else {
+    fd = open(port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      perror(port);
+      return 1;
+    }
+    makeRaw(fd);
+    printf("%s UART: %s\n", config.name, port);
+  }
+  fflush(stdout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  ArmRig rig;
+  rig.add(fd, config);
+  rig.start();
+  while (!stopRequested && rig.isConnected(0)) {
+    usleep(100000);
+  }
+  rig.stop();
+
+  VirtualArmStats stats = rig.getStats(0);
+  uint64_t window = stats.lastReplyMicros > stats.firstCommandMicros ? stats.lastReplyMicros - stats.firstCommandMicros : 0;
+  printf("%s: %lu received, %lu completed, %lu errors, %lu dropped, %lu rejected, %lu malformed\n", config.name,
+         stats.received, stats.completed, stats.errors, stats.dropped, stats.rejected, stats.malformed);
+  printf("%s: busy %.3fs of %.3fs, idle ratio %.3f\n", config.name, stats.busyMicros / 1e6, window / 1e6,
+         window > 0 ? 1.0 - (double)stats.busyMicros / window : 0.0);
+  if (slave >= 0) {
+    close(slave);
+  }
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,202 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommandCodec.h"
+#include "CommandText.h"
+
+// Every command shape src/compiler/generators/TextGenerator.ts can emit must
+// reach the arm masters as exactly the bytes the original String-based
+// convertToUARTProtocol() produced, whether the record went straight to the
+// UART or through the binary script image / cache encoding first.
+
+static int failures = 0;
+
+static void fail(const std::string& command, const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s: %s %s\n", command.c_str(), what, detail.c_str());
+}
+
+static bool startsWith(const std::string& text, const char* prefix) {
+  return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// The forwarder's conversion before commands were decoded into records.
+static std::string legacyUART(const std::string& webCommand, const char* armId) {
+  std::string uart = std::string(armId) + ":";
+  static const char* const MOVES[] = { "MOVE:X", "MOVE:Y", "MOVE:Z", "MOVE:T", "MOVE:G" };
+  for (const char* move : MOVES) {
+    if (startsWith(webCommand, move)) {
+      return uart + move[5] + ":" + webCommand.substr(6);
+    }
+  }
+  if (startsWith(webCommand, "GROUP:")) return uart + "GROUP:" + webCommand.substr(6);
+  if (startsWith(webCommand, "WAIT:")) return uart + "WAIT:" + webCommand.substr(5);
+  if (startsWith(webCommand, "ZERO")) return uart + "ZERO";
+  if (startsWith(webCommand, "HOME")) return uart + "HOME";
+  if (startsWith(webCommand, "SPEED:")) return uart + "SPEED:" + webCommand.substr(6);
+  return uart + "RAW:" + webCommand;
+}
+
+static std::string positions(int count, int start, int step) {
+  std::string text;
+  for (int i = 0; i < count; i++) {
+    text += (i ? "," : "") + std::to_string(start + i * step);
+  }
+  return text;
+}
+
+static std::vector<std::string> generatorForms() {
+  std::vector<std::string> forms = {
+    "HOME", "HOME:X", "HOME:G", "ZERO",
+    "SPEED:ALL:3000", "SPEED:X:1500", "SPEED:Z:12.5", "SPEED:T:0",
+    "MOVE:X100", "MOVE:Z-400", "MOVE:G0", "MOVE:X1.5", "MOVE:Y-0.25", "MOVE:T2147483647", "MOVE:X2147483648",
+    "MOVE:X100,200,300", "MOVE:X100,200,300,400,500,600", "MOVE:X100,200,300,400,500,600,700",
+    "GROUP:", "GROUP:X100", "GROUP:X100:Y200", "GROUP:X1200:Y300:Z-350", "GROUP:X100,200:Y50",
+    "GROUP:X100,200,300:Y100,200,300:Z5", "GROUP:X0:Y0:Z0:T0:G0", "GROUP:X1.5:Y2",
+    "GROUPSYNC:", "GROUPSYNC:X1000:Y2000:Z500", "GROUPSYNC:X100,200:Y300,400:Z500,600:T1:G0",
+    "SET:13", "WAIT", "DETECT", "DELAY:500", "DELAY:undefined", "UNKNOWN:LOOP",
+  };
+  forms.push_back("MOVE:X" + positions(40, -2000, 97));
+  forms.push_back("GROUP:X" + positions(8, 100, 10) + ":Y" + positions(8, 200, 10) + ":Z" + positions(8, -300, 10) +
+                  ":T" + positions(8, 0, 45) + ":G" + positions(8, 0, 1));
+  forms.push_back("GROUPSYNC:X" + positions(12, 1000, 250) + ":Y" + positions(12, -1000, 250) + ":Z" + positions(12, 5, 5));
+  return forms;
+}
+
+static std::string encode(const CommandRecord& record, const char* text) {
+  char uart[UART_COMMAND_SIZE];
+  size_t length = CommandCodec::toUART(record, text, "arm1", uart, sizeof(uart));
+  return std::string(uart, length);
+}
+
+static void checkForm(const std::string& command) {
+  std::string expected = legacyUART(command, "arm1");
+  CommandRecord record;
+  const char* text;
+  if (!CommandCodec::decode(command.c_str(), record, text)) {
+    fail(command, "does not decode", "");
+    return;
+  }
+  std::string direct = encode(record, text);
+  if (direct != expected) {
+    fail(command, "UART", direct + " != " + expected);
+  }
+
+  uint8_t binary[BINARY_COMMAND_SIZE];
+  size_t binaryLength = CommandCodec::toBinary(record, text, binary, sizeof(binary));
+  CommandRecord decoded;
+  const char* decodedText;
+  if (binaryLength == 0 || !CommandCodec::fromBinary(binary, binaryLength, decoded, decodedText)) {
+    fail(command, "binary round trip", std::to_string(binaryLength) + " bytes");
+    return;
+  }
+  std::string viaBinary = encode(decoded, decodedText);
+  if (viaBinary != expected) {
+    fail(command, "UART after binary", viaBinary + " != " + expected);
+  }
+}
+
+// Commands over COMMAND_TEXT_MAX are the only ones the forwarder refuses.
+static void checkLimit() {
+  std::string longest = "RAW" + std::string(COMMAND_TEXT_MAX - 3, 'x');
+  std::string tooLong = longest + "x";
+  CommandRecord record;
+  const char* text;
+  if (!CommandCodec::decode(longest.c_str(), record, text) || encode(record, text) != legacyUART(longest, "arm1")) {
+    fail("<" + std::to_string(longest.size()) + " chars>", "longest command", "");
+  }
+  if (CommandCodec::decode(tooLong.c_str(), record, text) || record.opcode != CMD_INVALID) {
+    fail("<" + std::to_string(tooLong.size()) + " chars>", "over the limit", "is not CMD_INVALID");
+  }
+}
+
+// Records a damaged cache or script image could hold, each of which the old
+// decoder accepted and toUART then sent wrongly or not at all.
+static void checkCorruptRecords() {
+  struct Corrupt {
+    const char* name;
+    std::vector<uint8_t> bytes;
+  };
+  std::vector<Corrupt> cases = {
+    { "operand count short of the groups", { CMD_GROUP, 0x22, 0x02, 0x11, 0xC8, 0x01, 0x90, 0x03 } },
+    { "operand count past the groups", { CMD_MOVE, 0x21, 0x01, 0xC8, 0x01, 0x90, 0x03 } },
+    { "groups past the operand count", { CMD_MOVE, 0x11, 0x03, 0xC8, 0x01 } },
+    { "axis past the last one", { CMD_GROUP, 0x11, 0x71, 0xC8, 0x01 } },
+    { "invalid opcode", { CMD_INVALID, 0x00 } },
+  };
+  for (int opcode = CMD_RAW + 1; opcode < 16; opcode++) {
+    cases.push_back({ "opcode past CMD_RAW", { (uint8_t)opcode, 0x00 } });
+    cases.push_back({ "text opcode past CMD_RAW", { (uint8_t)((CMD_FLAG_TEXT << 4) | opcode), 0x00, 'x' } });
+  }
+
+  for (const Corrupt& corrupt : cases) {
+    CommandRecord record;
+    const char* text;
+    if (CommandCodec::fromBinary(corrupt.bytes.data(), corrupt.bytes.size(), record, text)) {
+      fail(corrupt.name, "decodes", "opcode " + std::to_string(corrupt.bytes[0] & 0x0F));
+    }
+  }
+}
+
+// Loads random-length text through a window-sized ring in FIFO order, the way
+// dispatch does, and checks every entry reads back intact across wraps.
+static void checkWindowRing() {
+  static const size_t BUDGET = 1024;
+  static CommandText<BUDGET + COMMAND_TEXT_MAX> ring;
+  std::mt19937 random(7);
+  std::vector<std::pair<CommandRecord, std::string>> live;
+  size_t liveBytes = 0;
+  unsigned long appended = 0;
+
+  for (int step = 0; step < 200000; step++) {
+    bool load = live.empty() || random() % 2 == 0;
+    if (load) {
+      size_t length = random() % 4 == 0 ? random() % (COMMAND_TEXT_MAX + 1) : random() % 32;
+      if (liveBytes + length > BUDGET) {
+        continue;
+      }
+      std::string text;
+      for (size_t i = 0; i < length; i++) text += (char)('!' + random() % 90);
+      CommandRecord record;
+      memset(&record, 0, sizeof(record));
+      record.textLength = length;
+      if (!ring.append(record, text.data())) {
+        fail("ring", "append refused within budget", std::to_string(liveBytes) + " + " + std::to_string(length));
+        return;
+      }
+      live.push_back(std::make_pair(record, text));
+      liveBytes += length;
+      appended++;
+      continue;
+    }
+    const CommandRecord& oldest = live.front().first;
+    if (std::string(ring.at(oldest), oldest.textLength) != live.front().second) {
+      fail("ring", "text changed before release", std::to_string(appended));
+      return;
+    }
+    ring.release(oldest);
+    liveBytes -= oldest.textLength;
+    live.erase(live.begin());
+  }
+  if (ring.size() != liveBytes) {
+    fail("ring", "size", std::to_string(ring.size()) + " != " + std::to_string(liveBytes));
+  }
+}
+
+int main() {
+  std::vector<std::string> forms = generatorForms();
+  for (const std::string& command : forms) {
+    checkForm(command);
+  }
+  checkLimit();
+  checkCorruptRecords();
+  checkWindowRing();
+
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("%zu generator forms round-trip byte-exact, corrupt records refused, window ring intact\n", forms.size());
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandForwarder.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// Runs two jobs back to back with the arm idle in between, as it is while
+// the next script waits for a poll. Dispatch latency covers the time from
+// one completion to the next send within a job; the idle gap must not show
+// up in its samples, maximum or histogram.
+
+static const int GAP_COMMANDS = 20;
+static const unsigned long GAP_IDLE_MS = 1500;
+static const unsigned long GAP_DISPATCH_LIMIT_US = 100000;
+static const unsigned long GAP_TIMEOUT_MS = 20000;
+
+template <typename Done>
+static bool runUntil(CommandForwarder& forwarder, unsigned long timeoutMs, Done done) {
+  unsigned long started = millis();
+  while (millis() - started < timeoutMs) {
+    forwarder.update();
+    if (done()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  TestWorkspace workspace("job-gap-latency");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  std::vector<std::string> commands;
+  for (int i = 0; i < GAP_COMMANDS; i++) {
+    commands.push_back("MOVE:X" + std::to_string(i));
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+
+  VirtualArmConfig config;
+  config.timeScale = 0;
+  ArmRig rig;
+  rig.add(Serial1.openLoopback(), config);
+  rig.start();
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("gap", "", "127.0.0.1", server.port());
+
+  int failures = 0;
+  for (int job = 1; job <= 2; job++) {
+    server.publish(0, "gap-" + std::to_string(job), commands);
+    unsigned long expected = (unsigned long)GAP_COMMANDS * job;
+    if (!runUntil(forwarder, GAP_TIMEOUT_MS, [&] {
+          return rig.getStats(0).completed >= expected && rig.isIdle(0) && forwarder.getArmProgress(0) == 100;
+        })) {
+      fprintf(stderr, "FAIL job %d did not finish, %lu commands completed\n", job, rig.getStats(0).completed);
+      failures++;
+    }
+    runUntil(forwarder, GAP_IDLE_MS, [] { return false; });
+  }
+
+  forwarder.stopTasks();
+  rig.stop();
+  server.stop();
+
+  DispatchStats dispatch = forwarder.getArmDispatchStats(0);
+  LatencySummary histogram = forwarder.getArmLatency(0, LATENCY_DISPATCH);
+  if (dispatch.samples != 2 * (GAP_COMMANDS - 1) || histogram.count != dispatch.samples) {
+    fprintf(stderr, "FAIL %lu dispatch samples, %lu in the histogram, expected %d\n", dispatch.samples, histogram.count,
+            2 * (GAP_COMMANDS - 1));
+    failures++;
+  }
+  if (dispatch.maxLatencyUs > GAP_DISPATCH_LIMIT_US || histogram.max > GAP_DISPATCH_LIMIT_US) {
+    fprintf(stderr, "FAIL dispatch max %luus, histogram max %luus: the gap between jobs was counted\n",
+            dispatch.maxLatencyUs, histogram.max);
+    failures++;
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("two jobs %lums apart: %lu dispatch samples, max %luus\n", GAP_IDLE_MS, dispatch.samples, histogram.max);
+  return 0;
+}
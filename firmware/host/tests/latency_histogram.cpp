@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+// Feeds known distributions through LatencyHistogram and holds p50, p95 and
+// p99 to the bound its header states: within 1/8 of the exact percentile of
+// the same samples (exact below LATENCY_SUB_BUCKETS us), and max exact.
+
+static const uint32_t SATURATED_US = 1UL << (LATENCY_MAX_EXPONENT + 1);
+
+static int failures = 0;
+
+// The sample at the same rank percentile() picks.
+static unsigned long exactPercentile(const std::vector<uint32_t>& sorted, int perMille) {
+  size_t rank = ((uint64_t)sorted.size() * perMille + 999) / 1000;
+  return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+static void checkValue(const std::string& name, const char* label, unsigned long reported, unsigned long exact) {
+  unsigned long error = reported > exact ? reported - exact : exact - reported;
+  bool withinBound = exact < (unsigned long)LATENCY_SUB_BUCKETS ? error == 0 : error * 8 <= exact;
+  if (!withinBound) {
+    failures++;
+    fprintf(stderr, "FAIL %s %s reported %luus, exact %luus, off by %.1f%%\n", name.c_str(), label, reported, exact,
+            exact ? 100.0 * error / exact : 100.0);
+  }
+}
+
+static void checkDistribution(const std::string& name, const std::vector<uint32_t>& samples) {
+  LatencyHistogram histogram;
+  for (uint32_t sample : samples) {
+    histogram.record(sample);
+  }
+  std::vector<uint32_t> sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+
+  LatencySummary summary = histogram.summarize();
+  if (summary.count != samples.size()) {
+    failures++;
+    fprintf(stderr, "FAIL %s count %lu, expected %zu\n", name.c_str(), summary.count, samples.size());
+  }
+  checkValue(name, "p50", summary.p50, exactPercentile(sorted, 500));
+  checkValue(name, "p95", summary.p95, exactPercentile(sorted, 950));
+  checkValue(name, "p99", summary.p99, exactPercentile(sorted, 990));
+  if (summary.max != sorted.back()) {
+    failures++;
+    fprintf(stderr, "FAIL %s max %lu, exact %u\n", name.c_str(), summary.max, sorted.back());
+  }
+
+  // Every percentile the report could ask for, not just the summary's.
+  for (int perMille = 1; perMille <= 1000; perMille++) {
+    unsigned long exact = exactPercentile(sorted, perMille);
+    if (exact < SATURATED_US) {
+      char label[16];
+      snprintf(label, sizeof(label), "p%d.%d", perMille / 10, perMille % 10);
+      checkValue(name, label, histogram.percentile(perMille), exact);
+    }
+  }
+}
+
+template <typename Distribution>
+static std::vector<uint32_t> draw(Distribution distribution, size_t count, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::vector<uint32_t> samples;
+  for (size_t i = 0; i < count; i++) {
+    double value = distribution(random);
+    samples.push_back(value < 0 ? 0 : value >= SATURATED_US - 1 ? SATURATED_US - 1 : (uint32_t)value);
+  }
+  return samples;
+}
+
+int main() {
+  checkDistribution("constant 1000us", std::vector<uint32_t>(1000, 1000));
+  checkDistribution("sub-bucket 0..3us", draw(std::uniform_int_distribution<uint32_t>(0, 3), 10000, 1));
+  checkDistribution("uniform 0..100ms", draw(std::uniform_real_distribution<double>(0, 100000), 100000, 2));
+  checkDistribution("exponential mean 500us", draw(std::exponential_distribution<double>(1.0 / 500), 100000, 3));
+  checkDistribution("lognormal dispatch", draw(std::lognormal_distribution<double>(3.0, 1.2), 100000, 4));
+
+  // Fast sends with a 1% tail of refill stalls: p99 must land in the tail.
+  std::vector<uint32_t> bimodal = draw(std::normal_distribution<double>(40, 8), 99000, 5);
+  std::vector<uint32_t> stalls = draw(std::uniform_real_distribution<double>(15000, 25000), 1000, 6);
+  bimodal.insert(bimodal.end(), stalls.begin(), stalls.end());
+  std::shuffle(bimodal.begin(), bimodal.end(), std::mt19937(7));
+  checkDistribution("bimodal 40us + 1% 20ms", bimodal);
+
+  // Every power-of-two edge, where a bucketing mistake would show first.
+  std::vector<uint32_t> edges;
+  for (int exponent = 0; exponent <= LATENCY_MAX_EXPONENT; exponent++) {
+    for (int delta = -1; delta <= 1; delta++) {
+      edges.push_back((1UL << exponent) + delta);
+    }
+  }
+  for (uint32_t edge : edges) {
+    checkDistribution("single " + std::to_string(edge) + "us", std::vector<uint32_t>(1, edge));
+  }
+
+  // Past the last bucket the percentiles saturate; max stays exact.
+  LatencyHistogram saturated;
+  saturated.record(60000000);
+  if (saturated.summarize().max != 60000000) {
+    failures++;
+    fprintf(stderr, "FAIL saturated max %lu\n", saturated.summarize().max);
+  }
+
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("percentiles of 6 distributions and %zu bucket edges within 1/8 of exact, max exact\n", edges.size());
+  return 0;
+}
@@ -0,0 +1,40 @@
+# One short pass of every microbenchmark case. Timing is not checked, but
+# the per-message paths the dispatch loop runs must not touch the heap.
+#
+#   cmake -DMICROBENCH=<forwarder_microbench> -P microbench_smoke.cmake
+
+set(ALLOCATION_FREE command_to_uart/move command_to_uart/group command_to_uart/speed command_to_uart/long_group
+  serial_response/text arm_status/idle)
+
+execute_process(COMMAND ${MICROBENCH} --min-time 0.01 --repetitions 1 --json
+  OUTPUT_VARIABLE report RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "forwarder_microbench exited with ${status}")
+endif()
+
+string(REGEX MATCHALL "\"name\":\"[^\"]+\",\"iterations\":[0-9]+,\"nsPerOp\":[0-9.]+,\"allocsPerOp\":[0-9.]+" cases
+  "${report}")
+set(failures "")
+foreach(case IN LISTS cases)
+  string(REGEX REPLACE "^\"name\":\"([^\"]+)\",\"iterations\":([0-9]+),.*\"allocsPerOp\":([0-9.]+)$" "\\1;\\2;\\3"
+    fields "${case}")
+  list(GET fields 0 name)
+  list(GET fields 1 iterations)
+  list(GET fields 2 allocations)
+  if(iterations EQUAL 0)
+    string(APPEND failures "${name} did not run\n")
+  endif()
+  list(FIND ALLOCATION_FREE ${name} index)
+  if(index GREATER -1 AND NOT allocations STREQUAL "0.000")
+    string(APPEND failures "${name} allocates ${allocations} per op\n")
+  endif()
+  list(REMOVE_ITEM ALLOCATION_FREE ${name})
+endforeach()
+if(ALLOCATION_FREE)
+  string(APPEND failures "missing cases: ${ALLOCATION_FREE}\n")
+endif()
+if(failures)
+  message(FATAL_ERROR "${failures}")
+endif()
+list(LENGTH cases count)
+message("${count} cases ran; the dispatch paths allocate nothing")
@@ -0,0 +1,79 @@
+#include <string>
+
+#include "ForwarderProbe.h"
+#include "test_support.h"
+
+// Fills the page queue and the held slots behind it, then fetches one page
+// more. The dropped page must rewind the feed so the next refill asks for it
+// again, instead of leaving a gap that no later page can fill.
+
+static const int FULL_COMMANDS = 200;
+
+static std::string commandList(int offset) {
+  std::string list = "[";
+  for (int i = offset; i < offset + SCRIPT_PAGE_SIZE; i++) {
+    list += (i > offset ? ",\"MOVE:X" : "\"MOVE:X") + std::to_string(i) + "\"";
+  }
+  return list + "]";
+}
+
+static bool readChunk(ForwarderProbe& probe, int offset) {
+  std::string body = "{\"scriptId\":\"queue-full\",\"offset\":" + std::to_string(offset) +
+                     ",\"commands\":" + commandList(offset) + "}";
+  probe.consumeStaged(0);
+  return probe.readChunkJson(0, body.c_str(), body.size());
+}
+
+int main() {
+  TestWorkspace workspace("page-queue-full");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("queue", "", "127.0.0.1", 1);
+  ForwarderProbe probe(forwarder);
+
+  std::string poll = "{\"shouldStart\":false,\"arm1\":{\"hasNewScript\":true,\"scriptId\":\"queue-full\","
+                     "\"format\":\"msl\",\"totalCommands\":" + std::to_string(FULL_COMMANDS) +
+                     ",\"commands\":" + commandList(0) + "}}";
+  if (!probe.readPollJson(poll.c_str(), poll.size())) {
+    fprintf(stderr, "FAIL poll was not read\n");
+    return 1;
+  }
+
+  // The poll's page plus these fill the queue and both held slots.
+  int queued = 1;
+  while (queued < PAGE_QUEUE_SIZE + ARM_COUNT) {
+    if (!readChunk(probe, probe.stagedFetched(0))) {
+      fprintf(stderr, "FAIL chunk %d was refused\n", queued);
+      return 1;
+    }
+    queued++;
+  }
+
+  int failures = 0;
+  int dropped = probe.stagedFetched(0);
+  readChunk(probe, dropped);
+  if (probe.stagedFetched(0) != dropped) {
+    fprintf(stderr, "FAIL feed at %d after dropping the page at %d\n", probe.stagedFetched(0), dropped);
+    failures++;
+  }
+
+  probe.dispatchStep();
+  if (!probe.releaseHeldPages()) {
+    fprintf(stderr, "FAIL held pages not released once dispatch made room\n");
+    failures++;
+  }
+  if (!readChunk(probe, dropped) || probe.stagedFetched(0) != dropped + SCRIPT_PAGE_SIZE) {
+    fprintf(stderr, "FAIL page at %d not fetched again, feed at %d\n", dropped, probe.stagedFetched(0));
+    failures++;
+  }
+  probe.drainLog(LOG_RING_SIZE);
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("page at offset %d dropped on a full queue and fetched again\n", dropped);
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandForwarder.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// Runs a script while every refill is held back by the server. A refill is
+// asked for with half the window still buffered, which covers the delay, so
+// the arm must never wait on the network: the time from one completion to
+// the next send stays at its usual few microseconds, not the refill delay.
+// The delay can be given as the first argument to see where that stops
+// holding.
+
+static const int STALL_COMMANDS = 400;
+static const unsigned long STALL_CHUNK_DELAY_MS = 40;
+static const float STALL_TIME_SCALE = 0.25f;
+static const unsigned long DISPATCH_P99_LIMIT_US = 5000;
+static const unsigned long STALL_TIMEOUT_MS = 60000;
+
+int main(int argc, char** argv) {
+  TestWorkspace workspace("refill-stall");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+  unsigned long delayMs = argc > 1 ? strtoul(argv[1], nullptr, 10) : STALL_CHUNK_DELAY_MS;
+
+  std::vector<std::string> commands;
+  for (int i = 0; i < STALL_COMMANDS; i++) {
+    commands.push_back("MOVE:X" + std::to_string(i));
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+  server.setChunkFaults(delayMs, 0);
+
+  // One-step moves take about 5ms each at this scale, so the half window
+  // left when a refill goes out lasts about twice the delay.
+  VirtualArmConfig config;
+  config.timeScale = STALL_TIME_SCALE;
+  ArmRig rig;
+  rig.add(Serial1.openLoopback(), config);
+  rig.start();
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("stall", "", "127.0.0.1", server.port());
+  server.publish(0, "refill-stall", commands);
+
+  unsigned long started = millis();
+  bool done = false;
+  while (!done && millis() - started < STALL_TIMEOUT_MS) {
+    forwarder.update();
+    done = rig.getStats(0).completed >= (unsigned long)STALL_COMMANDS && rig.isIdle(0) &&
+           forwarder.getArmProgress(0) == 100;
+  }
+
+  forwarder.stopTasks();
+  rig.stop();
+  server.stop();
+
+  VirtualArmStats stats = rig.getStats(0);
+  ScriptServerStats served = server.getStats();
+  LatencySummary dispatch = forwarder.getArmLatency(0, LATENCY_DISPATCH);
+  int failures = 0;
+  if (!done) {
+    fprintf(stderr, "FAIL timed out with %lu of %d commands completed\n", stats.completed, STALL_COMMANDS);
+    failures++;
+  }
+  if (served.delayed < (unsigned long)STALL_COMMANDS / SCRIPT_PAGE_SIZE - 1) {
+    fprintf(stderr, "FAIL only %lu refills were delayed\n", served.delayed);
+    failures++;
+  }
+  if (dispatch.p99 > DISPATCH_P99_LIMIT_US) {
+    fprintf(stderr, "FAIL dispatch p99 %luus (max %luus) over %luus with refills delayed %lums\n", dispatch.p99,
+            dispatch.max, DISPATCH_P99_LIMIT_US, delayMs);
+    failures++;
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("%d commands with every refill delayed %lums: dispatch p50 %luus, p99 %luus, max %luus\n", STALL_COMMANDS,
+         delayMs, dispatch.p50, dispatch.p99, dispatch.max);
+  return 0;
+}
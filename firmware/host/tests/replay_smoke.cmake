@@ -0,0 +1,22 @@
+# Replays the trace forwarder_bench_text recorded, twice. Apart from the wall
+# time the two reports must be identical, and every UART message the
+# forwarder sends must match the recording.
+#
+#   cmake -DREPLAY=<forwarder_replay> -DTRACE=<trace> -P replay_smoke.cmake
+
+foreach(run 1 2)
+  execute_process(COMMAND ${REPLAY} --trace ${TRACE} --json
+    OUTPUT_VARIABLE report RESULT_VARIABLE status)
+  if(NOT status EQUAL 0)
+    message(FATAL_ERROR "forwarder_replay exited with ${status}")
+  endif()
+  string(REGEX REPLACE "\"wallSeconds\":[0-9.]+," "" report${run} "${report}")
+endforeach()
+
+if(NOT report1 STREQUAL report2)
+  message(FATAL_ERROR "replays differ:\n${report1}\n${report2}")
+endif()
+if(NOT report1 MATCHES "\"txMessages\":[1-9]" OR report1 MATCHES "\"txMismatches\":[1-9]")
+  message(FATAL_ERROR "replay does not match the recording:\n${report1}")
+endif()
+message("${report1}")
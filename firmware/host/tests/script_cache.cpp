@@ -0,0 +1,189 @@
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "CommandCodec.h"
+#include "ScriptCache.h"
+#include "test_support.h"
+
+// The flash cache against a scratch directory: a committed slot reads back
+// record for record, a slot whose write never finished or whose records were
+// damaged does not load, on its own or after being promoted over the active
+// slot, and a completion mark only ever vouches for the script it was
+// written for.
+
+static const char* const CACHE_ROOT = "scripts";
+static const int SCRIPT_COMMANDS = 100;
+static const int WRITE_BATCH = 16;
+
+struct Script {
+  std::string id;
+  std::vector<CommandRecord> records;
+  std::string text;
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+  if (!condition) {
+    failures++;
+    fprintf(stderr, "FAIL %s\n", what);
+  }
+}
+
+static Script makeScript(const char* id, int count, int salt) {
+  Script script;
+  script.id = id;
+  for (int i = 0; i < count; i++) {
+    std::string command = i % 7 == 6 ? "NOTE:" + std::string(20 + i % 30, 'a' + (i + salt) % 26)
+                                     : "MOVE:X" + std::to_string(i * salt);
+    CommandRecord record;
+    const char* source;
+    CommandCodec::decode(command.c_str(), record, source);
+    record.textOffset = script.text.size();
+    script.text.append(source, record.textLength);
+    script.records.push_back(record);
+  }
+  return script;
+}
+
+static bool writeScript(ScriptCache& cache, const char* slot, const Script& script, bool commit) {
+  static ScriptCacheCursor cursor;
+  if (!cache.beginWrite(slot, script.id.c_str(), "msl", script.records.size(), cursor)) {
+    return false;
+  }
+  for (size_t i = 0; i < script.records.size(); i += WRITE_BATCH) {
+    int count = script.records.size() - i < (size_t)WRITE_BATCH ? script.records.size() - i : WRITE_BATCH;
+    if (!cache.append(slot, cursor, script.records.data() + i, count, script.text.data())) {
+      return false;
+    }
+  }
+  return commit ? cache.commit(slot, cursor) : cache.flush(slot, cursor);
+}
+
+static bool readsBack(ScriptCache& cache, const char* slot, const Script& script) {
+  static ScriptCacheCursor cursor;
+  if (!cache.open(slot, script.id.c_str(), script.records.size(), cursor)) {
+    return false;
+  }
+  for (size_t i = 0; i < script.records.size();) {
+    CommandRecord records[WRITE_BATCH];
+    char text[WRITE_BATCH * COMMAND_TEXT_MAX];
+    size_t textLength = 0;
+    int count = cache.readRecords(slot, cursor, records, WRITE_BATCH, text, sizeof(text), textLength);
+    if (count <= 0) {
+      return false;
+    }
+    for (int k = 0; k < count; k++, i++) {
+      const CommandRecord& expected = script.records[i];
+      const CommandRecord& actual = records[k];
+      if (actual.opcode != expected.opcode || actual.operandCount != expected.operandCount ||
+          memcmp(actual.operands, expected.operands, sizeof(actual.operands)) != 0 ||
+          actual.textLength != expected.textLength ||
+          memcmp(text + actual.textOffset, script.text.data() + expected.textOffset, expected.textLength) != 0) {
+        fprintf(stderr, "record %zu of %s differs\n", i, script.id.c_str());
+        return false;
+      }
+    }
+  }
+  cache.close(cursor);
+  return true;
+}
+
+static std::string slotFile(const char* slot, const char* extension) {
+  return std::string(CACHE_ROOT) + "/" + slot + "." + extension;
+}
+
+static void flipByte(const std::string& path, long offset) {
+  FILE* file = fopen(path.c_str(), "r+b");
+  if (!file) {
+    return;
+  }
+  fseek(file, offset, SEEK_SET);
+  int value = fgetc(file);
+  fseek(file, offset, SEEK_SET);
+  fputc(value ^ 0x5a, file);
+  fclose(file);
+}
+
+static bool loads(ScriptCache& cache, const char* slot, const char* id) {
+  ScriptCacheHeader header;
+  return cache.load(slot, header) && strcmp(header.scriptId, id) == 0;
+}
+
+int main() {
+  TestWorkspace workspace("script-cache");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+  ScriptCache cache;
+  if (!cache.begin(CACHE_ROOT)) {
+    fprintf(stderr, "cannot mount the cache under %s\n", workspace.getPath());
+    return 1;
+  }
+
+  Script first = makeScript("job-a", SCRIPT_COMMANDS, 3);
+  Script second = makeScript("job-b", SCRIPT_COMMANDS, 5);
+  Script third = makeScript("job-c", SCRIPT_COMMANDS / 2, 7);
+
+  // Write, then verify record for record.
+  check(writeScript(cache, "arm1", first, true), "committing job-a");
+  check(loads(cache, "arm1", "job-a"), "committed slot does not load");
+  check(readsBack(cache, "arm1", first), "committed slot does not read back");
+
+  // Damaged records: the hash no longer matches, or the length is short.
+  std::filesystem::copy_file(slotFile("arm1", "rec"), "arm1.rec.good");
+  flipByte(slotFile("arm1", "rec"), SCRIPT_COMMANDS);
+  check(!loads(cache, "arm1", "job-a"), "slot with a flipped byte loads");
+  std::filesystem::copy_file("arm1.rec.good", slotFile("arm1", "rec"), std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::resize_file(slotFile("arm1", "rec"), std::filesystem::file_size("arm1.rec.good") - 1);
+  check(!loads(cache, "arm1", "job-a"), "truncated slot loads");
+  std::filesystem::copy_file("arm1.rec.good", slotFile("arm1", "rec"), std::filesystem::copy_options::overwrite_existing);
+  check(loads(cache, "arm1", "job-a"), "restored slot does not load");
+
+  // A -next slot that was still being written has no header: it does not
+  // load, and promoting it leaves no valid script behind it.
+  check(writeScript(cache, "arm1-next", second, false), "writing job-b");
+  check(!loads(cache, "arm1-next", "job-b"), "uncommitted -next slot loads");
+  check(cache.promote("arm1-next", "arm1"), "promoting an uncommitted slot");
+  check(!loads(cache, "arm1", "job-b") && !loads(cache, "arm1", "job-a"), "torn promotion left a loadable slot");
+
+  // A committed -next slot torn afterwards fails its hash once promoted.
+  check(writeScript(cache, "arm1-next", second, true), "committing job-b");
+  std::filesystem::resize_file(slotFile("arm1-next", "rec"), std::filesystem::file_size(slotFile("arm1-next", "rec")) / 2);
+  check(cache.promote("arm1-next", "arm1"), "promoting a torn slot");
+  check(!loads(cache, "arm1", "job-b"), "torn -next slot loads after promotion");
+
+  // A whole -next slot replaces the active one and reads back.
+  check(writeScript(cache, "arm1-next", second, true), "committing job-b again");
+  check(cache.promote("arm1-next", "arm1"), "promoting job-b");
+  check(loads(cache, "arm1", "job-b") && readsBack(cache, "arm1", second), "promoted slot does not read back");
+  check(!std::filesystem::exists(slotFile("arm1-next", "hdr")) && !std::filesystem::exists(slotFile("arm1-next", "rec")),
+        "promotion left the -next files behind");
+
+  // Completion marks belong to one script.
+  ScriptCacheHeader header;
+  cache.load("arm1", header);
+  check(!cache.isComplete("arm1", header), "fresh slot counts as complete");
+  check(cache.markComplete("arm1") && cache.isComplete("arm1", header), "marked slot does not count as complete");
+  std::filesystem::copy_file(slotFile("arm1", "end"), "arm1.end.old");
+
+  check(writeScript(cache, "arm1-next", third, true) && cache.promote("arm1-next", "arm1"), "promoting job-c");
+  cache.load("arm1", header);
+  check(!cache.isComplete("arm1", header), "promoted script inherits the completion mark");
+  std::filesystem::copy_file("arm1.end.old", slotFile("arm1", "end"));
+  check(!cache.isComplete("arm1", header), "another script's mark counts");
+
+  check(cache.markComplete("arm1") && writeScript(cache, "arm1", first, true), "rewriting the active slot");
+  cache.load("arm1", header);
+  check(!cache.isComplete("arm1", header), "rewritten slot keeps the completion mark");
+  check(!cache.markComplete("arm1-next"), "marked a slot with no script");
+
+  if (failures > 0) {
+    return 1;
+  }
+  ScriptCacheStats stats = cache.getStats();
+  printf("cache slots written, verified, torn and promoted: %lu commits, %lu failures, %lu bytes written\n",
+         stats.commits, stats.failures, stats.bytesWritten);
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandForwarder.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// A script whose remaining pages the server no longer has (a 409 after a
+// server restart) must halt the arm loudly: the arm shows the error, an error
+// record reaches the server, and nothing more is sent to the arm.
+
+static const int REFILL_COMMANDS = 2000;
+static const unsigned long REFILL_COMPLETED_BEFORE_WITHDRAW = 64;
+static const unsigned long REFILL_TIMEOUT_MS = 20000;
+static const unsigned long REFILL_SETTLE_MS = 1000;
+
+struct Run {
+  CommandForwarder* forwarder;
+  ScriptServer* server;
+  std::string telemetry;
+};
+
+static int failures = 0;
+
+static void fail(const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s %s\n", what, detail.c_str());
+}
+
+// Steps the forwarder until done() holds or the timeout runs out.
+template <typename Done>
+static bool runUntil(Run& run, unsigned long timeoutMs, Done done) {
+  unsigned long started = millis();
+  while (millis() - started < timeoutMs) {
+    run.forwarder->update();
+    for (const std::string& batch : run.server->takeTelemetry()) {
+      run.telemetry += batch;
+    }
+    if (done()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  TestWorkspace workspace("script-refill-failure");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  std::vector<std::string> commands;
+  for (int i = 0; i < REFILL_COMMANDS; i++) {
+    commands.push_back("MOVE:X" + std::to_string(i));
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+  server.setKeepTelemetry(true);
+
+  VirtualArmConfig config;
+  config.timeScale = 0;
+  ArmRig rig;
+  rig.add(Serial1.openLoopback(), config);
+  rig.start();
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("refill", "", "127.0.0.1", server.port());
+  server.publish(0, "refill-409", commands);
+  Run run = { &forwarder, &server, "" };
+
+  if (!runUntil(run, REFILL_TIMEOUT_MS, [&] { return rig.getStats(0).completed >= REFILL_COMPLETED_BEFORE_WITHDRAW; })) {
+    fail("script did not start", std::to_string(rig.getStats(0).completed) + " commands completed");
+  }
+  server.withdraw(0);
+
+  bool halted = runUntil(run, REFILL_TIMEOUT_MS, [&] {
+    return !forwarder.isArmActive(0) && run.telemetry.find("Script gone from server") != std::string::npos;
+  });
+  String status = forwarder.getArmStatus(0);
+  if (!halted) {
+    fail("arm was not halted", std::string("status \"") + status.c_str() + "\"");
+  }
+  if (!status.startsWith("ERROR: Script gone from server")) {
+    fail("arm status", status.c_str());
+  }
+  if (run.telemetry.find("\"kind\":\"error\"") == std::string::npos) {
+    fail("no error record reached the server", "");
+  }
+
+  // Whatever was in flight completes; nothing after it goes out.
+  unsigned long received = rig.getStats(0).received;
+  runUntil(run, REFILL_SETTLE_MS, [] { return false; });
+  VirtualArmStats stats = rig.getStats(0);
+  if (stats.received != received || stats.completed != stats.received || stats.received >= (unsigned long)REFILL_COMMANDS) {
+    fail("arm kept running", std::to_string(stats.received) + " received, " + std::to_string(stats.completed) + " completed");
+  }
+
+  forwarder.stopTasks();
+  rig.stop();
+  server.stop();
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("arm halted after %lu of %d commands when the server lost the script: %s\n", stats.completed, REFILL_COMMANDS,
+         status.c_str());
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <string>
+
+#include "ForwarderProbe.h"
+#include "test_support.h"
+
+// Loads 100k scripts into both arms through the poll path, each one staged,
+// promoted and replaced by the next, and checks that neither the process heap
+// nor the per-arm arenas grow once the first thousand have been through.
+
+static const int SOAK_SCRIPTS = 100000;
+static const int SOAK_WARMUP = 1000;
+static const size_t HEAP_DRIFT_LIMIT = 4096;
+
+// Ids, formats and commands vary in length from one script to the next, and
+// the longest of each shows up within the warm-up.
+static void buildPoll(std::string& body, int script) {
+  static const char* const FORMATS[] = { "msl", "gcode", "palletizer-v2" };
+  body = "{\"shouldStart\":false";
+  for (int arm = 0; arm < ARM_COUNT; arm++) {
+    char scriptId[SCRIPT_ID_SIZE];
+    snprintf(scriptId, sizeof(scriptId), "%.*s%07d", (script + arm) % 17, "reload-soak-arm-x", script);
+    body += ",\"arm" + std::to_string(arm + 1) + "\":{\"hasNewScript\":true,\"scriptId\":\"" + scriptId +
+            "\",\"format\":\"" + FORMATS[(script + arm) % 3] + "\",\"totalCommands\":" + std::to_string(SCRIPT_PAGE_SIZE) +
+            ",\"commands\":[";
+    for (int i = 0; i < SCRIPT_PAGE_SIZE; i++) {
+      int value = (script * 31 + i * 7) % 4000 - 2000;
+      body += i ? "," : "";
+      body += (i + script) % 3 ? "\"MOVE:X" + std::to_string(value) + "\""
+                               : "\"GROUP:X" + std::to_string(value) + ":Y" + std::to_string(-value) + ":Z100\"";
+    }
+    body += "]}";
+  }
+  body += "}";
+}
+
+int main() {
+  TestWorkspace workspace("script-reload-soak");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("soak", "", "127.0.0.1", 1);
+  ForwarderProbe probe(forwarder);
+
+  std::string body;
+  body.reserve(4096);
+  long long baseline = 0;
+  long long peak = 0;
+  ArenaStats warm[ARM_COUNT];
+  int failures = 0;
+
+  for (int script = 1; script <= SOAK_SCRIPTS; script++) {
+    buildPoll(body, script);
+    if (!probe.readPollJson(body.c_str(), body.size())) {
+      fprintf(stderr, "FAIL poll %d was not read\n", script);
+      failures++;
+      break;
+    }
+    probe.dispatchStep();
+    probe.receiveTelemetry();
+    probe.drainLog(LOG_RING_SIZE);
+
+    if (script == SOAK_WARMUP) {
+      baseline = testLiveBytes();
+      for (int arm = 0; arm < ARM_COUNT; arm++) {
+        warm[arm] = forwarder.getArmArenaStats(arm);
+      }
+    } else if (script > SOAK_WARMUP && testLiveBytes() > peak) {
+      peak = testLiveBytes();
+    }
+  }
+
+  if (peak - baseline > (long long)HEAP_DRIFT_LIMIT) {
+    fprintf(stderr, "FAIL live heap grew by %lld bytes after %d scripts\n", peak - baseline, SOAK_WARMUP);
+    failures++;
+  }
+  for (int arm = 0; arm < ARM_COUNT; arm++) {
+    ArenaStats stats = forwarder.getArmArenaStats(arm);
+    SwapStats swaps = forwarder.getArmSwapStats(arm);
+    if (swaps.promotions != (unsigned long)SOAK_SCRIPTS) {
+      fprintf(stderr, "FAIL arm%d promoted %lu of %d scripts\n", arm + 1, swaps.promotions, SOAK_SCRIPTS);
+      failures++;
+    }
+    if (stats.highWater != warm[arm].highWater || stats.failedAllocations != 0) {
+      fprintf(stderr, "FAIL arm%d arena high water %zu after warm-up, %zu at the end, %lu failed allocations\n", arm + 1,
+              warm[arm].highWater, stats.highWater, stats.failedAllocations);
+      failures++;
+    }
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  ArenaStats arena = forwarder.getArmArenaStats(0);
+  printf("%d scripts reloaded per arm, live heap within %lld bytes, arena high water %zu of %zu bytes\n", SOAK_SCRIPTS,
+         peak - baseline, arena.highWater, arena.capacity);
+  return 0;
+}
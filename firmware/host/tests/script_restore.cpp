@@ -0,0 +1,137 @@
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandCodec.h"
+#include "CommandForwarder.h"
+#include "ScriptCache.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// Boots the forwarder over a cache slot left by a script that was cut short
+// by a reset. The server still says start, as it did before the reset, but
+// nothing may reach the arm until the server has said stop and then start
+// again; the script then runs from its first command and is marked complete
+// on flash. With "completed" as the argument the slot is marked complete
+// before boot, and is never restored at all.
+
+static const int RESTORE_COMMANDS = 40;
+static const unsigned long RESTORE_HOLD_MS = 2 * POLL_INTERVAL_MS + 500;
+static const unsigned long RESTORE_TIMEOUT_MS = 20000;
+
+static int failures = 0;
+
+static void fail(const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s %s\n", what, detail.c_str());
+}
+
+template <typename Done>
+static bool runUntil(CommandForwarder& forwarder, unsigned long timeoutMs, Done done) {
+  unsigned long started = millis();
+  while (millis() - started < timeoutMs) {
+    forwarder.update();
+    if (done()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The slot a power cut leaves behind: the whole script committed, no mark.
+static bool writeSlot(ScriptCache& cache) {
+  static ScriptCacheCursor cursor;
+  if (!cache.beginWrite("arm1", "restored-job", "msl", RESTORE_COMMANDS, cursor)) {
+    return false;
+  }
+  for (int i = 0; i < RESTORE_COMMANDS; i++) {
+    std::string command = "MOVE:X" + std::to_string(i);
+    CommandRecord record;
+    const char* text;
+    CommandCodec::decode(command.c_str(), record, text);
+    if (!cache.append("arm1", cursor, &record, 1, text)) {
+      return false;
+    }
+  }
+  return cache.commit("arm1", cursor);
+}
+
+static bool isMarkedComplete(ScriptCache& cache) {
+  ScriptCacheHeader header;
+  return cache.load("arm1", header) && cache.isComplete("arm1", header);
+}
+
+int main(int argc, char** argv) {
+  TestWorkspace workspace("script-restore");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+  bool completed = argc > 1 && strcmp(argv[1], "completed") == 0;
+
+  ScriptCache cache;
+  if (!cache.begin(SCRIPT_CACHE_ROOT) || !writeSlot(cache) || (completed && !cache.markComplete("arm1"))) {
+    fprintf(stderr, "cannot prepare the cache slot\n");
+    return 1;
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+  server.setShouldStart(true);
+
+  VirtualArmConfig config;
+  config.timeScale = 0;
+  ArmRig rig;
+  rig.add(Serial1.openLoopback(), config);
+  rig.start();
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("restore", "", "127.0.0.1", server.port());
+
+  runUntil(forwarder, RESTORE_HOLD_MS, [] { return false; });
+  String status = forwarder.getArmStatus(0);
+  if (rig.getStats(0).received != 0) {
+    fail("restored script ran without a new start", std::to_string(rig.getStats(0).received) + " commands sent");
+  }
+  if (completed == (status == "AWAITING START")) {
+    fail("arm status after boot", status.c_str());
+  }
+
+  server.setShouldStart(false);
+  runUntil(forwarder, RESTORE_HOLD_MS, [] { return false; });
+  server.setShouldStart(true);
+  bool done = runUntil(forwarder, completed ? RESTORE_HOLD_MS : RESTORE_TIMEOUT_MS, [&] {
+    return rig.getStats(0).completed >= (unsigned long)RESTORE_COMMANDS && rig.isIdle(0) && isMarkedComplete(cache);
+  });
+
+  forwarder.stopTasks();
+  rig.stop();
+  server.stop();
+
+  VirtualArmStats stats = rig.getStats(0);
+  if (completed) {
+    if (stats.received != 0) {
+      fail("completed script was restored", std::to_string(stats.received) + " commands sent");
+    }
+  } else {
+    if (!done || stats.received != (unsigned long)RESTORE_COMMANDS || rig.getPosition(0, 0) != RESTORE_COMMANDS - 1) {
+      fail("restored script did not run once from its start",
+           std::to_string(stats.received) + " commands sent, arm at X" + std::to_string(rig.getPosition(0, 0)));
+    }
+    if (!isMarkedComplete(cache)) {
+      fail("finished script not marked complete", "");
+    }
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  if (completed) {
+    printf("completed script left on flash was not restored\n");
+  } else {
+    printf("restored script waited for a new start, then ran %lu commands and was marked complete\n", stats.received);
+  }
+  return 0;
+}
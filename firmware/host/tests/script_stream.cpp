@@ -0,0 +1,113 @@
+#include <string>
+#include <vector>
+
+#include "ArmRig.h"
+#include "CommandForwarder.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// Streams a 100k-command script through the real forwarder to a virtual arm
+// on a loopback. Every command must arrive once and in order (each one moves
+// X one step further), and the heap must not grow with the script once it is
+// running, since only the window and the staged pages are ever resident.
+
+static const int STREAM_COMMANDS = 100000;
+static const unsigned long STREAM_TIMEOUT_MS = 300000;
+static const size_t HEAP_GROWTH_LIMIT = 64 * 1024;
+
+int main() {
+  TestWorkspace workspace("script-stream");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  std::vector<std::string> commands;
+  commands.reserve(STREAM_COMMANDS);
+  for (int i = 0; i < STREAM_COMMANDS; i++) {
+    commands.push_back("MOVE:X" + std::to_string(i));
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+
+  VirtualArmConfig config;
+  config.timeScale = 0;
+  config.advertiseCredits = true;
+  ArmRig rig;
+  rig.add(Serial1.openLoopback(), config);
+  rig.start();
+
+  static CommandForwarder forwarder;
+  forwarder.setPipelineDepth(4);
+  forwarder.initialize("stream", "", "127.0.0.1", server.port());
+  server.publish(0, "stream-100k", commands);
+
+  // Sampled once a tenth of the script is through, when the cache, the
+  // window and the server's sockets are all at their working size.
+  long long baseline = -1;
+  long long peak = 0;
+  int32_t lastPosition = 0;
+  bool reordered = false;
+  unsigned long started = millis();
+  bool done = false;
+  while (!done && millis() - started < STREAM_TIMEOUT_MS) {
+    forwarder.update();
+    VirtualArmStats stats = rig.getStats(0);
+    int32_t position = rig.getPosition(0, 0);
+    reordered |= position < lastPosition;
+    lastPosition = position;
+    if (baseline < 0 && stats.completed >= STREAM_COMMANDS / 10) {
+      baseline = testLiveBytes();
+    }
+    if (baseline >= 0 && testLiveBytes() > peak) {
+      peak = testLiveBytes();
+    }
+    done = stats.completed >= (unsigned long)STREAM_COMMANDS && rig.isIdle(0) && forwarder.getArmProgress(0) == 100;
+  }
+  unsigned long elapsed = millis() - started;
+
+  forwarder.stopTasks();
+  rig.stop();
+  server.stop();
+
+  VirtualArmStats stats = rig.getStats(0);
+  ResponseStats responses = forwarder.getArmResponseStats(0);
+  int failures = 0;
+  if (!done) {
+    fprintf(stderr, "FAIL timed out after %lums with %lu of %d commands completed\n", elapsed, stats.completed,
+            STREAM_COMMANDS);
+    failures++;
+  }
+  if (stats.received != (unsigned long)STREAM_COMMANDS || stats.completed != (unsigned long)STREAM_COMMANDS) {
+    fprintf(stderr, "FAIL arm received %lu and completed %lu, expected %d\n", stats.received, stats.completed,
+            STREAM_COMMANDS);
+    failures++;
+  }
+  if (stats.errors || stats.malformed || stats.dropped) {
+    fprintf(stderr, "FAIL %lu errors, %lu malformed, %lu dropped\n", stats.errors, stats.malformed, stats.dropped);
+    failures++;
+  }
+  if (reordered || lastPosition != STREAM_COMMANDS - 1) {
+    fprintf(stderr, "FAIL arm ended at X%d%s\n", lastPosition, reordered ? " after moving backwards" : "");
+    failures++;
+  }
+  if (responses.error || responses.stray) {
+    fprintf(stderr, "FAIL forwarder saw %lu error and %lu stray responses\n", responses.error, responses.stray);
+    failures++;
+  }
+  if (baseline >= 0 && peak - baseline > (long long)HEAP_GROWTH_LIMIT) {
+    fprintf(stderr, "FAIL live heap grew by %lld bytes after the first %d commands\n", peak - baseline,
+            STREAM_COMMANDS / 10);
+    failures++;
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("%d commands streamed in order in %lums, live heap within %lld bytes of its working size\n", STREAM_COMMANDS,
+         elapsed, peak - baseline);
+  return 0;
+}
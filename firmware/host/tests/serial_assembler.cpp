@@ -0,0 +1,240 @@
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SerialBridge.h"
+#include "test_support.h"
+
+// Feeds two SerialBridges, one on text lines and one on binary frames, with
+// their replies cut into random fragments and interleaved across the ports.
+// Every message must come out whole and in order, a read must return at once
+// whether or not a message is complete, and no read may touch the heap.
+
+static const int ASSEMBLER_MESSAGES = 20000;
+static const int ASSEMBLER_MAX_FRAGMENT = 23;
+static const unsigned long ASSEMBLER_READ_LIMIT_US = 20000;
+
+struct Expected {
+  uint8_t type;
+  bool hasSequence;
+  uint16_t sequence;
+  int credits;
+  std::string text;
+};
+
+struct Port {
+  const char* name;
+  HardwareSerial* serial;
+  SerialBridge* bridge;
+  int peer;
+  std::string wire;
+  size_t written;
+  std::vector<Expected> expected;
+  size_t received;
+};
+
+static int failures = 0;
+
+static void fail(const Port& port, const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s: %s %s\n", port.name, what, detail.c_str());
+}
+
+static void addLine(Port& port, std::mt19937& random, uint16_t sequence) {
+  Expected message = { RESPONSE_INFO, false, 0, -1, "" };
+  switch (random() % 5) {
+    case 0:
+      message = { RESPONSE_OK, true, sequence, -1, "OK#" + std::to_string(sequence) };
+      break;
+    case 1:
+      message = { RESPONSE_DONE, true, sequence, (int)(random() % 8), "" };
+      message.text = "DONE#" + std::to_string(sequence) + "/" + std::to_string(message.credits);
+      break;
+    case 2:
+      message = { RESPONSE_ERROR, true, sequence, 0, "ERROR:QUEUE FULL#" + std::to_string(sequence) + "/0" };
+      break;
+    case 3:
+      message.text = "INFO:POS X" + std::to_string(sequence);
+      break;
+    default:
+      message = { RESPONSE_DONE, false, 0, -1, "DONE" };
+      break;
+  }
+  port.wire += message.text + (random() % 2 ? "\r\n" : "\n");
+  port.expected.push_back(message);
+}
+
+static void addFrame(Port& port, std::mt19937& random, uint16_t sequence) {
+  uint8_t encoded[FRAME_MAX_ENCODED];
+  size_t length;
+  Expected message = { RESPONSE_DONE, true, sequence, -1, "" };
+  switch (random() % 4) {
+    case 0: {
+      uint8_t credits = random() % 8;
+      length = SerialFrame::encode(FRAME_OK, sequence, &credits, 1, encoded, sizeof(encoded));
+      message.type = RESPONSE_OK;
+      message.credits = credits;
+      message.text = "OK#" + std::to_string(sequence) + "/" + std::to_string(credits);
+      break;
+    }
+    case 1:
+      length = SerialFrame::encode(FRAME_DONE, sequence, nullptr, 0, encoded, sizeof(encoded));
+      message.text = "DONE#" + std::to_string(sequence);
+      break;
+    case 2: {
+      static const char TEXT[] = "LIMIT Z";
+      length = SerialFrame::encode(FRAME_ERROR, sequence, (const uint8_t*)TEXT, sizeof(TEXT) - 1, encoded, sizeof(encoded));
+      message.type = RESPONSE_ERROR;
+      message.text = TEXT;
+      break;
+    }
+    default: {
+      // Long enough to span several COBS code blocks once the sequence has a
+      // zero byte.
+      uint8_t payload[40];
+      for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = 'a' + (sequence + i) % 26;
+      }
+      length = SerialFrame::encode(FRAME_INFO, sequence, payload, sizeof(payload), encoded, sizeof(encoded));
+      message.type = RESPONSE_INFO;
+      message.text = std::string((const char*)payload, sizeof(payload));
+      break;
+    }
+  }
+  port.wire.append((const char*)encoded, length);
+  port.expected.push_back(message);
+}
+
+// An overlong line and a corrupt frame must each be dropped on their own,
+// without taking the next message with them.
+static void addGarbage(Port& port, bool binary) {
+  if (binary) {
+    uint8_t encoded[FRAME_MAX_ENCODED];
+    size_t length = SerialFrame::encode(FRAME_DONE, 1, nullptr, 0, encoded, sizeof(encoded));
+    encoded[1] ^= 0x40;
+    port.wire.append((const char*)encoded, length);
+  } else {
+    port.wire += std::string(SERIAL_LINE_SIZE * 2, 'x') + "\n";
+  }
+}
+
+static void drain(Port& port) {
+  SerialResponse response;
+  while (true) {
+    unsigned long before = testAllocations();
+    unsigned long started = micros();
+    bool got = port.bridge->readResponse(response);
+    unsigned long elapsed = micros() - started;
+    unsigned long allocated = testAllocations() - before;
+    if (allocated > 0) {
+      fail(port, "read allocated", std::to_string(allocated) + " blocks");
+    }
+    if (elapsed > ASSEMBLER_READ_LIMIT_US) {
+      fail(port, "read blocked for", std::to_string(elapsed) + "us");
+    }
+    if (!got) {
+      return;
+    }
+    if (port.received >= port.expected.size()) {
+      fail(port, "unexpected message", response.text);
+      continue;
+    }
+    const Expected& want = port.expected[port.received++];
+    if (response.type != want.type || response.hasSequence != want.hasSequence ||
+        (want.hasSequence && response.sequence != want.sequence) || response.credits != want.credits ||
+        want.text != response.text) {
+      fail(port, "message", std::to_string(port.received - 1) + ": got \"" + response.text + "\", want \"" + want.text + "\"");
+    }
+  }
+}
+
+// Answers the PROTO:BIN handshake from the arm's side of the loopback.
+static void acceptBinary(int peer) {
+  std::string seen;
+  char byte;
+  while ((seen.find("PROTO:BIN") == std::string::npos || seen.back() != '\n') && read(peer, &byte, 1) == 1) {
+    seen += byte;
+  }
+  static const char REPLY[] = "PROTO:BIN:OK\n";
+  if (write(peer, REPLY, sizeof(REPLY) - 1) < 0) {
+    perror("write");
+  }
+}
+
+int main() {
+  SerialBridge textBridge(&Serial1);
+  SerialBridge frameBridge(&Serial2);
+  Port ports[2] = {
+    { "text", &Serial1, &textBridge, Serial1.openLoopback(), "", 0, {}, 0 },
+    { "binary", &Serial2, &frameBridge, Serial2.openLoopback(), "", 0, {}, 0 },
+  };
+
+  std::thread handshake(acceptBinary, ports[1].peer);
+  bool binary = frameBridge.negotiateBinary(1000);
+  handshake.join();
+  if (!binary) {
+    fprintf(stderr, "FAIL binary: PROTO:BIN was not accepted\n");
+    return 1;
+  }
+
+  std::mt19937 random(6);
+  for (int i = 0; i < ASSEMBLER_MESSAGES; i++) {
+    uint16_t sequence = i;
+    addLine(ports[0], random, sequence);
+    addFrame(ports[1], random, sequence);
+    if (i == ASSEMBLER_MESSAGES / 2) {
+      addGarbage(ports[0], false);
+      addGarbage(ports[1], true);
+    }
+  }
+
+  // A line with no end yet must not hold up the read.
+  if (write(ports[0].peer, "DONE#1", 6) != 6) {
+    perror("write");
+    return 1;
+  }
+  drain(ports[0]);
+  if (ports[0].received != 0) {
+    fail(ports[0], "partial line", "was delivered");
+  }
+  ports[0].wire.insert(0, "\n");
+  ports[0].expected.insert(ports[0].expected.begin(), { RESPONSE_DONE, true, 1, -1, "DONE#1" });
+
+  while (ports[0].written < ports[0].wire.size() || ports[1].written < ports[1].wire.size()) {
+    Port& port = ports[random() % 2];
+    size_t length = 1 + random() % ASSEMBLER_MAX_FRAGMENT;
+    if (length > port.wire.size() - port.written) {
+      length = port.wire.size() - port.written;
+    }
+    if (length > 0 && write(port.peer, port.wire.data() + port.written, length) != (ssize_t)length) {
+      perror("write");
+      return 1;
+    }
+    port.written += length;
+    drain(ports[0]);
+    drain(ports[1]);
+  }
+
+  for (Port& port : ports) {
+    if (port.received != port.expected.size()) {
+      fail(port, "received", std::to_string(port.received) + " of " + std::to_string(port.expected.size()));
+    }
+  }
+  if (textBridge.getLineOverflows() != 1) {
+    fail(ports[0], "line overflows", std::to_string(textBridge.getLineOverflows()));
+  }
+  if (frameBridge.getFrameErrors() != 1) {
+    fail(ports[1], "frame errors", std::to_string(frameBridge.getFrameErrors()));
+  }
+
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("%zu lines and %zu frames reassembled from interleaved fragments without blocking or allocating\n",
+         ports[0].expected.size(), ports[1].expected.size());
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <string>
+#include <vector>
+
+#include "ForwarderProbe.h"
+#include "ScriptServer.h"
+#include "test_support.h"
+
+// Fills the telemetry ring with error records whose text needs escaping and
+// runs past the record's text field, then lets the forwarder upload them to
+// the script server. One batch does not fit one payload, so the records must
+// arrive over several POSTs, each one whole JSON under the payload size, in
+// order, none lost or sent twice, and every text cut to the field and
+// escaped.
+
+static const int BATCH_RECORDS = TELEMETRY_RING_SIZE;
+static const unsigned long BATCH_TIMEOUT_MS = 10000;
+
+// 23 characters fit the field: quotes, a backslash and control characters,
+// which grow up to six-fold once escaped, then text that must be cut.
+static const char* const EVENT_TEXT = "Bad \"reply\" \\ \a\a\a\a\a\a\a\a\a cut from here on";
+static const char* const EXPECTED_TEXT =
+    "\"text\":\"Bad \\\"reply\\\" \\\\ \\u0007\\u0007\\u0007\\u0007\\u0007\\u0007\\u0007\\u0007\\u0007\"";
+
+static int failures = 0;
+
+static void fail(const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s %s\n", what, detail.c_str());
+}
+
+static int count(const std::string& text, const std::string& pattern) {
+  int found = 0;
+  for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+    found++;
+  }
+  return found;
+}
+
+int main() {
+  TestWorkspace workspace("telemetry-batch");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  ScriptServer server;
+  if (!server.start()) {
+    fprintf(stderr, "cannot start the script server\n");
+    return 1;
+  }
+  server.setKeepTelemetry(true);
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("batch", "", "127.0.0.1", server.port());
+  ForwarderProbe probe(forwarder);
+  for (int i = 0; i < BATCH_RECORDS; i++) {
+    probe.reportEvent(0, TELEMETRY_ERROR, i, EVENT_TEXT);
+  }
+
+  std::vector<std::string> payloads;
+  std::vector<int> indexes;
+  unsigned long started = millis();
+  while ((int)indexes.size() < BATCH_RECORDS && millis() - started < BATCH_TIMEOUT_MS) {
+    forwarder.update();
+    for (const std::string& payload : server.takeTelemetry()) {
+      payloads.push_back(payload);
+      for (size_t at = payload.find("\"index\":"); at != std::string::npos; at = payload.find("\"index\":", at + 1)) {
+        indexes.push_back(atoi(payload.c_str() + at + 8));
+      }
+    }
+  }
+  forwarder.stopTasks();
+  server.stop();
+
+  if (payloads.size() < 2) {
+    fail("batch was not split", std::to_string(payloads.size()) + " payloads");
+  }
+  for (const std::string& payload : payloads) {
+    int records = count(payload, "{\"kind\":\"error\"");
+    if (payload.size() >= TELEMETRY_PAYLOAD_SIZE || payload.compare(0, 12, "{\"records\":[") != 0 ||
+        payload.find("],\"dropped\":0,\"uptimeMs\":") == std::string::npos || payload.back() != '}') {
+      fail("malformed payload", std::to_string(payload.size()) + " bytes: " + payload.substr(0, 60));
+    }
+    if (records == 0 || count(payload, EXPECTED_TEXT) != records) {
+      fail("text not cut and escaped", payload.substr(0, 200));
+    }
+  }
+  bool inOrder = (int)indexes.size() == BATCH_RECORDS;
+  for (int i = 0; inOrder && i < BATCH_RECORDS; i++) {
+    inOrder = indexes[i] == i;
+  }
+  if (!inOrder) {
+    fail("records lost, repeated or reordered", std::to_string(indexes.size()) + " of " + std::to_string(BATCH_RECORDS));
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("%d records with escaped, cut text uploaded in order over %zu payloads\n", BATCH_RECORDS, payloads.size());
+  return 0;
+}
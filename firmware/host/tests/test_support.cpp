@@ -0,0 +1,77 @@
+#include "test_support.h"
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <new>
+
+#include <Arduino.h>
+
+static std::atomic<unsigned long> allocations(0);
+static std::atomic<long long> liveBytes(0);
+
+unsigned long testAllocations() {
+  return allocations;
+}
+
+long long testLiveBytes() {
+  return liveBytes;
+}
+
+// Out of line so GCC never sees one of these paired with the library's
+// own new or delete after inlining.
+__attribute__((noinline)) void* operator new(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  allocations++;
+  liveBytes += malloc_usable_size(block);
+  return block;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* block) noexcept {
+  if (block) {
+    liveBytes -= malloc_usable_size(block);
+    free(block);
+  }
+}
+
+__attribute__((noinline)) void operator delete[](void* block) noexcept {
+  operator delete(block);
+}
+
+__attribute__((noinline)) void operator delete(void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+__attribute__((noinline)) void operator delete[](void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+TestWorkspace::TestWorkspace(const char* name, bool keepLog) {
+  if (!keepLog) {
+    Serial.attach(open("/dev/null", O_WRONLY), true);
+  }
+  snprintf(path, sizeof(path), "/tmp/%s-XXXXXX", name);
+  ready = mkdtemp(path) && chdir(path) == 0;
+  if (!ready) {
+    fprintf(stderr, "cannot create a working directory under /tmp\n");
+  }
+}
+
+TestWorkspace::~TestWorkspace() {
+  if (ready) {
+    std::error_code ignored;
+    std::filesystem::remove_all(path, ignored);
+  }
+}
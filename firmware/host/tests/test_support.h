@@ -0,0 +1,28 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stddef.h>
+
+// Shared by the checks under tests/. Linking test_support replaces the global
+// operator new/delete with one that counts calls and live bytes, so a test
+// can tell whether a path touches the heap or whether the heap grows.
+unsigned long testAllocations();
+long long testLiveBytes();
+
+// A fresh directory under /tmp made the working directory, so the script
+// cache and the NVS stand-in never land in the caller's. The forwarder's log
+// goes to /dev/null unless keepLog is set. The directory is removed again
+// when the workspace goes out of scope.
+class TestWorkspace {
+private:
+  char path[64];
+  bool ready;
+
+public:
+  explicit TestWorkspace(const char* name, bool keepLog = false);
+  ~TestWorkspace();
+  bool isReady() const { return ready; }
+  const char* getPath() const { return path; }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include <string>
+
+#include "ForwarderProbe.h"
+#include "test_support.h"
+
+// Hands dispatch more command text than the arm's text window holds, as it
+// would see if the network side misjudged the room left. The arm must halt
+// with the error showing, rather than keep the script and wait for commands
+// that can no longer arrive.
+
+static const int LONG_COMMANDS = 16;
+static const int LONG_PER_PAGE = 2;
+static const size_t LONG_TEXT = 200;
+
+static std::string commandList(int offset) {
+  std::string list = "[";
+  for (int i = offset; i < offset + LONG_PER_PAGE; i++) {
+    list += (i > offset ? ",\"NOTE:" : "\"NOTE:") + std::string(LONG_TEXT, 'a' + i % 26) + "\"";
+  }
+  return list + "]";
+}
+
+int main() {
+  TestWorkspace workspace("text-window-full");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+
+  static CommandForwarder forwarder;
+  forwarder.initialize("text", "", "127.0.0.1", 1);
+  ForwarderProbe probe(forwarder);
+
+  std::string poll = "{\"shouldStart\":false,\"arm1\":{\"hasNewScript\":true,\"scriptId\":\"long-text\","
+                     "\"format\":\"msl\",\"totalCommands\":" + std::to_string(LONG_COMMANDS) +
+                     ",\"commands\":" + commandList(0) + "}}";
+  if (!probe.readPollJson(poll.c_str(), poll.size())) {
+    fprintf(stderr, "FAIL poll was not read\n");
+    return 1;
+  }
+  // Four pages of 400 bytes each, past the window's 1024 and the slack for
+  // one command behind it.
+  for (int page = 1; page < 4; page++) {
+    std::string body = "{\"scriptId\":\"long-text\",\"offset\":" + std::to_string(probe.stagedFetched(0)) +
+                       ",\"commands\":" + commandList(probe.stagedFetched(0)) + "}";
+    probe.consumeStaged(0);
+    if (!probe.readChunkJson(0, body.c_str(), body.size())) {
+      fprintf(stderr, "FAIL chunk %d was refused\n", page);
+      return 1;
+    }
+  }
+  probe.dispatchStep();
+  probe.drainLog(LOG_RING_SIZE);
+
+  int failures = 0;
+  String status = forwarder.getArmStatus(0);
+  if (forwarder.isArmActive(0)) {
+    fprintf(stderr, "FAIL arm still active with status \"%s\"\n", status.c_str());
+    failures++;
+  }
+  if (!status.startsWith("ERROR: Command text window full at command 7")) {
+    fprintf(stderr, "FAIL arm status \"%s\"\n", status.c_str());
+    failures++;
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("arm halted when its text window overflowed: %s\n", status.c_str());
+  return 0;
+}
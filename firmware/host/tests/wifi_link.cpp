@@ -0,0 +1,121 @@
+#include <string>
+
+#include "HostClock.h"
+#include "WifiLink.h"
+#include "test_support.h"
+
+// Steps WifiLink on the virtual clock through short drops and one long
+// outage. A drop that the cached AP recovers from must not touch NVS; the
+// cache is only removed once WIFI_CACHED_AP_MAX_FAILURES fast attempts in a
+// row have failed, and written again only when the link comes back.
+
+static const int SHORT_DROPS = 20;
+static const unsigned long STEP_MS = 10;
+static const unsigned long OUTAGE_LIMIT_MS = 120000;
+
+static int failures = 0;
+
+static void fail(const char* what, const std::string& detail) {
+  failures++;
+  fprintf(stderr, "FAIL %s %s\n", what, detail.c_str());
+}
+
+static bool hasStoredAp() {
+  Preferences prefs;
+  WifiAccessPoint ap;
+  bool found = prefs.begin("wifilink", true) && prefs.getBytes("ap", &ap, sizeof(ap)) == sizeof(ap);
+  prefs.end();
+  return found;
+}
+
+// Advances the clock until done() holds or limitMs has passed.
+template <typename Done>
+static bool stepUntil(WifiLink& link, unsigned long limitMs, Done done) {
+  for (unsigned long elapsed = 0; elapsed <= limitMs; elapsed += STEP_MS) {
+    link.update();
+    if (done()) {
+      return true;
+    }
+    HostClock::set(HostClock::now() + STEP_MS * 1000);
+  }
+  return false;
+}
+
+// Drains the log, which holds fewer entries than the drops write.
+static bool logged(DeferredLog& log, const char* format) {
+  bool found = false;
+  LogEntry entry;
+  while (log.pop(entry)) {
+    found = found || strcmp(entry.format, format) == 0;
+  }
+  return found;
+}
+
+int main() {
+  TestWorkspace workspace("wifi-link");
+  if (!workspace.isReady()) {
+    return 1;
+  }
+  HostClock::useVirtual(1000000);
+
+  DeferredLog log;
+  WifiLink link;
+  link.begin("site", "", log);
+  if (!stepUntil(link, WIFI_CONNECT_TIMEOUT_MS, [&] { return link.isConnected(); }) || !hasStoredAp()) {
+    fprintf(stderr, "first association did not store the AP\n");
+    return 1;
+  }
+  unsigned long writes = Preferences::getWriteCount();
+
+  // The AP drops the station and takes one fast attempt to come back.
+  for (int i = 0; i < SHORT_DROPS; i++) {
+    WiFi.setLinkUp(false);
+    link.update();
+    WiFi.setLinkUp(true);
+    if (!stepUntil(link, WIFI_FAST_CONNECT_TIMEOUT_MS + WIFI_BACKOFF_MAX_MS, [&] { return link.isConnected(); })) {
+      fail("no reconnect after drop", std::to_string(i));
+      break;
+    }
+    logged(log, "");
+  }
+  WifiStats stats = link.getStats();
+  if (Preferences::getWriteCount() != writes || !hasStoredAp()) {
+    fail("short drops wrote NVS", std::to_string(Preferences::getWriteCount() - writes) + " writes");
+  }
+  if (stats.fastConnects != (unsigned long)SHORT_DROPS) {
+    fail("short drops did not reconnect through the cached AP", std::to_string(stats.fastConnects) + " fast connects");
+  }
+
+  // The AP is gone: the cache goes only after the fast attempts run out.
+  unsigned long failedBefore = stats.failedAttempts;
+  WiFi.setLinkUp(false);
+  if (!stepUntil(link, OUTAGE_LIMIT_MS, [] { return !hasStoredAp(); })) {
+    fail("cached AP outlived the outage", "");
+  }
+  unsigned long fastFailures = link.getStats().failedAttempts - failedBefore;
+  if (fastFailures != (unsigned long)WIFI_CACHED_AP_MAX_FAILURES) {
+    fail("cached AP dropped after the wrong number of failures", std::to_string(fastFailures));
+  }
+  if (!logged(log, "Cached AP failed %d times, scanning")) {
+    fail("dropping the cached AP was not logged", "");
+  }
+
+  WiFi.setLinkUp(true);
+  unsigned long fastBefore = link.getStats().fastConnects;
+  if (!stepUntil(link, OUTAGE_LIMIT_MS, [&] { return link.isConnected(); })) {
+    fail("no reconnect after the outage", "");
+  }
+  if (!hasStoredAp() || link.getStats().fastConnects != fastBefore) {
+    fail("scan after the outage did not store the AP again", "");
+  }
+  if (Preferences::getWriteCount() - writes != 2) {
+    fail("outage cost the wrong number of NVS writes", std::to_string(Preferences::getWriteCount() - writes));
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  printf("%d drops reconnected through the cached AP with no NVS write; an outage dropped it after %d failures\n",
+         SHORT_DROPS, WIFI_CACHED_AP_MAX_FAILURES);
+  return 0;
+}
@@ -3,6 +3,7 @@ import { createServer } from 'http'
 import cors from 'cors'
 import { MSLCompiler } from '../compiler'
 import { Bonjour } from 'bonjour-service'
+import { encodeChunkImage, encodePollImage } from './scriptImage'
 
 const app = express()
 const server = createServer(app)
@@ -42,6 +43,67 @@ const systemState: SystemState = {
   efficiency: 100
 }
 
+// The forwarder stages a new script while the previous one is still running,
+// and can be handed several before it promotes one. Every script it has
+// downloaded stays reachable for chunk requests, in handoff order, until
+// telemetry reports it running that script or a later one.
+const MAX_RETAINED_SCRIPTS = 8
+const retainedScripts: Record<'arm1' | 'arm2', Map<string, CompiledScript>> = {
+  arm1: new Map(),
+  arm2: new Map()
+}
+
+function storeArmScript(armId: string | undefined, script: CompiledScript) {
+  const key = armId === 'arm2' ? 'arm2' : 'arm1'
+  const current = key === 'arm2' ? systemState.arm2Script : systemState.arm1Script
+  if (current?.executed) {
+    const retained = retainedScripts[key]
+    retained.delete(current.id)
+    retained.set(current.id, current)
+    if (retained.size > MAX_RETAINED_SCRIPTS) {
+      retained.delete(retained.keys().next().value as string)
+    }
+  }
+  if (key === 'arm2') {
+    systemState.arm2Script = script
+  } else {
+    systemState.arm1Script = script
+  }
+}
+
+// Scripts handed out before the one the arm now runs can no longer be asked
+// for. Telemetry cuts the id to 23 characters, hence the prefix match. An id
+// the server does not know, such as a script restored from flash, releases
+// nothing.
+function releaseRetainedScripts(key: 'arm1' | 'arm2', runningId: string) {
+  const retained = retainedScripts[key]
+  const current = key === 'arm2' ? systemState.arm2Script : systemState.arm1Script
+  const ids = [...retained.keys()]
+  const running = current?.id.startsWith(runningId) ? ids.length : ids.findIndex(id => id.startsWith(runningId))
+  for (const id of ids.slice(0, Math.max(running, 0))) {
+    retained.delete(id)
+  }
+}
+
+// Arm progress as reported by the forwarder's telemetry batches.
+interface ArmProgress {
+  scriptId: string | null
+  completed: number
+  total: number
+  lastPosition: string | null
+  lastError: string | null
+  updatedAt: number
+}
+
+function emptyProgress(): ArmProgress {
+  return { scriptId: null, completed: 0, total: 0, lastPosition: null, lastError: null, updatedAt: 0 }
+}
+
+const armProgress: Record<'arm1' | 'arm2', ArmProgress> = {
+  arm1: emptyProgress(),
+  arm2: emptyProgress()
+}
+
 app.use(cors())
 app.use(express.json())
 
@@ -68,12 +130,14 @@ app.get('/api/status', (req, res) => {
     arm1: {
       hasScript: !!systemState.arm1Script,
       scriptId: systemState.arm1Script?.id || null,
-      commands: systemState.arm1Script?.commands.length || 0
+      commands: systemState.arm1Script?.commands.length || 0,
+      progress: armProgress.arm1
     },
     arm2: {
       hasScript: !!systemState.arm2Script,
       scriptId: systemState.arm2Script?.id || null,
-      commands: systemState.arm2Script?.commands.length || 0
+      commands: systemState.arm2Script?.commands.length || 0,
+      progress: armProgress.arm2
     }
   })
 })
@@ -98,11 +162,7 @@ app.post('/api/script/save', (req, res) => {
     }
     
     // Store script for specific arm
-    if (armId === 'arm2') {
-      systemState.arm2Script = compiledScript
-    } else {
-      systemState.arm1Script = compiledScript
-    }
+    storeArmScript(armId, compiledScript)
     systemState.currentCommandIndex = 0
     systemState.isRunning = false
     systemState.isPaused = false
@@ -178,11 +238,7 @@ app.post('/api/script/raw', (req, res) => {
     }
     
     // Store raw script for specific arm
-    if (armId === 'arm2') {
-      systemState.arm2Script = rawScript
-    } else {
-      systemState.arm1Script = rawScript
-    }
+    storeArmScript(armId, rawScript)
     
     console.log(`✅ Raw script saved: ${lines.length} lines for ${armId || 'default'}`)
     
@@ -211,7 +267,37 @@ app.post('/api/script/raw', (req, res) => {
   }
 })
 
+const MAX_SCRIPT_PAGE_SIZE = 256
+
+// Page size requested by the ESP32 forwarder (?pageSize=N). When absent the
+// full command list is returned, which keeps the TypeScript simulator working.
+function parsePageSize(value: unknown): number | null {
+  const size = Number(value)
+  if (!Number.isFinite(size) || size <= 0) return null
+  return Math.min(Math.floor(size), MAX_SCRIPT_PAGE_SIZE)
+}
+
+// Poll validator. Once pending scripts are handed out the poll body only
+// depends on isRunning, so an idle forwarder revalidates with If-None-Match
+// and gets a bodiless 304. SERVER_EPOCH invalidates tags across restarts and
+// scriptHandoffs changes the tag whenever a poll delivers a script.
+const SERVER_EPOCH = Date.now().toString(36)
+let scriptHandoffs = 0
+
+function pollETag(binary: boolean): string {
+  return `"${SERVER_EPOCH}-${scriptHandoffs}-${systemState.isRunning ? 1 : 0}${binary ? '-bin' : ''}"`
+}
+
+function hasPendingScript(): boolean {
+  return !!(
+    (systemState.arm1Script && !systemState.arm1Script.executed) ||
+    (systemState.arm2Script && !systemState.arm2Script.executed)
+  )
+}
+
 app.get('/api/script/poll', (req, res) => {
+  const pageSize = parsePageSize(req.query.pageSize)
+  const binary = req.query.encoding === 'bin'
   const wasConnected = systemState.esp32Connected
   systemState.esp32LastPoll = Date.now()
   systemState.esp32Connected = true
@@ -227,26 +313,39 @@ app.get('/api/script/poll', (req, res) => {
     broadcastDebugMessage(connectMessage)
     console.log('🔗 ESP32 device connected')
   }
+
+  if (!hasPendingScript() && req.headers['if-none-match'] === pollETag(binary)) {
+    res.status(304).setHeader('ETag', pollETag(binary))
+    res.end()
+    return
+  }
   
+  // Key order matters: the forwarder parses this straight off the socket, so
+  // the small fields come before the command arrays.
   const result = {
+    shouldStart: systemState.isRunning,
     arm1: {
       hasNewScript: false,
-      commands: [] as string[],
       scriptId: null as string | null,
-      format: 'msl' as 'msl' | 'raw'
+      format: 'msl' as 'msl' | 'raw',
+      totalCommands: 0,
+      commands: [] as string[]
     },
     arm2: {
       hasNewScript: false,
-      commands: [] as string[],
       scriptId: null as string | null,
-      format: 'msl' as 'msl' | 'raw'
-    },
-    shouldStart: systemState.isRunning
+      format: 'msl' as 'msl' | 'raw',
+      totalCommands: 0,
+      commands: [] as string[]
+    }
   }
 
   if (systemState.arm1Script && !systemState.arm1Script.executed) {
     result.arm1.hasNewScript = true
-    result.arm1.commands = systemState.arm1Script.commands
+    result.arm1.totalCommands = systemState.arm1Script.commands.length
+    result.arm1.commands = pageSize
+      ? systemState.arm1Script.commands.slice(0, pageSize)
+      : systemState.arm1Script.commands
     result.arm1.scriptId = systemState.arm1Script.id
     result.arm1.format = systemState.arm1Script.format
     systemState.arm1Script.executed = true
@@ -255,15 +354,18 @@ app.get('/api/script/poll', (req, res) => {
       timestamp: Date.now(),
       level: 'INFO',
       source: 'POLL',
-      message: `ESP32 downloaded ARM1 script: ${result.arm1.commands.length} commands (${result.arm1.format.toUpperCase()})`
+      message: `ESP32 downloaded ARM1 script: ${result.arm1.totalCommands} commands (${result.arm1.format.toUpperCase()})`
     }
     broadcastDebugMessage(debugMessage)
-    console.log(`📤 ESP32 downloaded ${systemState.arm1Script.format} script for arm1: ${result.arm1.commands.length} commands`)
+    console.log(`📤 ESP32 downloaded ${systemState.arm1Script.format} script for arm1: ${result.arm1.totalCommands} commands`)
   }
 
   if (systemState.arm2Script && !systemState.arm2Script.executed) {
     result.arm2.hasNewScript = true
-    result.arm2.commands = systemState.arm2Script.commands
+    result.arm2.totalCommands = systemState.arm2Script.commands.length
+    result.arm2.commands = pageSize
+      ? systemState.arm2Script.commands.slice(0, pageSize)
+      : systemState.arm2Script.commands
     result.arm2.scriptId = systemState.arm2Script.id
     result.arm2.format = systemState.arm2Script.format
     systemState.arm2Script.executed = true
@@ -272,15 +374,64 @@ app.get('/api/script/poll', (req, res) => {
       timestamp: Date.now(),
       level: 'INFO',
       source: 'POLL',
-      message: `ESP32 downloaded ARM2 script: ${result.arm2.commands.length} commands (${result.arm2.format.toUpperCase()})`
+      message: `ESP32 downloaded ARM2 script: ${result.arm2.totalCommands} commands (${result.arm2.format.toUpperCase()})`
     }
     broadcastDebugMessage(debugMessage)
-    console.log(`📤 ESP32 downloaded ${systemState.arm2Script.format} script for arm2: ${result.arm2.commands.length} commands`)
+    console.log(`📤 ESP32 downloaded ${systemState.arm2Script.format} script for arm2: ${result.arm2.totalCommands} commands`)
   }
   
+  if (result.arm1.hasNewScript || result.arm2.hasNewScript) {
+    scriptHandoffs++
+  }
+  res.setHeader('ETag', pollETag(binary))
+  if (binary) {
+    res.type('application/octet-stream').send(encodePollImage(result.shouldStart, [
+      { name: 'arm1', ...result.arm1 },
+      { name: 'arm2', ...result.arm2 }
+    ]))
+    return
+  }
   res.json(result)
 })
 
+// Paged script download: the forwarder keeps a small ring of commands per arm
+// and refills it from here while earlier commands are still executing.
+app.get('/api/script/chunk', (req, res) => {
+  const armId = req.query.armId === 'arm2' ? 'arm2' : 'arm1'
+  const current = armId === 'arm2' ? systemState.arm2Script : systemState.arm1Script
+  const script = current?.id === req.query.scriptId
+    ? current
+    : retainedScripts[armId].get(String(req.query.scriptId))
+  const offset = Math.max(0, Math.floor(Number(req.query.offset) || 0))
+  const limit = parsePageSize(req.query.limit) || MAX_SCRIPT_PAGE_SIZE
+
+  systemState.esp32LastPoll = Date.now()
+  systemState.esp32Connected = true
+
+  if (!script || script.id !== req.query.scriptId) {
+    res.status(409).json({
+      success: false,
+      error: `Script ${req.query.scriptId} is no longer loaded for ${armId}`
+    })
+    return
+  }
+
+  const commands = script.commands.slice(offset, offset + limit)
+  if (req.query.encoding === 'bin') {
+    res.type('application/octet-stream').send(encodeChunkImage(script.id, offset, script.commands.length, commands))
+    return
+  }
+  res.json({
+    success: true,
+    armId,
+    scriptId: script.id,
+    offset,
+    totalCommands: script.commands.length,
+    done: offset + commands.length >= script.commands.length,
+    commands
+  })
+})
+
 app.post('/api/control/start', (req, res) => {
   const { armId } = req.body
   const script = armId === 'arm2' ? systemState.arm2Script : systemState.arm1Script
@@ -413,6 +564,107 @@ app.post('/api/command/ack', (req, res) => {
   res.json({ success: true })
 })
 
+// Latest latency percentiles uploaded by the forwarder (microseconds per
+// arm and per opcode for send-to-first-byte, send-to-ack and ack-to-next-send).
+let latencyReport: { receivedAt: number, report: unknown } | null = null
+
+app.post('/api/telemetry/latency', (req, res) => {
+  latencyReport = { receivedAt: Date.now(), report: req.body }
+  systemState.esp32LastPoll = Date.now()
+  res.json({ success: true })
+})
+
+app.get('/api/telemetry/latency', (req, res) => {
+  if (!latencyReport) {
+    res.status(404).json({ success: false, error: 'No latency report received yet' })
+    return
+  }
+  res.json({ success: true, ...latencyReport })
+})
+
+interface TelemetryRecord {
+  kind: 'completion' | 'script' | 'error' | 'position'
+  arm: string
+  first?: number
+  last?: number
+  count?: number
+  index?: number
+  total?: number
+  timeMs: number
+  text?: string
+}
+
+// Running drop total from the last batch; it starts over when the device reboots.
+let telemetryDropped = 0
+
+// Batched completions, errors, script changes and positions from the
+// forwarder. Consecutive completions arrive merged into one first..last range.
+app.post('/api/telemetry/batch', (req, res) => {
+  const { records, dropped } = req.body ?? {}
+  if (!Array.isArray(records)) {
+    res.status(400).json({ success: false, error: 'records must be an array' })
+    return
+  }
+
+  systemState.esp32LastPoll = Date.now()
+  let completions = 0
+  for (const record of records as TelemetryRecord[]) {
+    if (record.arm !== 'arm1' && record.arm !== 'arm2') continue
+    const progress = armProgress[record.arm]
+    progress.updatedAt = Date.now()
+
+    switch (record.kind) {
+      case 'completion':
+        progress.completed = Math.max(progress.completed, (record.last ?? 0) + 1)
+        completions += record.count ?? 0
+        break
+      case 'script':
+        progress.scriptId = record.text ?? null
+        if (record.text) releaseRetainedScripts(record.arm, record.text)
+        progress.total = record.total ?? 0
+        progress.completed = record.index ?? 0
+        if (progress.completed === 0) progress.lastError = null
+        broadcastDebugMessage({
+          timestamp: Date.now(),
+          level: 'INFO',
+          source: 'ESP32',
+          message: progress.completed >= progress.total && progress.total > 0
+            ? `✅ ${record.arm.toUpperCase()} finished script ${progress.scriptId}`
+            : `▶️ ${record.arm.toUpperCase()} started script ${progress.scriptId} (${progress.total} commands)`
+        })
+        break
+      case 'error':
+        progress.lastError = record.text ?? 'Unknown error'
+        broadcastDebugMessage({
+          timestamp: Date.now(),
+          level: 'ERROR',
+          source: 'ESP32',
+          message: `❌ ${record.arm.toUpperCase()} command ${(record.index ?? 0) + 1}: ${progress.lastError}`
+        })
+        break
+      case 'position':
+        progress.lastPosition = record.text ?? null
+        break
+    }
+  }
+
+  systemState.currentCommandIndex = Math.max(armProgress.arm1.completed, armProgress.arm2.completed)
+  if (completions > 0) {
+    broadcastDebugMessage({
+      timestamp: Date.now(),
+      level: 'INFO',
+      source: 'ESP32',
+      message: `📈 ${completions} commands completed (arm1 ${armProgress.arm1.completed}/${armProgress.arm1.total}, arm2 ${armProgress.arm2.completed}/${armProgress.arm2.total})`
+    })
+  }
+  if (dropped > telemetryDropped) {
+    console.warn(`⚠️ Telemetry records lost: ${dropped - telemetryDropped} dropped`)
+  }
+  telemetryDropped = Number(dropped) || 0
+
+  res.json({ success: true })
+})
+
 app.post('/api/speed', (req, res) => {
   const { speeds } = req.body
   
@@ -0,0 +1,273 @@
+// Binary script image served to the ESP32 forwarder when it polls with
+// ?encoding=bin. Each command is encoded exactly as CommandCodec::decode +
+// CommandCodec::toBinary would on the device, so the forwarder copies records
+// straight into its command window without ever building a string.
+//
+// Poll image:  'P' 'I' version flags(bit0 = shouldStart) armCount
+//              per arm: name hasNewScript [scriptId format totalCommands recordCount records]
+// Chunk image: 'P' 'C' version scriptId offset totalCommands recordCount records
+//
+// Strings are u8 length + bytes, counts are unsigned LEB128 varints and each
+// record is a u8 length followed by the CommandCodec binary layout. A zero
+// length record is a command the device would reject as invalid.
+
+export const SCRIPT_IMAGE_VERSION = 1
+
+const AXIS_NAMES = ['X', 'Y', 'Z', 'T', 'G']
+const MAX_OPERANDS = 6
+const MAX_AXES = 5
+const TEXT_MAX = 240
+
+const enum Opcode {
+  INVALID = 0,
+  MOVE,
+  GROUP,
+  WAIT,
+  ZERO,
+  HOME,
+  SPEED,
+  RAW
+}
+
+const FLAG_TEXT = 0x01
+
+interface CommandRecord {
+  opcode: number
+  flags: number
+  axisGroups: number[]
+  operands: number[]
+  text: Buffer | null
+}
+
+export interface ArmImage {
+  name: string
+  hasNewScript: boolean
+  scriptId: string | null
+  format: string
+  totalCommands: number
+  commands: string[]
+}
+
+function axisIndex(axis: string | undefined): number {
+  return axis === undefined ? -1 : AXIS_NAMES.indexOf(axis)
+}
+
+function parseInt32(text: string): number | null {
+  let cursor = 0
+  const negative = text[0] === '-'
+  if (negative) cursor++
+  if (cursor === text.length || (text[cursor] === '0' && (cursor + 1 !== text.length || negative))) {
+    return null
+  }
+
+  let magnitude = 0
+  for (; cursor < text.length; cursor++) {
+    const c = text.charCodeAt(cursor)
+    if (c < 48 || c > 57) return null
+    magnitude = magnitude * 10 + (c - 48)
+    if (magnitude > 2147483648) return null
+  }
+  if (!negative && magnitude > 2147483647) return null
+  return negative ? -magnitude : magnitude
+}
+
+function emptyRecord(opcode: number): CommandRecord {
+  return { opcode, flags: 0, axisGroups: [], operands: [], text: null }
+}
+
+function decodeAxisValues(text: string, record: CommandRecord): boolean {
+  let cursor = 0
+  while (cursor < text.length) {
+    const axis = axisIndex(text[cursor])
+    if (axis < 0 || record.axisGroups.length >= MAX_AXES) break
+    cursor++
+
+    let count = 0
+    while (true) {
+      let end = cursor
+      while (end < text.length && text[end] !== ',' && text[end] !== ':') end++
+      const value = record.operands.length < MAX_OPERANDS ? parseInt32(text.slice(cursor, end)) : null
+      if (value === null) {
+        count = -1
+        break
+      }
+      record.operands.push(value)
+      count++
+      cursor = end
+      if (text[cursor] !== ',') break
+      cursor++
+    }
+    if (count <= 0) break
+
+    record.axisGroups.push((axis << 4) | count)
+
+    if (cursor === text.length) return true
+    cursor++
+    if (cursor === text.length) break
+  }
+
+  if (text.length === 0) return true
+
+  record.axisGroups = []
+  record.operands = []
+  return false
+}
+
+function decodeText(text: string, record: CommandRecord): boolean {
+  const bytes = Buffer.from(text, 'utf8')
+  if (bytes.length > TEXT_MAX) {
+    record.opcode = Opcode.INVALID
+    return false
+  }
+  record.flags |= FLAG_TEXT
+  record.operands = []
+  record.text = bytes
+  return true
+}
+
+// Mirrors CommandCodec::decode in firmware/FirmwareESP32/CommandCodec.cpp.
+export function decodeCommand(command: string): CommandRecord {
+  if (command.startsWith('MOVE:') && axisIndex(command[5]) >= 0) {
+    const record = emptyRecord(Opcode.MOVE)
+    if (decodeAxisValues(command.slice(5), record) && record.axisGroups.length === 1) {
+      return record
+    }
+    record.axisGroups = [axisIndex(command[5]) << 4]
+    decodeText(command.slice(6), record)
+    return record
+  }
+
+  if (command.startsWith('GROUP:')) {
+    const record = emptyRecord(Opcode.GROUP)
+    if (!decodeAxisValues(command.slice(6), record)) decodeText(command.slice(6), record)
+    return record
+  }
+
+  if (command.startsWith('WAIT:')) {
+    const record = emptyRecord(Opcode.WAIT)
+    decodeText(command.slice(5), record)
+    return record
+  }
+
+  if (command.startsWith('ZERO')) return emptyRecord(Opcode.ZERO)
+  if (command.startsWith('HOME')) return emptyRecord(Opcode.HOME)
+
+  if (command.startsWith('SPEED:')) {
+    const record = emptyRecord(Opcode.SPEED)
+    const payload = command.slice(6)
+    const separator = payload.indexOf(':')
+    const value = separator >= 0 ? parseInt32(payload.slice(separator + 1)) : null
+    if (value !== null) {
+      if (separator === 3 && payload.startsWith('ALL')) {
+        record.operands = [value]
+        return record
+      }
+      const axis = separator === 1 ? axisIndex(payload[0]) : -1
+      if (axis >= 0) {
+        record.axisGroups = [(axis << 4) | 1]
+        record.operands = [value]
+        return record
+      }
+    }
+    decodeText(payload, record)
+    return record
+  }
+
+  const record = emptyRecord(Opcode.RAW)
+  decodeText(command, record)
+  return record
+}
+
+// Mirrors CommandCodec::toBinary; invalid commands encode to zero bytes.
+export function encodeRecord(record: CommandRecord): Buffer {
+  if (record.opcode === Opcode.INVALID) return Buffer.alloc(0)
+
+  const bytes: number[] = [
+    (record.flags << 4) | record.opcode,
+    (record.operands.length << 4) | record.axisGroups.length,
+    ...record.axisGroups
+  ]
+
+  if (record.text) {
+    return Buffer.concat([Buffer.from(bytes), record.text])
+  }
+
+  for (const operand of record.operands) {
+    let zigzag = ((operand << 1) ^ (operand >> 31)) >>> 0
+    while (zigzag >= 0x80) {
+      bytes.push((zigzag & 0x7f) | 0x80)
+      zigzag >>>= 7
+    }
+    bytes.push(zigzag)
+  }
+  return Buffer.from(bytes)
+}
+
+class ImageWriter {
+  private chunks: Buffer[] = []
+
+  byte(value: number) {
+    this.chunks.push(Buffer.from([value & 0xff]))
+  }
+
+  varint(value: number) {
+    const bytes: number[] = []
+    let remaining = value >>> 0
+    while (remaining >= 0x80) {
+      bytes.push((remaining & 0x7f) | 0x80)
+      remaining >>>= 7
+    }
+    bytes.push(remaining)
+    this.chunks.push(Buffer.from(bytes))
+  }
+
+  string(value: string | null) {
+    const bytes = Buffer.from(value ?? '', 'utf8').subarray(0, 255)
+    this.byte(bytes.length)
+    this.chunks.push(bytes)
+  }
+
+  records(commands: string[]) {
+    this.varint(commands.length)
+    for (const command of commands) {
+      const record = encodeRecord(decodeCommand(command))
+      this.byte(record.length)
+      this.chunks.push(record)
+    }
+  }
+
+  toBuffer(): Buffer {
+    return Buffer.concat(this.chunks)
+  }
+}
+
+export function encodePollImage(shouldStart: boolean, arms: ArmImage[]): Buffer {
+  const writer = new ImageWriter()
+  writer.byte(0x50)
+  writer.byte(0x49)
+  writer.byte(SCRIPT_IMAGE_VERSION)
+  writer.byte(shouldStart ? 1 : 0)
+  writer.byte(arms.length)
+  for (const arm of arms) {
+    writer.string(arm.name)
+    writer.byte(arm.hasNewScript ? 1 : 0)
+    if (!arm.hasNewScript) continue
+    writer.string(arm.scriptId)
+    writer.string(arm.format)
+    writer.varint(arm.totalCommands)
+    writer.records(arm.commands)
+  }
+  return writer.toBuffer()
+}
+
+export function encodeChunkImage(scriptId: string, offset: number, totalCommands: number, commands: string[]): Buffer {
+  const writer = new ImageWriter()
+  writer.byte(0x50)
+  writer.byte(0x43)
+  writer.byte(SCRIPT_IMAGE_VERSION)
+  writer.string(scriptId)
+  writer.varint(offset)
+  writer.varint(totalCommands)
+  writer.records(commands)
+  return writer.toBuffer()
+}